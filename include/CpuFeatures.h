@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+ *	Runtime detection of the vector instruction sets this machine supports,
+ *	so the hot loops (warping, compositing) can pick the widest kernel
+ *	available without requiring a special build per CPU.
+ */
+/*
+ *	There's no SSE2 tier: SSE2 is the baseline on x64 (and MSVC's default for
+ *	Win32), so Scalar is already built with it. The narrowest kernels need
+ *	SSE4.1 (pshufb, pblendvb, roundps, pmulld), so a CPU with SSE2 but not
+ *	SSE4.1 gets Scalar.
+ */
+enum class SimdLevel
+{
+	Scalar = 0,
+	SSE41,
+	AVX2,
+	AVX512
+};
+
+/*
+ *	Returns the best instruction set supported by both the CPU and the OS
+ *	(AVX state has to be enabled in XCR0). Detected once and cached.
+ */
+SimdLevel DetectSimdLevel();
+
+const char* SimdLevelName(SimdLevel level);
+
+/*
+ *	MSVC lets any function use any intrinsic, but gcc/clang need to be told
+ *	which functions are allowed to emit the wider instructions. Only call
+ *	functions marked with these after checking DetectSimdLevel().
+ *
+ *	FORCE_INLINE is for the small per-vector helpers; if they end up as real
+ *	calls, every vector argument goes through memory.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+	#define TARGET_SSE41
+	#define TARGET_AVX2
+	#define TARGET_AVX512
+	#define FORCE_INLINE __forceinline
+#else
+	#define TARGET_SSE41 __attribute__((target("sse4.1")))
+	#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+	#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx2,fma")))
+	#define FORCE_INLINE inline __attribute__((always_inline))
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+
+#include "Layer.h"
+
+// Separate rectangles DamageTracker keeps before it gives up and merges them all
+// into one. Each one is a pass of the compositor and an upload.
+static const int DAMAGE_MAX_RECTS = 8;
+
+/*
+ *	Pixels [x0, x1) x [y0, y1) of a target, in window coordinates.
+ */
+struct DamageRect
+{
+	int x0, y0, x1, y1;
+
+	bool Empty() const;
+	bool Overlaps(const DamageRect& other) const;
+	void Merge(const DamageRect& other);
+};
+
+/*
+ *	Works out which parts of a target have to be redrawn from one frame to the
+ *	next, by comparing where each layer of the stack is drawn with where it was
+ *	drawn last time. Any layer that moved, was rewarped or refiltered, got new
+ *	pixels, or changed its place in the stack (added, deleted, reordered)
+ *	damages both its old and its new box; everything else is left as it was.
+ *	Layers outside the target damage nothing. Anything else drawn over the
+ *	target (handles, cursors) can add its own rectangles with Damage().
+ */
+class DamageTracker
+{
+public:
+
+	/*
+	 *	Records layers[0..count) (null ones skipped) as drawn on a (width x height)
+	 *	target and returns the rectangles that changed since the last call,
+	 *	clipped to the target and not overlapping each other. A different
+	 *	target size, or a DamageAll() since, damages the whole target.
+	 */
+	const std::vector<DamageRect>& Update(const Layer* const* layers, int count, int width, int height);
+
+	/*
+	 *	Makes the next Update() damage the whole target.
+	 */
+	void DamageAll();
+
+	/*
+	 *	Adds "rect" to what the next Update() returns.
+	 */
+	void Damage(const DamageRect& rect);
+
+private:
+
+	/*
+	 *	What a layer looked like when it was last drawn.
+	 */
+	struct DrawnLayer
+	{
+		const Layer* layer;
+		const PixelRGBA* source;
+		int x, y;
+		int width, height;
+		Matrix3D matrix;
+		WarpFilter filter;
+	};
+
+	static DrawnLayer Describe(const Layer* layer);
+	static bool SameDrawing(const DrawnLayer& a, const DrawnLayer& b);
+	void AddDamage(const DrawnLayer& drawn);
+	void AddDamage(DamageRect rect);
+
+	std::vector<DrawnLayer> drawn;
+	int drawnWidth = 0, drawnHeight = 0;
+	bool everything = true;
+	std::vector<DamageRect> damage;
+	std::vector<DamageRect> pending;			// From Damage(), for the next Update()
+};
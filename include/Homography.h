@@ -0,0 +1,70 @@
+#pragma once
+
+#include "EigenMatrix.h"
+#include "Point.h"
+
+// A quad counts as degenerate once any three corners span a triangle this small,
+// relative to the square of the quad's size. Well above double rounding, and far
+// below anything that could be dragged or typed into a manifest on purpose.
+static const double HOMOGRAPHY_DEGENERATE_AREA = 1e-10;
+
+/*
+ *	Projective matrix M (with M(2, 2) = 1) taking each src[i] to dst[i].
+ *
+ *	Solved in closed form (see SolveSquareToQuad) as square -> dst composed with
+ *	the adjugate of square -> src, all in double precision and only rounded to
+ *	float at the end. Falls back to SolveHomographyLU when either quad is too
+ *	close to degenerate for that to be trusted.
+ */
+Matrix3D SolveHomography(const Point src[4], const Point dst[4]);
+
+/*
+ *	The closed form part of SolveHomography, in double and row major into H, with
+ *	no fallback: returns false, leaving H untouched, for degenerate quads.
+ */
+bool SolveHomographyExact(const Point src[4], const Point dst[4], double H[9]);
+
+/*
+ *	Same as SolveHomography, but with the traditional 8x8 system on pg. 3 of
+ *	http://graphics.cs.cmu.edu/courses/15-463/2008_fall/Papers/proj.pdf,
+ *	solved with partial pivot LU in float. Slower and less accurate; kept as
+ *	the fallback for degenerate quads and as a reference to check against.
+ */
+Matrix3D SolveHomographyLU(const Point src[4], const Point dst[4]);
+
+/*
+ *	Matrix taking the corners of a (width x height) image, in the order lower left
+ *	(the origin), lower right, upper right, upper left, to "corners".
+ */
+Matrix3D SolveRectToQuad(int width, int height, const Point corners[4]);
+
+/*
+ *	Heckbert's closed form (pg. 4 of the paper above) for the matrix taking the
+ *	unit square (0, 0), (1, 0), (1, 1), (0, 1) to "corners", written row major
+ *	into H with H[8] = 1. Returns false, leaving H untouched, if the corners are
+ *	collinear enough that the result would be meaningless.
+ */
+bool SolveSquareToQuad(const Point corners[4], double H[9]);
+
+/*
+ *	How SolveHomographyDLT finds the null vector of the DLT system.
+ */
+enum class DltMethod
+{
+	SVD,					// Jacobi SVD of the full 2n x 9 system; most accurate
+	NormalEquations			// Eigen decomposition of the 9x9 A^T A; no allocation, fastest for large n
+};
+
+/*
+ *	Least squares homography from "count" >= 4 point pairs (src[i] -> dst[i]) with
+ *	the normalized DLT: both point sets are shifted to their centroid and scaled to
+ *	an average distance of sqrt(2) first (Hartley), which keeps the system well
+ *	conditioned whatever units the points are in.
+ *
+ *	"weights" may be null (all 1); pairs with weight <= 0 are ignored. Returns
+ *	false, leaving M untouched, if fewer than 4 pairs count or they don't pin down
+ *	a unique matrix (e.g. all collinear). Otherwise M(2, 2) = 1. With exactly
+ *	4 pairs this matches SolveHomography.
+ */
+bool SolveHomographyDLT(const Point* src, const Point* dst, int count, const double* weights,
+	Matrix3D& M, DltMethod method = DltMethod::SVD);
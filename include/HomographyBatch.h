@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include "Homography.h"
+
+/*
+ *	Bulk homography solving (e.g. thousands of random corner jitters for dataset
+ *	augmentation). Problems are laid out structure-of-arrays, so the vector
+ *	versions solve one problem per SIMD lane with the same closed form as
+ *	SolveSquareToQuad, in double precision. Every instruction set produces
+ *	bit-identical results.
+ */
+
+/*
+ *	"count" quads: corner i of quad n is (x[i][n], y[i][n]), with corners in the
+ *	usual order (lower left, lower right, upper right, upper left).
+ */
+struct QuadArrays
+{
+	const double* x[4];
+	const double* y[4];
+};
+
+/*
+ *	"count" 3x3 matrices: row major coefficient k of matrix n is m[k][n].
+ */
+struct HomographyArrays
+{
+	float* m[9];
+};
+
+/*
+ *	Per problem flags; 0 means the solution is good.
+ */
+enum HomographyFlags : unsigned char
+{
+	HOMOGRAPHY_DEGENERATE = 1,			// Three corners (nearly) collinear; both matrices are NaN
+	HOMOGRAPHY_NOT_CONVEX = 2,			// A quad is concave or folded over itself
+	HOMOGRAPHY_ILL_CONDITIONED = 4		// Solved, but small corner moves cause large changes
+};
+
+// A quad is flagged ill-conditioned once three of its corners span a triangle
+// smaller than this fraction of the quad's squared size.
+static const double HOMOGRAPHY_ILL_CONDITIONED_AREA = 1e-3;
+
+/*
+ *	Solves the matrices taking the (width x height) rectangle to each "dst"
+ *	quad, and their inverses, both scaled so coefficient 8 is 1. Work is split
+ *	over WorkerPool::Get() for large batches. "flags" gets one entry per problem.
+ */
+void SolveRectToQuadBatch(int width, int height, const QuadArrays& dst, int count,
+	const HomographyArrays& forward, const HomographyArrays& inverse, unsigned char* flags);
+
+/*
+ *	Same, but taking each "src" quad to the matching "dst" quad.
+ */
+void SolveQuadToQuadBatch(const QuadArrays& src, const QuadArrays& dst, int count,
+	const HomographyArrays& forward, const HomographyArrays& inverse, unsigned char* flags);
+
+/*
+ *	One batch, as handed to the per instruction set solvers. "src" is null for
+ *	rectangle sources, which use (width, height) instead.
+ */
+struct HomographyBatch
+{
+	const QuadArrays* src;
+	double width, height;
+	QuadArrays dst;
+	HomographyArrays forward;
+	HomographyArrays inverse;
+	unsigned char* flags;
+};
+
+// Solves problems [begin, end) of "batch".
+typedef void (*HomographyBatchFunc)(const HomographyBatch& batch, int begin, int end);
+
+// Solver for the widest instruction set DetectSimdLevel() reports.
+HomographyBatchFunc GetHomographyBatchFunc();
+
+// Per instruction set implementations. Only call the ones the CPU supports.
+HomographyBatchFunc GetHomographyBatchFuncScalar();
+HomographyBatchFunc GetHomographyBatchFuncAVX2();
+HomographyBatchFunc GetHomographyBatchFuncAVX512();
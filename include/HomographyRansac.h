@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include "Homography.h"
+
+#include <vector>
+
+/*
+ *	Robust homography estimation from point correspondences that include outliers
+ *	(e.g. feature matches between a photo and a reference), so an image can be
+ *	rectified without placing its corners by hand.
+ *
+ *	Plain RANSAC: hypotheses come from random 4 pair samples (SolveHomographyExact)
+ *	and are scored a round at a time, split over WorkerPool::Get(), by counting the
+ *	pairs each one maps to within a threshold with the widest inlier counter the
+ *	CPU has. The number of rounds adapts to the best inlier ratio found so far, and
+ *	the winner is refit to all of its inliers with SolveHomographyDLT.
+ *
+ *	Samples are drawn from a generator seeded per hypothesis, and ties go to the
+ *	earliest hypothesis, so results don't depend on the thread count.
+ */
+
+struct RansacOptions
+{
+	double threshold = 3.0;			// Max distance, in dst units, between dst[i] and the mapped src[i] of an inlier
+	double confidence = 0.995;		// Stop once the chance of having missed a better sample drops below 1 - confidence
+	int maxIterations = 10000;		// Hypotheses to try at most
+	unsigned int seed = 0;
+	bool refine = true;				// Refit the best hypothesis to all of its inliers
+};
+
+struct RansacResult
+{
+	Matrix3D matrix;						// Maps src to dst, with matrix(2, 2) = 1
+	int inlierCount = 0;
+	int iterations = 0;						// Hypotheses tried
+	std::vector<unsigned char> inliers;		// 1 per inlier pair, 0 per outlier
+};
+
+/*
+ *	Estimates the homography taking src[i] to dst[i] for most of the "count"
+ *	pairs. For rectification, src should be image pixel coordinates and dst the
+ *	coordinates they belong at, so result.matrix can go straight to
+ *	Layer::InvWarpLayer. Returns false if there are fewer than 4 pairs, or no
+ *	non-degenerate sample was found.
+ */
+bool EstimateHomographyRansac(const Point* src, const Point* dst, int count,
+	const RansacOptions& options, RansacResult& result);
+
+/*
+ *	The correspondences in float structure-of-arrays form, as the inlier
+ *	counters read them.
+ */
+struct RansacPoints
+{
+	const float* srcX;
+	const float* srcY;
+	const float* dstX;
+	const float* dstY;
+};
+
+/*
+ *	Counts the pairs in [begin, end) that H (row major) maps to within
+ *	sqrt(thresholdSquared) of their dst point, writing 1/0 per pair into
+ *	inliers[i] if that's not null. Pairs mapped to or behind the horizon
+ *	(w <= 0) are outliers.
+ */
+typedef int (*CountInliersFunc)(const float H[9], const RansacPoints& points,
+	float thresholdSquared, int begin, int end, unsigned char* inliers);
+
+// Counter for the widest instruction set DetectSimdLevel() reports.
+CountInliersFunc GetCountInliersFunc();
+
+// Per instruction set implementations; all give identical counts. Only call the ones the CPU supports.
+CountInliersFunc GetCountInliersFuncScalar();
+CountInliersFunc GetCountInliersFuncAVX2();
+CountInliersFunc GetCountInliersFuncAVX512();
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+// Every Image allocation, and every row inside it, starts on this many bytes.
+static const size_t IMAGE_ALIGNMENT = 64;
+
+/*
+ *	Running totals for every block Image has allocated, e.g. to check that
+ *	re-warping a layer while dragging reuses its buffer instead of allocating.
+ */
+struct ImageMemoryStats
+{
+	unsigned long long allocations;
+	unsigned long long frees;
+	size_t bytesInUse;
+	size_t peakBytesInUse;
+};
+
+ImageMemoryStats GetImageMemoryStats();
+
+// IMAGE_ALIGNMENT aligned allocation used by Image; throws std::bad_alloc on failure.
+void* AllocateImageMemory(size_t bytes);
+void FreeImageMemory(void* memory, size_t bytes);
+
+/*
+ *	Non-owning window onto rows of pixels that are "stride" pixels apart.
+ *	Views are plain values and cheap to copy, but only valid while whatever
+ *	owns the pixels (usually an Image) is alive and hasn't been reallocated.
+ */
+template <typename Pixel>
+struct ImageView
+{
+	Pixel* pixels;
+	int width, height;
+	int stride;				// In pixels, not bytes
+
+	Pixel* operator[](int row) const { return pixels + (ptrdiff_t)row * stride; }
+	bool Empty() const { return pixels == nullptr || width <= 0 || height <= 0; }
+
+	/*
+	 *	The (subWidth x subHeight) rectangle with its first pixel at (x, y).
+	 *	Not clipped; the caller keeps it inside this view.
+	 */
+	ImageView SubView(int x, int y, int subWidth, int subHeight) const
+	{
+		return { (*this)[y] + x, subWidth, subHeight, stride };
+	}
+
+	// Lets a view of writable pixels be passed anywhere read-only ones are expected.
+	operator ImageView<const Pixel>() const { return { pixels, width, height, stride }; }
+};
+
+/*
+ *	Owning 2D pixel buffer: one IMAGE_ALIGNMENT aligned block, with each row padded
+ *	out to a multiple of IMAGE_ALIGNMENT bytes, so row starts are aligned too and
+ *	rows are Stride() pixels apart (which may be more than Width()).
+ *
+ *	Images are move-only; use Clone() for an explicit deep copy and View() to hand
+ *	the pixels to code that shouldn't own them. Pixels start out uninitialized.
+ *	Resize() keeps the block when the new size fits, so an image that gets
+ *	rewritten at slightly different sizes (like a layer being warped) settles
+ *	on one allocation.
+ */
+template <typename Pixel>
+class Image
+{
+public:
+
+	Image() {}
+
+	Image(int width, int height)
+	{
+		Resize(width, height);
+	}
+
+	~Image()
+	{
+		Reset();
+	}
+
+	Image(Image&& other) noexcept
+	{
+		Take(other);
+	}
+
+	Image& operator=(Image&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			Take(other);
+		}
+		return *this;
+	}
+
+	Image(const Image&) = delete;
+	Image& operator=(const Image&) = delete;
+
+	Image Clone() const
+	{
+		Image copy(width, height);
+		if (pixels)
+			memcpy(copy.pixels, pixels, SizeInBytes());
+		return copy;
+	}
+
+	/*
+	 *	Makes the image (width x height), keeping the current block if it's big
+	 *	enough and not more than 4x too big. Otherwise it's replaced with one that
+	 *	has room to grow by half again, so a slowly growing image doesn't allocate
+	 *	every time. Pixel contents are undefined afterwards either way.
+	 */
+	void Resize(int width, int height)
+	{
+		if (width <= 0 || height <= 0)
+		{
+			Reset();
+			return;
+		}
+
+		const size_t alignedRow = (width * sizeof(Pixel) + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+		const size_t needed = alignedRow * height;
+		if (needed > capacity || needed < capacity / 4)
+		{
+			size_t grown = (pixels && needed > capacity) ? (capacity + capacity / 2) : 0;
+			size_t newCapacity = (grown > needed) ? grown : needed;
+
+			Reset();
+			pixels = (Pixel*)AllocateImageMemory(newCapacity);
+			capacity = newCapacity;
+		}
+		stride = (int)(alignedRow / sizeof(Pixel));
+		this->width = width;
+		this->height = height;
+	}
+
+	/*
+	 *	Frees the pixels, leaving an empty image.
+	 */
+	void Reset()
+	{
+		FreeImageMemory(pixels, capacity);
+		pixels = nullptr;
+		capacity = 0;
+		width = height = stride = 0;
+	}
+
+	Pixel* operator[](int row) { return pixels + (ptrdiff_t)row * stride; }
+	const Pixel* operator[](int row) const { return pixels + (ptrdiff_t)row * stride; }
+
+	Pixel* Data() { return pixels; }
+	const Pixel* Data() const { return pixels; }
+	int Width() const { return width; }
+	int Height() const { return height; }
+	int Stride() const { return stride; }
+	size_t SizeInBytes() const { return (size_t)stride * height * sizeof(Pixel); }
+	size_t Capacity() const { return capacity; }		// Bytes actually allocated
+	bool Empty() const { return pixels == nullptr; }
+
+	ImageView<Pixel> View() { return { pixels, width, height, stride }; }
+	ImageView<const Pixel> View() const { return { pixels, width, height, stride }; }
+
+private:
+
+	void Take(Image& other)
+	{
+		pixels = other.pixels;
+		width = other.width;
+		height = other.height;
+		stride = other.stride;
+		capacity = other.capacity;
+		other.pixels = nullptr;
+		other.capacity = 0;
+		other.width = other.height = other.stride = 0;
+	}
+
+	Pixel* pixels = nullptr;
+	int width = 0, height = 0;
+	int stride = 0;
+	size_t capacity = 0;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "Image.h"
+#include "PixelRGBA.h"
+
+/*
+ *	OpenImageIO wrappers for loading and saving RGBA8 images. Images are kept
+ *	bottom row first, the way OpenGL (and the rest of the warper) expects them,
+ *	and flipped on the way in and out of the file.
+ */
+
+/*
+ *	Reads any image OIIO supports into "image" as RGBA8: gray is spread into RGB,
+ *	missing alpha becomes 255, and anything deeper than 8 bits is rounded down.
+ *	On failure returns false with the reason in "error" and leaves "image" empty.
+ */
+bool ReadImageRGBA(const std::string& path, Image<PixelRGBA>& image, std::string& error);
+
+/*
+ *	Opens "path" just far enough to read its dimensions, without decoding any pixels.
+ */
+bool ReadImageSize(const std::string& path, int& width, int& height, std::string& error);
+
+/*
+ *	Writes "image" to "path" (the format comes from the extension) as RGBA, or as
+ *	RGB if the format can't store alpha.
+ */
+bool WriteImageRGBA(const std::string& path, const ImageView<const PixelRGBA>& image, std::string& error);
@@ -1,20 +1,106 @@
 #pragma once
 #include <iostream>
+#include <string>
 
 #include "PixelRGBA.h"
+#include "Point.h"
 #include "EigenMatrix.h"
+#include "WarpKernels.h"
+#include "MipPyramid.h"
+#include "TiledSource.h"
+
+// Pixels Layer::OutputRow needs in its scratch buffer on top of the row itself:
+// a deferred row is sampled from the anchor before it to the anchor after it.
+static const int LAYER_ROW_SCRATCH_EXTRA = 2 * WARP_ANCHOR_SPAN;
+
+/*
+ *	What InvWarpLayer worked out about a layer's current warp: enough to sample
+ *	any output pixel again without keeping warpedImage around.
+ */
+struct WarpPlan
+{
+	WarpKind kind = WarpKind::Identity;
+	Matrix3D inverse = Matrix3D::Identity();	// Output pixel -> source pixel (see Layer::WarpRows)
+	WarpClipQuad clip;					// Outline of the warped image in output pixels
+	WarpClipQuad interior;				// Output pixels that sample well inside the source (see Layer::OpaqueOver)
+	int offsetX = 0, offsetY = 0;		// The whole pixel offset of a WarpKind::Translation
+	bool tiled = false;					// Sample the tiled copy of the source (see Layer::tiledSource)
+};
 
 struct Layer
 {
 	Matrix3D warpMatrix;
-	PixelRGBA** rawImageData;
-	PixelRGBA** warpedImageData;
+	WarpFilter filter;
+	double warpTolerance;		// Source pixels the perspective approximation may be off by (see WarpTile); 0 warps exactly
+	int warpBlockWidth;			// Output columns warped at a time per band of rows, rounded up to a multiple of WARP_ANCHOR_SPAN (WARP_TILE_SIZE with a warpTolerance); 0 picks it per band (see ChooseWarpBlockWidth)
+	Image<PixelRGBA> rawImage;
+	Image<PixelRGBA> warpedImage;		// Empty while the warp is the identity (see WarpedView)
 	int rasterPosX, rasterPosY;
 	int imageWidth, imageHeight;
 	int outputWidth, outputHeight;
+	MipPyramid mips;			// Built from rawImage the first time a Trilinear warp needs it
+	bool tiledSource;			// Warp Nearest from a tiled copy of rawImage when output rows cut across source rows; the only case it wins
+	TiledSource tiles;			// That copy, built the first time a warp needs it
+	WarpPlan plan;				// How the current warp maps output pixels back to the source
+	bool warpDeferred;			// Set by DeferWarp: warpedImage stays empty and OutputRow samples the source instead
+	bool sourceOpaque;			// Every rawImage pixel has alpha 255; worked out by ReadImageFile
 
 	Layer();
-	~Layer();
+
+	// Layers own their images, so they can be moved but not copied.
+	Layer(Layer&&) = default;
+	Layer& operator=(Layer&&) = default;
+	Layer(const Layer&) = delete;
+	Layer& operator=(const Layer&) = delete;
+
+	/*
+	 *	The warped pixels to display: warpedImage, or rawImage itself while the
+	 *	layer is unwarped, so a freshly loaded layer doesn't hold a second copy.
+	 */
+	ImageView<const PixelRGBA> WarpedView() const;
+
+	/*
+	 *	Output pixels [xBegin, xEnd) of row y, the ones WarpedView() shows
+	 *	there: read straight from it, or while the warp is deferred, sampled
+	 *	on the spot into "scratch" (which needs room for xEnd - xBegin +
+	 *	LAYER_ROW_SCRATCH_EXTRA pixels). Deferred rows come out the same as
+	 *	warpedImage would have them, except that warpTolerance is ignored
+	 *	(they're always sampled exactly). Safe to call from several threads.
+	 */
+	const PixelRGBA* OutputRow(int y, int xBegin, int xEnd, PixelRGBA* scratch) const;
+
+	/*
+	 *	Whether output pixels [xBegin, xEnd) x [yBegin, yEnd) are all certain to
+	 *	come out with alpha 255: the source is opaque and the box is inside the
+	 *	warp's interior, where every filter only reads source pixels. Cheap, and
+	 *	conservative near the edges, so the compositor can cull what's under it.
+	 */
+	bool OpaqueOver(int xBegin, int yBegin, int xEnd, int yEnd) const;
+
+	/*
+	 *	The same for a single row: finds [xStart, xEnd), the output pixels of
+	 *	row y certain to come out opaque. Returns false if there are none.
+	 */
+	bool OpaqueSpan(int y, int& xStart, int& xEnd) const;
+
+	/*
+	 *	Frees warpedImage and keeps only the plan, for layers that are just
+	 *	composited (see TileCompositor) and don't need their pixels kept. Later
+	 *	warps stay deferred until MaterializeWarp(). WarpedView() is empty
+	 *	meanwhile, unless the warp is the identity.
+	 */
+	void DeferWarp();
+
+	/*
+	 *	Undoes DeferWarp(), warping the current plan into warpedImage again.
+	 */
+	void MaterializeWarp();
+
+	/*
+	 *	Replaces this layer's image with the file at "path" (see ReadImageRGBA),
+	 *	unwarped and at the origin. On failure the layer is left empty.
+	 */
+	bool ReadImageFile(const std::string& path, std::string& error);
 
 	/*
 	 *	Move this image's raster position by the amount of pixels specified.
@@ -22,8 +108,47 @@ struct Layer
 	void MoveImage(int offsetX, int offsetY);
 
 	/*
-	 *	Warps the pixmap using inverse mapping and stores the output in warpedImageData.
-	 *	Also correctly sets the warp matrix and output dimensions.
+	 *	Warps the pixmap using inverse mapping and stores the output in warpedImage
+	 *	(unless the warp is deferred, see DeferWarp). Also correctly sets the warp
+	 *	matrix, plan and output dimensions.
+	 *	Rows are split into bands that run in parallel on WorkerPool::Get().
+	 *	The identity costs nothing (see WarpedView), whole pixel translations
+	 *	are row copies, and affine warps skip the perspective divide.
 	 */
 	void InvWarpLayer(const Matrix3D& M);
+
+	/*
+	 *	Warps the image so its corners (lower left, lower right, upper right,
+	 *	upper left) land on "corners", given in the same space as the raster
+	 *	position; warpMatrix is then relative to the old raster position.
+	 *	Returns false, leaving the layer as it was, if the corners are collinear,
+	 *	repeated or not finite, or don't span a whole pixel either way.
+	 */
+	bool WarpToCorners(const Point corners[4]);
+
+	/*
+	 *	Where the image's four corners (same order as above) and center end up
+	 *	under the current warp, including the raster position.
+	 */
+	void MapCorners(Point points[5]) const;
+
+	/*
+	 *	Inverse maps output rows [yBegin, yEnd) into the already allocated
+	 *	warpedImage, only running the kernel on the part of each row inside
+	 *	"clip", a block of warpBlockWidth columns at a time. Rows are warped
+	 *	through WarpTiles unless warpTolerance is 0 or part of the source is
+	 *	behind the viewer. Safe to call concurrently on disjoint row ranges.
+	 */
+	void WarpRows(const Matrix3D& invM, const WarpClipQuad& clip, int yBegin, int yEnd);
+
+	/*
+	 *	WarpRows for a whole pixel translation: output pixel (x, y) is source
+	 *	pixel (x - offsetX, y - offsetY), so rows are copied instead of sampled.
+	 */
+	void TranslateRows(int offsetX, int offsetY, int yBegin, int yEnd);
+
+	/*
+	 *	Allocates warpedImage and warps the current plan into it, in parallel.
+	 */
+	void WarpOutput();
 };
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "PixelRGBA.h"
+#include "WarpKernels.h"
+
+/*
+ *	Chain of 2x box filtered copies of an image, down to 1x1. Level 0 is the
+ *	original pixels (not copied, so they have to outlive the pyramid); each level
+ *	after that is (width + 1) / 2 by (height + 1) / 2 of the one before it.
+ *
+ *	Minified warps sample the level whose texels are about as big as an output
+ *	pixel's footprint, which keeps them from aliasing and means they only touch
+ *	as much source memory as they need.
+ */
+struct MipPyramid
+{
+	std::vector<WarpSource> levels;
+	std::vector<Image<PixelRGBA>> levelImages;		// Storage for levels 1 and up
+
+	/*
+	 *	Rebuilds every level from "image", using the downsample kernel from
+	 *	GetWarpKernels() on every thread of the pool.
+	 */
+	void Build(const WarpSource& image);
+
+	/*
+	 *	Drops every level. Call whenever the source pixels change or are freed.
+	 */
+	void Clear();
+
+	bool IsBuilt() const;
+};
+
+/*
+ *	Trilinear warp of one span. The mip level is picked per tile of a few pixels
+ *	from the inverse warp's Jacobian at the tile's center, then the two nearest
+ *	levels are sampled with the bilinear kernel and blended.
+ */
+void WarpSpanTrilinear(const MipPyramid& mips, const WarpSpan& span, PixelRGBA* out);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "PixelRGBA.h"
+#include "CpuFeatures.h"
+
+/*
+ *	Converts one row of "width" interleaved source pixels into RGBA8. Sources
+ *	have 1 (gray), 2 (gray + alpha), 3 (RGB) or 4 (RGBA) channels of 8 or 16-bit
+ *	samples. Gray is copied into red, green and blue, missing alpha becomes 255,
+ *	and 16-bit samples are rounded to the nearest 8-bit value (v / 257).
+ */
+typedef void (*ConvertRowFunc)(const void* source, int width, PixelRGBA* out);
+
+/*
+ *	Converter for the given source layout (channels 1 - 4) using the widest
+ *	instruction set DetectSimdLevel() reports.
+ */
+ConvertRowFunc GetConvertRowFunc(int channels, bool sixteenBit);
+
+// Per instruction set implementations. Only call the ones the CPU supports.
+ConvertRowFunc GetConvertRowFuncScalar(int channels, bool sixteenBit);
+ConvertRowFunc GetConvertRowFuncSSE41(int channels, bool sixteenBit);
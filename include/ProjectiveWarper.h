@@ -1,6 +1,5 @@
 #pragma once
 
-#include <OpenImageIO/imageio.h>
 #include <GL/glut.h>
 
 #include <string>
@@ -8,10 +7,8 @@
 #include <iostream>
 #include <memory>
 
-#include "Layer.h"
-#include "Point.h"
+#include "WarpCore.h"
 
-OIIO_NAMESPACE_USING
 #define PROGRAM_NAME "Projective Warper"
 
 class ProjectiveWarper
@@ -47,6 +44,17 @@ private:
 	bool leftMousePressedLastFrame = false;
 	bool saveWindowThisFrame = false;
 
+	TileCompositor compositor;
+	Image<PixelRGBA> frame;						// Window contents, composited on the CPU and uploaded once per frame
+	DamageTracker damage;						// What changed in the frame since the last redisplay
+	DamageRect drawnIcons[5];					// Where the icons went last frame (see activeLayerBoundPoints)
+	int drawnIconCount = 0;
+	bool redisplayRequested = false;			// A redisplay we asked for, rather than the window being exposed
+	bool windowContentsLost = true;				// Resized, covered or uncovered since the last frame, so it all goes up again
+
+	void RequestRedisplay();
+	void UploadFrame(const DamageRect& rect);
+
 public:
 
 	ProjectiveWarper();
@@ -58,7 +66,8 @@ public:
 	bool AddLayer();
 	bool DeleteLayer(const int& layer);
 	bool ResetLayer(const int& layer);
-	void RenderLayer(const Layer* rendLayer);
+	bool CycleLayerFilter(const int& layer);
+	void RenderLayer(const Layer* rendLayer, const DamageRect& region);
 	void ProjectiveWarpLayer(Layer* warpLayer);
 	void MapSelectedLayerPoints();
 	void ResetMouseStates();
@@ -67,6 +76,7 @@ public:
 	// tied to a class and can actually be used by glut!
 	void DisplayLayers();
 	void HandleWindowReshape(int newWidth, int newHeight);
+	void HandleWindowStatus(int state);
 	void HandleKeyPresses(unsigned char key, int x, int y);
 	void HandleSpecialKeyPresses(int key, int x, int y);
 	void HandleMouseDownEvent(int button, int state, int x, int y);
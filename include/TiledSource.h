@@ -0,0 +1,37 @@
+#pragma once
+
+#include "PixelRGBA.h"
+#include "WarpKernels.h"
+
+/*
+ *	Copy of a source image in the tiled layout (see TiledRowOffset), for the
+ *	*Tiled warp kernels.
+ *
+ *	In the plain layout, a span that runs down the source (a 90 degree rotation)
+ *	or across it at an angle touches a new cache line, and for images over 1024
+ *	pixels wide a new page, for nearly every output pixel. With 8x8 tiles one cache
+ *	line holds 2 rows of 8 pixels, so nearby samples share lines in every
+ *	direction. Only the Nearest kernels come out ahead, and only on rotated or
+ *	skewed warps: unrotated ones get 1.1-1.2x slower (a row now crosses a tile
+ *	every 8 pixels), and the filtered kernels' row pair loads straddle tiles
+ *	(see Layer::InvWarpLayer).
+ */
+struct TiledSource
+{
+	WarpSource view;			// Width, height and tile row stride of the tiled pixels; empty until built
+	Image<PixelRGBA> storage;	// One image row per row of tiles; edge tiles are padded with transparent pixels
+
+	TiledSource();
+
+	/*
+	 *	Rebuilds the tiled copy of "image", one row of tiles per task on WorkerPool::Get().
+	 */
+	void Build(const WarpSource& image);
+
+	/*
+	 *	Drops the copy. Call whenever the source pixels change or are freed.
+	 */
+	void Clear();
+
+	bool IsBuilt() const;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+/*
+ *	Public C++ API of the warp core library: everything needed to load images,
+ *	solve and apply projective warps, and composite layers, with no dependency on
+ *	GLUT or a window. The interactive ProjectiveWarper app is one client of it;
+ *	WarpCoreC.h wraps the same functionality in a plain C interface.
+ */
+
+#include "Image.h"
+#include "PixelRGBA.h"
+#include "Point.h"
+#include "EigenMatrix.h"
+#include "CpuFeatures.h"
+#include "WorkerPool.h"
+#include "WarpKernels.h"
+#include "Homography.h"
+#include "HomographyBatch.h"
+#include "HomographyRansac.h"
+#include "Layer.h"
+#include "ImageIO.h"
+#include "DamageTracker.h"
+#include "Compositor.h"
+#include "WarpManifest.h"
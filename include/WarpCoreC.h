@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+ *	Plain C interface to the warp core library, for callers that can't use the
+ *	C++ API directly (other languages, other compilers). Layers are opaque
+ *	handles. Functions returning int return 1 on success and 0 on failure, with
+ *	the reason available from WarpCore_LastError() on the same thread.
+ *
+ *	Corners and points are (x, y) pairs in the order lower left, lower right,
+ *	upper right, upper left, with y going up (the same space as the window).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct WarpCoreLayer WarpCoreLayer;
+
+/* Same values as the C++ WarpFilter enum. */
+enum WarpCoreFilter
+{
+	WARP_CORE_FILTER_NEAREST = 0,
+	WARP_CORE_FILTER_BILINEAR = 1,
+	WARP_CORE_FILTER_BICUBIC = 2,
+	WARP_CORE_FILTER_TRILINEAR = 3
+};
+
+/*
+ *	Warped (or unwarped) pixels of a layer. "rgba" points at the bottom row, rows
+ *	are "strideBytes" apart, and (originX, originY) is where the lower left pixel sits.
+ *	Only valid until the layer is warped again or freed.
+ */
+typedef struct WarpCorePixels
+{
+	const unsigned char* rgba;
+	int width, height;
+	int strideBytes;
+	int originX, originY;
+} WarpCorePixels;
+
+const char* WarpCore_LastError(void);
+
+/* Threads used for warping and compositing; <= 0 uses every hardware thread. */
+void WarpCore_SetThreadCount(int count);
+
+WarpCoreLayer* WarpCore_LoadLayer(const char* path);
+void WarpCore_FreeLayer(WarpCoreLayer* layer);
+void WarpCore_GetLayerSize(const WarpCoreLayer* layer, int* width, int* height);
+int WarpCore_SetLayerFilter(WarpCoreLayer* layer, int filter);
+
+/* Warps the layer's image so its corners land on corners[8]. Fails, leaving the
+   layer as it was, if the corners are collinear, repeated or not finite. */
+int WarpCore_WarpLayerToCorners(WarpCoreLayer* layer, const double corners[8]);
+int WarpCore_GetWarpedPixels(const WarpCoreLayer* layer, WarpCorePixels* pixels);
+
+/* Saves only the layer's warped pixels. */
+int WarpCore_SaveWarpedLayer(const WarpCoreLayer* layer, const char* path);
+
+/*
+ *	With "deferred" set, the layer's warps only record the mapping, and
+ *	WarpCore_SaveComposite samples its source directly, so a layer that's just
+ *	composited never holds a warped copy. Its warped pixels can't be read or
+ *	saved until this is called again with "deferred" 0.
+ */
+int WarpCore_SetLayerDeferred(WarpCoreLayer* layer, int deferred);
+
+/*
+ *	Composites "count" layers (first one at the bottom) over a transparent
+ *	(width x height) canvas and saves it to "path".
+ */
+int WarpCore_SaveComposite(const WarpCoreLayer* const* layers, int count, int width, int height, const char* path);
+
+/* Row-major 3x3 matrix taking src[i] to dst[i], for four (x, y) pairs each, in
+   double precision. Fails, leaving matrix untouched, for degenerate points. */
+int WarpCore_SolveHomography(const double src[8], const double dst[8], double matrix[9]);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
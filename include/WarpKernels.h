@@ -0,0 +1,275 @@
+#pragma once
+
+#include "PixelRGBA.h"
+#include "CpuFeatures.h"
+#include "EigenMatrix.h"
+
+#include <vector>
+
+// Pixels a kernel may step incrementally before recomputing exact coordinates.
+static const int WARP_ANCHOR_SPAN = 64;
+
+/*
+ *	How a warp reconstructs the source between pixel centers.
+ */
+enum class WarpFilter
+{
+	Nearest = 0,
+	Bilinear,
+	Bicubic,			// Catmull-Rom
+	Trilinear,			// Bilinear between the two nearest mip levels (see MipPyramid.h)
+	Count
+};
+
+const char* WarpFilterName(WarpFilter filter);
+
+// Looks up a filter by its WarpFilterName, ignoring case. False if there's no such filter.
+bool ParseWarpFilter(const char* name, WarpFilter& filter);
+
+/*
+ *	Source image a warp kernel samples from. Rows are "stride" pixels apart,
+ *	and pixels outside [0, width) x [0, height) come out fully transparent.
+ */
+typedef ImageView<const PixelRGBA> WarpSource;
+
+/*
+ *	Tiled source layout (see TiledSource.h): the image is cut into
+ *	WARP_SOURCE_TILE x WARP_SOURCE_TILE pixel tiles, each one stored as a single
+ *	contiguous block, with the tiles themselves in row order. "stride" of a tiled
+ *	WarpSource is the pixel count of one row of tiles. A pixel's index is the sum
+ *	of an offset for its row and one for its column, so the filtered kernels
+ *	clamp their taps per axis exactly as they do for the plain layout.
+ */
+static const int WARP_SOURCE_TILE_SHIFT = 3;
+static const int WARP_SOURCE_TILE = 1 << WARP_SOURCE_TILE_SHIFT;
+
+inline ptrdiff_t TiledRowOffset(int y, int stride)
+{
+	return (ptrdiff_t)(y >> WARP_SOURCE_TILE_SHIFT) * stride + ((y & (WARP_SOURCE_TILE - 1)) << WARP_SOURCE_TILE_SHIFT);
+}
+
+inline int TiledColumnOffset(int x)
+{
+	return ((x >> WARP_SOURCE_TILE_SHIFT) << (2 * WARP_SOURCE_TILE_SHIFT)) + (x & (WARP_SOURCE_TILE - 1));
+}
+
+/*
+ *	One horizontal run of output pixels. (u, v, w) are the homogeneous source
+ *	coordinates of the first pixel and step* is how much they change for each
+ *	pixel to the right (the first column of the inverse warp matrix). down*
+ *	is the same for one row down (the second column); only filters that need
+ *	the pixel's footprint in the source, like Trilinear, look at it.
+ *
+ *	An affine span (w = 1 and stepW = 0) has (u, v) linear along it, and the
+ *	kernels skip the per pixel divide for those.
+ */
+struct WarpSpan
+{
+	double u, v, w;
+	double stepU, stepV, stepW;
+	double downU, downV, downW;
+	int count;
+
+	bool IsAffine() const { return w == 1.0 && stepW == 0.0; }
+};
+
+/*
+ *	The simplest kind of mapping a warp matrix amounts to, which decides how
+ *	much work Layer::InvWarpLayer has to do.
+ */
+enum class WarpKind
+{
+	Identity,			// Output is the source itself
+	Translation,		// Whole pixel offset: output rows are copies of source rows
+	Affine,				// No perspective: source positions are linear along every row
+	Projective
+};
+
+// How far, in output pixels, a matrix's mapping of the source corners may move
+// when it's snapped to a simpler kind. Far below anything a filter can show.
+static const double WARP_SNAP_TOLERANCE = 1e-3;
+
+/*
+ *	Classifies M as applied to a (width x height) source, writing the matrix to
+ *	warp with into "snapped": M with its perspective row set to exactly (0, 0, 1),
+ *	or its linear part to the identity and its offset rounded, whenever that
+ *	moves none of the source's corners by more than WARP_SNAP_TOLERANCE. Solved
+ *	matrices rarely come out with those entries exact even when they should.
+ */
+WarpKind ClassifyWarp(const Matrix3D& M, int width, int height, Matrix3D& snapped);
+
+/*
+ *	Output space outline of everything a warp can sample from the source,
+ *	i.e. the forward mapped rectangle (-0.5, -0.5) to (width - 0.5, height - 0.5).
+ *	Intersecting a scanline with its edges gives the only part of that row that
+ *	needs inverse mapping; everything else is known to be transparent.
+ */
+struct WarpClipQuad
+{
+	double x[4], y[4];
+	bool valid = false;	// False if part of the source maps behind the viewer (w <= 0)
+
+	/*
+	 *	With "inset", the source rectangle is first shrunk by that many source
+	 *	pixels on every side. The quad is invalid if nothing is left of it.
+	 */
+	void Build(const Matrix3D& M, int width, int height, double inset = 0.0);
+
+	/*
+	 *	Finds [xStart, xEnd) of output "row" (clamped to [0, rowWidth)) that may
+	 *	land inside the source. The span is padded by a pixel on each side, so
+	 *	kernels still bounds check, but never miss a pixel. Returns false if the
+	 *	row misses the quad entirely. Invalid quads always return the whole row.
+	 */
+	bool RowSpan(int row, int rowWidth, int& xStart, int& xEnd) const;
+
+	/*
+	 *	Finds [xStart, xEnd), the pixels of output "row" whose centers are inside
+	 *	the quad, unpadded and unclamped. Returns false if there are none or the
+	 *	quad is invalid.
+	 */
+	bool InnerSpan(int row, int& xStart, int& xEnd) const;
+
+	/*
+	 *	Whether the box (x0, y0) to (x1, y1) lies entirely inside the quad.
+	 *	Always false for an invalid quad.
+	 */
+	bool ContainsBox(double x0, double y0, double x1, double y1) const;
+};
+
+// Default for Layer::warpTolerance: exact. The vector kernels replace the
+// divide with a reciprocal estimate that costs next to nothing beside their
+// loads, so approximating only pays off with the scalar and SSE4.1 kernels.
+// Something like 1/16 of a pixel is invisible with the filtered kernels.
+static const double WARP_DEFAULT_TOLERANCE = 0.0;
+
+// Size, in output pixels, of the tiles the perspective approximation starts
+// from, and the smallest it subdivides them to before warping exactly; an affine
+// span shorter than that saves less than its setup costs.
+static const int WARP_TILE_SIZE = 128;
+static const int WARP_MIN_TILE_SIZE = 16;
+
+/*
+ *	Perspective approximation: inside a small enough rectangle of output pixels,
+ *	a homography is close to affine. A tile only evaluates the inverse warp
+ *	exactly at its corners (x0, y0), (x1, y0), (x1, y1), (x0, y1), giving source
+ *	positions (u[i], v[i]), and interpolates bilinearly in between. Along a row
+ *	that's linear in x, so each row of a tile warps as one affine span.
+ *
+ *	"exact" tiles are the ones the approximation wasn't good enough for; their
+ *	rows go through the full projective span instead.
+ */
+struct WarpTile
+{
+	int x0, y0, x1, y1;			// Covers pixels [x0, x1) x [y0, y1)
+	bool exact;
+	double u[4], v[4];
+
+	// Affine span for pixels [xStart, xEnd) of output row y, all inside the tile.
+	void RowSpan(int y, int xStart, int xEnd, WarpSpan& span) const;
+};
+
+/*
+ *	Covers output pixels [xBegin, xEnd) x [yBegin, yEnd) with WARP_TILE_SIZE
+ *	tiles (appended to "tiles"), halving the longer side of any whose
+ *	interpolated source position is off by more than "tolerance" source pixels
+ *	at its center or the middle of an edge, down to WARP_MIN_TILE_SIZE. Tiles
+ *	still too far off then, or with a corner at or behind the horizon (w <= 0),
+ *	are marked exact.
+ */
+void BuildWarpTiles(const Matrix3D& invM, int xBegin, int yBegin, int xEnd, int yEnd,
+	double tolerance, std::vector<WarpTile>& tiles);
+
+// Source bytes the footprint of one block of a warp's output should fit in:
+// about half of a typical L2, leaving the rest for the output rows and mip levels.
+static const double WARP_BLOCK_CACHE_BYTES = 256.0 * 1024.0;
+
+// Most source rows (tile rows when tiled) a block may read from one column of
+// cache lines. Rows are usually a power of two bytes apart, so lines at the same
+// offset in each row compete for a handful of cache sets and start evicting
+// each other long before the cache is full; this is what limits blocks of a
+// warp walking (nearly) straight down the source.
+static const double WARP_BLOCK_SHARED_ROWS = 256.0;
+
+// Range of output block widths ChooseWarpBlockWidth picks from. Block widths are
+// kept a multiple of WARP_ANCHOR_SPAN (of WARP_TILE_SIZE when a warpTolerance
+// approximates the warp), so splitting a row into blocks doesn't move where the
+// kernels re-anchor (see Layer::WarpRows).
+static const int WARP_MIN_BLOCK_WIDTH = WARP_ANCHOR_SPAN;
+static const int WARP_MAX_BLOCK_WIDTH = 1 << 16;
+
+/*
+ *	Cache blocking: a band of output rows warped a full row at a time reuses a
+ *	source line only after a whole row has gone by, which for a rotated warp is
+ *	a cache line (and often a page) per pixel. Warping it in blocks of columns
+ *	instead keeps each block's footprint in the source small enough to stay cached.
+ *
+ *	Returns the widest power of two block (in output pixels, for a band "rows"
+ *	tall) whose source footprint, estimated from the inverse warp's Jacobian at
+ *	output pixel (x, y), fits in WARP_BLOCK_CACHE_BYTES and WARP_BLOCK_SHARED_ROWS.
+ *	"tiled" says whether the source is in the tiled layout.
+ */
+int ChooseWarpBlockWidth(const Matrix3D& invM, int x, int y, int rows, bool tiled);
+
+/*
+ *	A kernel writes span.count pixels into "out" by inverse mapping each one
+ *	into the source image.
+ */
+typedef void (*WarpSpanFunc)(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+
+/*
+ *	Box filters source rows "top" and "bottom" (srcWidth pixels each) into one
+ *	row of (srcWidth + 1) / 2 pixels. An odd last column is averaged with itself.
+ */
+typedef void (*MipDownsampleFunc)(const PixelRGBA* top, const PixelRGBA* bottom, int srcWidth, PixelRGBA* out);
+
+struct WarpKernelTable
+{
+	SimdLevel level;
+	WarpSpanFunc nearest;
+	WarpSpanFunc bilinear;
+	WarpSpanFunc bicubic;
+	WarpSpanFunc nearestTiled;		// Same filters, for sources in the tiled layout
+	WarpSpanFunc bilinearTiled;
+	WarpSpanFunc bicubicTiled;
+	MipDownsampleFunc downsample;
+
+	// Trilinear has no kernel of its own (it runs bilinear per mip level), so it gets bilinear here.
+	// Mip levels are never tiled, so Trilinear sources shouldn't be either.
+
+	WarpSpanFunc Get(WarpFilter filter, bool tiled = false) const;
+};
+
+/*
+ *	Kernels picked for the widest instruction set DetectSimdLevel() reports.
+ *	SetWarpSimdLevel can lower (never raise) that choice, which is mostly useful
+ *	for comparing kernels; don't call it while a warp is running.
+ */
+const WarpKernelTable& GetWarpKernels();
+void SetWarpSimdLevel(SimdLevel level);
+
+// Per instruction set implementations. Only call the ones the CPU supports.
+void WarpSpanNearestScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBilinearScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBicubicScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanNearestTiledScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBilinearTiledScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBicubicTiledScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanNearestSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBilinearSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBicubicSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanNearestTiledSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBilinearTiledSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBicubicTiledSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanNearestAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBilinearAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBicubicAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanNearestTiledAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBilinearTiledAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBicubicTiledAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanNearestAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBilinearAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanBicubicAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void WarpSpanNearestTiledAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out);
+void MipDownsampleScalar(const PixelRGBA* top, const PixelRGBA* bottom, int srcWidth, PixelRGBA* out);
+void MipDownsampleAVX2(const PixelRGBA* top, const PixelRGBA* bottom, int srcWidth, PixelRGBA* out);
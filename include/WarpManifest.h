@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Point.h"
+#include "WarpKernels.h"
+
+/*
+ *	One image to warp: "input" is warped so its corners (lower left, lower right,
+ *	upper right, upper left, y up like the rest of the warper) land on "corners",
+ *	and the warped image's bounding box is written to "output".
+ */
+struct WarpJob
+{
+	std::string input;
+	std::string output;
+	Point corners[4];
+	WarpFilter filter;
+	int sourceLine;				// Manifest line the job came from, for error messages
+};
+
+/*
+ *	Reads a list of warp jobs from a CSV or JSON manifest (picked by whether the
+ *	file starts with '[' or '{'). Jobs that don't name a filter get "defaultFilter".
+ *
+ *	CSV: one job per line as
+ *		input, x0, y0, x1, y1, x2, y2, x3, y3, output [, filter]
+ *	Fields may be double quoted (with "" for a quote) to hold commas. Blank lines,
+ *	lines starting with '#', and a header line whose first field is "input" are skipped.
+ *
+ *	JSON: an array of jobs, or an object with a "jobs" array, each one like
+ *		{ "input": "a.png", "corners": [[x0, y0], [x1, y1], [x2, y2], [x3, y3]],
+ *		  "output": "b.png", "filter": "bilinear" }
+ *	where "corners" may also be a flat array of 8 numbers and "filter" is optional.
+ *
+ *	On failure returns false with the reason (and line) in "error".
+ */
+bool ReadWarpManifest(const std::string& path, WarpFilter defaultFilter,
+	std::vector<WarpJob>& jobs, std::string& error);
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "WarpKernels.h"
+
+/*
+ *	Scalar samplers shared by every kernel that can't vectorize a pixel (the
+ *	scalar kernels and the leftover lanes of the vector ones). (u, v) is a source
+ *	position with pixel centers on integers, already known to be inside
+ *	(-0.5, width - 0.5) x (-0.5, height - 0.5). Filter taps falling off the
+ *	image are clamped to the nearest edge pixel. With Tiled, the source is in
+ *	the tiled layout (see TiledRowOffset).
+ */
+
+inline int ClampToRange(int value, int maxValue)
+{
+	return (value < 0) ? 0 : (value > maxValue) ? maxValue : value;
+}
+
+template <bool Tiled>
+inline const PixelRGBA& SourcePixel(const WarpSource& src, int x, int y)
+{
+	return Tiled ? src.pixels[TiledRowOffset(y, src.stride) + TiledColumnOffset(x)] : src.pixels[(ptrdiff_t)y * src.stride + x];
+}
+
+template <bool Tiled>
+inline PixelRGBA SampleNearest(const WarpSource& src, double u, double v)
+{
+	return SourcePixel<Tiled>(src, (int)(u + 0.5), (int)(v + 0.5));
+}
+
+/*
+ *	Fractions are quantized to 1/256 of a pixel and blended in fixed point,
+ *	the same way the vector kernels do it, so both agree up to the rounding
+ *	of the source position itself.
+ */
+template <bool Tiled>
+inline PixelRGBA SampleBilinear(const WarpSource& src, double u, double v)
+{
+	double floorU = std::floor(u), floorV = std::floor(v);
+	int weightX = (int)std::lround((u - floorU) * 256.0), weightY = (int)std::lround((v - floorV) * 256.0);
+	int x0 = ClampToRange((int)floorU, src.width - 1), x1 = ClampToRange((int)floorU + 1, src.width - 1);
+	int y0 = ClampToRange((int)floorV, src.height - 1), y1 = ClampToRange((int)floorV + 1, src.height - 1);
+
+	const unsigned char* p00 = &SourcePixel<Tiled>(src, x0, y0).r;
+	const unsigned char* p10 = &SourcePixel<Tiled>(src, x1, y0).r;
+	const unsigned char* p01 = &SourcePixel<Tiled>(src, x0, y1).r;
+	const unsigned char* p11 = &SourcePixel<Tiled>(src, x1, y1).r;
+
+	unsigned char result[4];
+	for (int c = 0; c < 4; c++)
+	{
+		int top = (p00[c] * (256 - weightX) + p10[c] * weightX + 128) >> 8;
+		int bottom = (p01[c] * (256 - weightX) + p11[c] * weightX + 128) >> 8;
+		result[c] = (unsigned char)((top * (256 - weightY) + bottom * weightY + 128) >> 8);
+	}
+	return { result[0], result[1], result[2], result[3] };
+}
+
+/*
+ *	Catmull-Rom in fixed point, so the vector kernels can blend with 16-bit
+ *	multiply-adds and come out the same. Fractions are quantized to 1/256 of a
+ *	pixel like bilinear's, and each one's four tap weights are looked up in
+ *	catmullRomTable, scaled by 2^BICUBIC_WEIGHT_BITS and summing to exactly
+ *	that (so flat areas stay flat). A row of taps is blended first, dropped by
+ *	BICUBIC_ROW_SHIFT bits to fit 16 bits, then the four rows are blended.
+ */
+static const int BICUBIC_WEIGHT_BITS = 14;
+static const int BICUBIC_ROW_SHIFT = 8;
+static const int BICUBIC_FINAL_SHIFT = 2 * BICUBIC_WEIGHT_BITS - BICUBIC_ROW_SHIFT;
+
+struct alignas(8) CatmullRomTaps
+{
+	short weight[4];
+};
+
+// Entries for fractions 0/256 to 256/256. Filled in by static initialization,
+// so the kernels index it directly rather than through a function.
+struct CatmullRomTable
+{
+	CatmullRomTaps taps[257];
+
+	CatmullRomTable();
+};
+
+extern const CatmullRomTable catmullRomTable;
+
+inline int CatmullRomIndex(double t)
+{
+	return (int)std::lround(t * 256.0);
+}
+
+/*
+ *	One output channel from four rows of tap sums (see above).
+ */
+inline unsigned char CatmullRomColumn(const int rows[4], const CatmullRomTaps& taps)
+{
+	int sum = 1 << (BICUBIC_FINAL_SHIFT - 1);
+	for (int j = 0; j < 4; j++)
+		sum += taps.weight[j] * (short)(rows[j] >> BICUBIC_ROW_SHIFT);
+	sum >>= BICUBIC_FINAL_SHIFT;
+
+	// Catmull-Rom overshoots near hard edges, so this clamps.
+	return (unsigned char)((sum < 0) ? 0 : (sum > 255) ? 255 : sum);
+}
+
+template <bool Tiled>
+inline PixelRGBA SampleBicubic(const WarpSource& src, double u, double v)
+{
+	double floorU = std::floor(u), floorV = std::floor(v);
+	const CatmullRomTaps& tapsX = catmullRomTable.taps[CatmullRomIndex(u - floorU)];
+	const CatmullRomTaps& tapsY = catmullRomTable.taps[CatmullRomIndex(v - floorV)];
+
+	int columns[4];
+	for (int i = 0; i < 4; i++)
+		columns[i] = ClampToRange((int)floorU - 1 + i, src.width - 1);
+
+	int rows[4][4];
+	for (int j = 0; j < 4; j++)
+	{
+		int row = ClampToRange((int)floorV - 1 + j, src.height - 1);
+		for (int c = 0; c < 4; c++)
+			rows[c][j] = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			const unsigned char* p = &SourcePixel<Tiled>(src, columns[i], row).r;
+			for (int c = 0; c < 4; c++)
+				rows[c][j] += tapsX.weight[i] * p[c];
+		}
+	}
+	return { CatmullRomColumn(rows[0], tapsY), CatmullRomColumn(rows[1], tapsY),
+		CatmullRomColumn(rows[2], tapsY), CatmullRomColumn(rows[3], tapsY) };
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ *	Small persistent pool of worker threads used to split per-pixel work
+ *	(like warping a layer) into independent tasks that run on every core.
+ *
+ *	The calling thread always takes part in the work, so a pool with a thread
+ *	count of 1 never spawns anything. Calls made while the pool is already busy
+ *	(nested calls, or several threads warping at once) just run inline.
+ */
+class WorkerPool
+{
+public:
+
+	static WorkerPool& Get();
+
+	~WorkerPool();
+
+	/*
+	 *	Sets how many threads (including the caller) run parallel work.
+	 *	A count <= 0 uses every hardware thread available.
+	 */
+	void SetThreadCount(int count);
+	int GetThreadCount() const;
+
+	/*
+	 *	Runs task(i) for every i in [0, taskCount) and returns once all of
+	 *	them are finished. Tasks are handed out one at a time, so they should
+	 *	be independent of each other and of the order they run in.
+	 */
+	void ParallelFor(int taskCount, const std::function<void(int)>& task);
+
+private:
+
+	WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	void StartWorkers(int count);
+	void StopWorkers();
+	void WorkerLoop(unsigned long long lastGeneration);
+	void RunTasks();
+
+	std::vector<std::thread> workers;
+	std::mutex busyMutex;						// Held by whoever is running a ParallelFor
+	std::mutex jobMutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+
+	const std::function<void(int)>* currentTask = nullptr;
+	int currentTaskCount = 0;
+	std::atomic<int> nextTask{ 0 };
+	int workersRunning = 0;
+	unsigned long long jobGeneration = 0;
+	bool stopping = false;
+};
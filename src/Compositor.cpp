@@ -0,0 +1,613 @@
+#include "Compositor.h"
+#include "WorkerPool.h"
+
+#include <cstring>
+#include <vector>
+
+// Number of target rows handed to a thread at a time while compositing.
+static const int COMPOSITE_BAND_ROWS = 32;
+
+static void BlendRowScalar(const PixelRGBA* source, int width, PixelRGBA* target)
+{
+    for (int x = 0; x < width; x++)
+    {
+        const unsigned char* src = &source[x].r;
+        unsigned char* dst = &target[x].r;
+        const int alpha = src[3];
+        if (alpha == 0) continue;
+
+        // dst = src * a + dst * (1 - a), rounded, with a in [0, 255].
+        for (int c = 0; c < 4; c++)
+            dst[c] = (unsigned char)((src[c] * alpha + dst[c] * (255 - alpha) + 127) / 255);
+    }
+}
+
+BlendRowFunc GetBlendRowFuncScalar()
+{
+    return BlendRowScalar;
+}
+
+BlendRowFunc GetBlendRowFunc()
+{
+    // Blending is a handful of 16-bit multiplies per pixel; 256 bits already
+    // keep up with memory, so there's no AVX-512 version.
+    static const BlendRowFunc func = []
+    {
+        switch (DetectSimdLevel())
+        {
+            case SimdLevel::AVX512:
+            case SimdLevel::AVX2:   return GetBlendRowFuncAVX2();
+            case SimdLevel::SSE41:  return GetBlendRowFuncSSE41();
+            default:                return GetBlendRowFuncScalar();
+        }
+    }();
+    return func;
+}
+
+static void BlendStackRowScalar(const PixelRGBA* color, const unsigned char* transmittance, int width, PixelRGBA* target)
+{
+    for (int x = 0; x < width; x++)
+    {
+        const unsigned char* src = &color[x].r;
+        unsigned char* dst = &target[x].r;
+        const int through = transmittance[x];
+
+        // dst = C + dst * T, rounded, with T in [0, 255]. C already carries each
+        // layer's alpha, so it's added as is.
+        for (int c = 0; c < 4; c++)
+        {
+            int value = src[c] + (dst[c] * through + 127) / 255;
+            dst[c] = (unsigned char)((value < 255) ? value : 255);
+        }
+    }
+}
+
+BlendStackRowFunc GetBlendStackRowFuncScalar()
+{
+    return BlendStackRowScalar;
+}
+
+BlendStackRowFunc GetBlendStackRowFunc()
+{
+    static const BlendStackRowFunc func = []
+    {
+        switch (DetectSimdLevel())
+        {
+            case SimdLevel::AVX512:
+            case SimdLevel::AVX2:   return GetBlendStackRowFuncAVX2();
+            case SimdLevel::SSE41:  return GetBlendStackRowFuncSSE41();
+            default:                return GetBlendStackRowFuncScalar();
+        }
+    }();
+    return func;
+}
+
+/*
+ *  Overlap of a (width x height) box with its lower left at (x, y) and a
+ *  (targetWidth x targetHeight) target, in target coordinates. Returns false
+ *  if they don't overlap. Positions can be anywhere in int range (icons park
+ *  at INT_MIN), so the far edges are worked out in 64 bits.
+ */
+static bool ClipToTarget(int x, int y, int width, int height, int targetWidth, int targetHeight,
+    int& xBegin, int& yBegin, int& xEnd, int& yEnd)
+{
+    const long long right = (long long)x + width, top = (long long)y + height;
+    xBegin = (x > 0) ? x : 0;
+    yBegin = (y > 0) ? y : 0;
+    xEnd = (right < targetWidth) ? (int)right : targetWidth;
+    yEnd = (top < targetHeight) ? (int)top : targetHeight;
+    return xBegin < xEnd && yBegin < yEnd;
+}
+
+/*
+ *  This thread's buffer for Layer::OutputRow, at least "pixels" long. Kept
+ *  from call to call, so compositing every frame doesn't allocate.
+ */
+static PixelRGBA* RowScratch(size_t pixels)
+{
+    thread_local std::vector<PixelRGBA> scratch;
+    if (scratch.size() < pixels)
+        scratch.resize(pixels);
+    return scratch.data();
+}
+
+/*
+ *  Whether all "width" pixels have alpha 255. Checked a chunk at a time, so the
+ *  inner loop has no early exit and vectorizes.
+ */
+static bool RowOpaque(const PixelRGBA* row, int width)
+{
+    const int chunk = 64;
+    for (int begin = 0; begin < width; begin += chunk)
+    {
+        const int end = (begin + chunk < width) ? (begin + chunk) : width;
+        unsigned char alpha = 255;
+        for (int x = begin; x < end; x++)
+            alpha &= row[x].a;
+        if (alpha != 255)
+            return false;
+    }
+    return true;
+}
+
+static DamageRect WholeTarget(const ImageView<PixelRGBA>& target)
+{
+    return { 0, 0, target.width, target.height };
+}
+
+/*
+ *  Cuts "region" down to a (width x height) target. Returns false if nothing's left.
+ */
+static bool ClipRegion(DamageRect& region, int width, int height)
+{
+    region.x0 = (region.x0 > 0) ? region.x0 : 0;
+    region.y0 = (region.y0 > 0) ? region.y0 : 0;
+    region.x1 = (region.x1 < width) ? region.x1 : width;
+    region.y1 = (region.y1 < height) ? region.y1 : height;
+    return !region.Empty();
+}
+
+void ClearImage(const ImageView<PixelRGBA>& target, PixelRGBA color)
+{
+    for (int y = 0; y < target.height; y++)
+    {
+        PixelRGBA* row = target[y];
+        for (int x = 0; x < target.width; x++)
+            row[x] = color;
+    }
+}
+
+void CompositeLayer(const ImageView<PixelRGBA>& target, const Layer& layer)
+{
+    CompositeLayer(target, layer, WholeTarget(target));
+}
+
+void CompositeLayer(const ImageView<PixelRGBA>& target, const Layer& layer, const DamageRect& region)
+{
+    DamageRect clipped = region;
+    if (!ClipRegion(clipped, target.width, target.height)) return;
+
+    // Overlap of the layer and the region, in target coordinates.
+    int xBegin, yBegin, xEnd, yEnd;
+    if (!ClipToTarget(layer.rasterPosX, layer.rasterPosY, layer.outputWidth, layer.outputHeight,
+        target.width, target.height, xBegin, yBegin, xEnd, yEnd))
+        return;
+    xBegin = (xBegin > clipped.x0) ? xBegin : clipped.x0;
+    yBegin = (yBegin > clipped.y0) ? yBegin : clipped.y0;
+    xEnd = (xEnd < clipped.x1) ? xEnd : clipped.x1;
+    yEnd = (yEnd < clipped.y1) ? yEnd : clipped.y1;
+    if (xBegin >= xEnd || yBegin >= yEnd) return;
+
+    const BlendRowFunc blendRow = GetBlendRowFunc();
+    const int rows = yEnd - yBegin;
+    const int bandCount = (rows + COMPOSITE_BAND_ROWS - 1) / COMPOSITE_BAND_ROWS;
+    WorkerPool::Get().ParallelFor(bandCount, [&](int band)
+    {
+        int bandBegin = yBegin + band * COMPOSITE_BAND_ROWS;
+        int bandEnd = (bandBegin + COMPOSITE_BAND_ROWS < yEnd) ? (bandBegin + COMPOSITE_BAND_ROWS) : yEnd;
+        PixelRGBA* scratch = RowScratch(xEnd - xBegin + LAYER_ROW_SCRATCH_EXTRA);
+        for (int y = bandBegin; y < bandEnd; y++)
+        {
+            const PixelRGBA* sourceRow = layer.OutputRow(y - layer.rasterPosY, xBegin - layer.rasterPosX,
+                xEnd - layer.rasterPosX, scratch);
+            blendRow(sourceRow, xEnd - xBegin, target[y] + xBegin);
+        }
+    });
+}
+
+/*
+ *  Bounds of tile number "tile" of a (width x height) target split into
+ *  tilesX columns of tiles.
+ */
+static void TileBounds(int tile, int tilesX, int width, int height, int& left, int& bottom, int& right, int& top)
+{
+    left = (tile % tilesX) * COMPOSITE_TILE_WIDTH;
+    bottom = (tile / tilesX) * COMPOSITE_TILE_HEIGHT;
+    right = (left + COMPOSITE_TILE_WIDTH < width) ? (left + COMPOSITE_TILE_WIDTH) : width;
+    top = (bottom + COMPOSITE_TILE_HEIGHT < height) ? (bottom + COMPOSITE_TILE_HEIGHT) : height;
+}
+
+/*
+ *  Whether "layer" is certain to be opaque over all of the given tile (see
+ *  Layer::OpaqueOver), which hides whatever is under it there.
+ */
+static bool CoversTile(const Layer& layer, int left, int bottom, int right, int top)
+{
+    return layer.OpaqueOver(left - layer.rasterPosX, bottom - layer.rasterPosY,
+        right - layer.rasterPosX, top - layer.rasterPosY);
+}
+
+/*
+ *  Runs work(tile, left, bottom, right, top) in parallel on every tile of a
+ *  (width x height) target that "region" (already clipped to it) reaches,
+ *  with the tile's bounds cut down to the region.
+ */
+template <typename TileWork>
+static void ForEachTileIn(const DamageRect& region, int tilesX, int width, int height, const TileWork& work)
+{
+    const int firstX = region.x0 / COMPOSITE_TILE_WIDTH, lastX = (region.x1 - 1) / COMPOSITE_TILE_WIDTH;
+    const int firstY = region.y0 / COMPOSITE_TILE_HEIGHT, lastY = (region.y1 - 1) / COMPOSITE_TILE_HEIGHT;
+    const int columns = lastX - firstX + 1;
+    WorkerPool::Get().ParallelFor(columns * (lastY - firstY + 1), [&](int n)
+    {
+        const int tile = (firstY + n / columns) * tilesX + firstX + n % columns;
+        int left, bottom, right, top;
+        TileBounds(tile, tilesX, width, height, left, bottom, right, top);
+        left = (left > region.x0) ? left : region.x0;
+        bottom = (bottom > region.y0) ? bottom : region.y0;
+        right = (right < region.x1) ? right : region.x1;
+        top = (top < region.y1) ? top : region.y1;
+        work(tile, left, bottom, right, top);
+    });
+}
+
+/*
+ *  Part of a layer's box inside the given tile, in target coordinates. Returns
+ *  false if there isn't any.
+ */
+static bool ClipToTile(const Layer& layer, int width, int height,
+    int left, int bottom, int right, int top, int& xBegin, int& yBegin, int& xEnd, int& yEnd)
+{
+    if (!ClipToTarget(layer.rasterPosX, layer.rasterPosY, layer.outputWidth, layer.outputHeight, width, height,
+        xBegin, yBegin, xEnd, yEnd))
+        return false;
+    xBegin = (xBegin > left) ? xBegin : left;
+    yBegin = (yBegin > bottom) ? yBegin : bottom;
+    xEnd = (xEnd < right) ? xEnd : right;
+    yEnd = (yEnd < top) ? yEnd : top;
+    return xBegin < xEnd && yBegin < yEnd;
+}
+
+/*
+ *  Blends the part of "layer" inside the given tile over "target".
+ */
+static void BlendLayerInTile(const ImageView<PixelRGBA>& target, const Layer& layer,
+    int left, int bottom, int right, int top, BlendRowFunc blendRow)
+{
+    int xBegin, yBegin, xEnd, yEnd;
+    if (!ClipToTile(layer, target.width, target.height, left, bottom, right, top, xBegin, yBegin, xEnd, yEnd))
+        return;
+
+    PixelRGBA* scratch = RowScratch(xEnd - xBegin + LAYER_ROW_SCRATCH_EXTRA);
+    for (int y = yBegin; y < yEnd; y++)
+    {
+        const PixelRGBA* sourceRow = layer.OutputRow(y - layer.rasterPosY, xBegin - layer.rasterPosX,
+            xEnd - layer.rasterPosX, scratch);
+        blendRow(sourceRow, xEnd - xBegin, target[y] + xBegin);
+    }
+}
+
+/*
+ *  Adds the part of "layer" inside the given tile to a stack (see
+ *  BlendStackRowFunc): blends it over "color", and scales "transmittance" by
+ *  how much of each pixel it lets through, rounded like the blend itself.
+ */
+static void StackLayerInTile(const ImageView<PixelRGBA>& color, const ImageView<unsigned char>& transmittance,
+    const Layer& layer, int left, int bottom, int right, int top, BlendRowFunc blendRow)
+{
+    int xBegin, yBegin, xEnd, yEnd;
+    if (!ClipToTile(layer, color.width, color.height, left, bottom, right, top, xBegin, yBegin, xEnd, yEnd))
+        return;
+
+    PixelRGBA* scratch = RowScratch(xEnd - xBegin + LAYER_ROW_SCRATCH_EXTRA);
+    for (int y = yBegin; y < yEnd; y++)
+    {
+        const PixelRGBA* sourceRow = layer.OutputRow(y - layer.rasterPosY, xBegin - layer.rasterPosX,
+            xEnd - layer.rasterPosX, scratch);
+        blendRow(sourceRow, xEnd - xBegin, color[y] + xBegin);
+
+        unsigned char* row = transmittance[y] + xBegin;
+        for (int x = 0; x < xEnd - xBegin; x++)
+            row[x] = (unsigned char)((row[x] * (255 - sourceRow[x].a) + 127) / 255);
+    }
+}
+
+void TileCompositor::BinLayers(int width, int height, const Layer* const* layers, int count)
+{
+    // The bins keep their capacity from call to call; only a bigger target adds tiles.
+    tilesX = (width + COMPOSITE_TILE_WIDTH - 1) / COMPOSITE_TILE_WIDTH;
+    tilesY = (height + COMPOSITE_TILE_HEIGHT - 1) / COMPOSITE_TILE_HEIGHT;
+    if ((int)tileLayers.size() < tilesX * tilesY)
+        tileLayers.resize(tilesX * tilesY);
+    for (std::vector<int>& bin : tileLayers)
+        bin.clear();
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!layers[i]) continue;
+        int xBegin, yBegin, xEnd, yEnd;
+        if (!ClipToTarget(layers[i]->rasterPosX, layers[i]->rasterPosY, layers[i]->outputWidth, layers[i]->outputHeight,
+            width, height, xBegin, yBegin, xEnd, yEnd))
+            continue;
+
+        for (int tileY = yBegin / COMPOSITE_TILE_HEIGHT; tileY <= (yEnd - 1) / COMPOSITE_TILE_HEIGHT; tileY++)
+            for (int tileX = xBegin / COMPOSITE_TILE_WIDTH; tileX <= (xEnd - 1) / COMPOSITE_TILE_WIDTH; tileX++)
+                tileLayers[tileY * tilesX + tileX].push_back(i);
+    }
+
+    // Whatever is under the topmost layer that covers a whole tile opaquely is
+    // never sampled or blended there.
+    for (int tile = 0; tile < tilesX * tilesY; tile++)
+    {
+        std::vector<int>& bin = tileLayers[tile];
+        int left, bottom, right, top;
+        TileBounds(tile, tilesX, width, height, left, bottom, right, top);
+        for (int k = (int)bin.size() - 1; k > 0; k--)
+        {
+            if (CoversTile(*layers[bin[k]], left, bottom, right, top))
+            {
+                bin.erase(bin.begin(), bin.begin() + k);
+                break;
+            }
+        }
+    }
+}
+
+void TileCompositor::Composite(const ImageView<PixelRGBA>& target, const Layer* const* layers, int count,
+    PixelRGBA background)
+{
+    Composite(target, layers, count, background, WholeTarget(target));
+}
+
+void TileCompositor::Composite(const ImageView<PixelRGBA>& target, const Layer* const* layers, int count,
+    PixelRGBA background, const DamageRect& region)
+{
+    DamageRect clipped = region;
+    if (!ClipRegion(clipped, target.width, target.height)) return;
+    BinLayers(target.width, target.height, layers, count);
+
+    // Each tile goes a row at a time. The rows of the layers in the tile are
+    // fetched top first (sampled on the spot for deferred warps, see
+    // Layer::OutputRow), each cut down to what the opaque layers over it leave
+    // showing (see Layer::OpaqueSpan). Once that's nothing, or a layer's row
+    // turns out opaque across the whole tile, the layers under it aren't
+    // needed. Then it's blended bottom first over the background; opaque pixels
+    // replace whatever is under them exactly, so the result is the full back to
+    // front blend.
+    const BlendRowFunc blendRow = GetBlendRowFunc();
+    ForEachTileIn(clipped, tilesX, target.width, target.height, [&](int tile, int left, int bottom, int right, int top)
+    {
+        // Where each layer in the tile is, and the pieces of its row that show
+        // (with their own scratch, as they're all blended at the end).
+        struct RowPiece
+        {
+            int x, width;
+            const PixelRGBA* pixels;
+        };
+        struct TileLayer
+        {
+            const Layer* layer;
+            int xBegin, yBegin, xEnd, yEnd;
+            RowPiece pieces[2];
+            int pieceCount;
+        };
+        thread_local std::vector<TileLayer> tileLayer;
+        tileLayer.clear();
+        for (int i : tileLayers[tile])
+        {
+            TileLayer entry;
+            entry.layer = layers[i];
+            ClipToTile(*layers[i], target.width, target.height, left, bottom, right, top,
+                entry.xBegin, entry.yBegin, entry.xEnd, entry.yEnd);
+            tileLayer.push_back(entry);
+        }
+        const int count = (int)tileLayer.size();
+        const int stride = (right - left) + 2 * LAYER_ROW_SCRATCH_EXTRA;
+        PixelRGBA* scratch = RowScratch((size_t)stride * count);
+
+        for (int y = bottom; y < top; y++)
+        {
+            PixelRGBA* row = target[y];
+
+            // One run of pixels known to be hidden, [hiddenBegin, hiddenEnd).
+            // Opaque spans that don't touch it only replace it if they're longer.
+            int hiddenBegin = left, hiddenEnd = left;
+            int first = 0;
+            bool covered = false;
+            for (int n = count - 1; n >= 0 && !covered; n--)
+            {
+                TileLayer& entry = tileLayer[n];
+                entry.pieceCount = 0;
+                first = n;
+                if (y < entry.yBegin || y >= entry.yEnd)
+                    continue;
+
+                const Layer& layer = *entry.layer;
+                const int layerY = y - layer.rasterPosY;
+                PixelRGBA* slot = scratch + (size_t)stride * n;
+                auto fetch = [&](int begin, int end)
+                {
+                    if (begin >= end)
+                        return;
+                    RowPiece& piece = entry.pieces[entry.pieceCount++];
+                    piece.x = begin;
+                    piece.width = end - begin;
+                    piece.pixels = layer.OutputRow(layerY, begin - layer.rasterPosX, end - layer.rasterPosX, slot);
+                    slot += piece.width + LAYER_ROW_SCRATCH_EXTRA;
+                };
+                if (hiddenBegin < hiddenEnd)
+                {
+                    fetch(entry.xBegin, (entry.xEnd < hiddenBegin) ? entry.xEnd : hiddenBegin);
+                    fetch((entry.xBegin > hiddenEnd) ? entry.xBegin : hiddenEnd, entry.xEnd);
+                }
+                else
+                    fetch(entry.xBegin, entry.xEnd);
+
+                if (entry.pieceCount == 1 && entry.pieces[0].width == right - left &&
+                    RowOpaque(entry.pieces[0].pixels, right - left))
+                {
+                    covered = true;
+                    break;
+                }
+
+                int opaqueBegin, opaqueEnd;
+                if (!layer.OpaqueSpan(layerY, opaqueBegin, opaqueEnd))
+                    continue;
+                opaqueBegin = (opaqueBegin + layer.rasterPosX > left) ? (opaqueBegin + layer.rasterPosX) : left;
+                opaqueEnd = (opaqueEnd + layer.rasterPosX < right) ? (opaqueEnd + layer.rasterPosX) : right;
+                if (opaqueBegin >= opaqueEnd)
+                    continue;
+                if (hiddenBegin < hiddenEnd && opaqueBegin <= hiddenEnd && opaqueEnd >= hiddenBegin)
+                {
+                    hiddenBegin = (opaqueBegin < hiddenBegin) ? opaqueBegin : hiddenBegin;
+                    hiddenEnd = (opaqueEnd > hiddenEnd) ? opaqueEnd : hiddenEnd;
+                }
+                else if (opaqueEnd - opaqueBegin > hiddenEnd - hiddenBegin)
+                {
+                    hiddenBegin = opaqueBegin;
+                    hiddenEnd = opaqueEnd;
+                }
+                covered = (hiddenBegin == left && hiddenEnd == right);
+            }
+
+            if (!covered)
+            {
+                for (int x = left; x < right; x++)
+                    row[x] = background;
+                first = 0;
+            }
+            for (int n = first; n < count; n++)
+            {
+                const TileLayer& entry = tileLayer[n];
+                for (int k = 0; k < entry.pieceCount; k++)
+                    blendRow(entry.pieces[k].pixels, entry.pieces[k].width, row + entry.pieces[k].x);
+            }
+        }
+    });
+}
+
+void TileCompositor::InvalidateCaches()
+{
+    cachesValid = false;
+}
+
+bool TileCompositor::CachesMatch(const ImageView<PixelRGBA>& target, const Layer* const* layers, int count,
+    int active, PixelRGBA background) const
+{
+    if (!cachesValid || active != cachedActive || count != (int)cachedStack.size() ||
+        target.width != below.Width() || target.height != below.Height() ||
+        memcmp(&background, &cachedBackground, sizeof(PixelRGBA)) != 0)
+        return false;
+
+    // The active layer can change as it likes; every other one has to be where it was.
+    for (int i = 0; i < count; i++)
+    {
+        const CachedLayer& cached = cachedStack[i];
+        if (layers[i] != cached.layer)
+            return false;
+        if (i == active || !layers[i])
+            continue;
+
+        const ImageView<const PixelRGBA> source = layers[i]->WarpedView();
+        if (source.pixels != cached.pixels || layers[i]->outputWidth != cached.width ||
+            layers[i]->outputHeight != cached.height || layers[i]->rasterPosX != cached.x ||
+            layers[i]->rasterPosY != cached.y || layers[i]->warpMatrix != cached.matrix ||
+            layers[i]->filter != cached.filter)
+            return false;
+    }
+    return true;
+}
+
+void TileCompositor::BuildCaches(const ImageView<PixelRGBA>& target, const Layer* const* layers, int count,
+    int active, PixelRGBA background)
+{
+    below.Resize(target.width, target.height);
+    aboveColor.Resize(target.width, target.height);
+    aboveTransmittance.Resize(target.width, target.height);
+
+    Composite(below.View(), layers, active, background);
+
+    // The layers above make up a stack over transparent black, plus how much of
+    // whatever's under them shows through. Tiles none of them reach are never read.
+    const Layer* const* over = layers + active + 1;
+    BinLayers(target.width, target.height, over, count - active - 1);
+    aboveTiles.assign(tilesX * tilesY, 0);
+
+    const BlendRowFunc blendRow = GetBlendRowFunc();
+    const ImageView<PixelRGBA> color = aboveColor.View();
+    const ImageView<unsigned char> transmittance = aboveTransmittance.View();
+    WorkerPool::Get().ParallelFor(tilesX * tilesY, [&](int tile)
+    {
+        if (tileLayers[tile].empty()) return;
+
+        int left, bottom, right, top;
+        TileBounds(tile, tilesX, target.width, target.height, left, bottom, right, top);
+        aboveTiles[tile] = CoversTile(*over[tileLayers[tile][0]], left, bottom, right, top) ? 2 : 1;
+        for (int y = bottom; y < top; y++)
+        {
+            memset(color[y] + left, 0, sizeof(PixelRGBA) * (right - left));
+            memset(transmittance[y] + left, 255, right - left);
+        }
+
+        for (int i : tileLayers[tile])
+            StackLayerInTile(color, transmittance, *over[i], left, bottom, right, top, blendRow);
+    });
+
+    cachedStack.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        CachedLayer& cached = cachedStack[i];
+        cached.layer = layers[i];
+        if (!layers[i]) continue;
+
+        cached.pixels = layers[i]->WarpedView().pixels;
+        cached.width = layers[i]->outputWidth;
+        cached.height = layers[i]->outputHeight;
+        cached.x = layers[i]->rasterPosX;
+        cached.y = layers[i]->rasterPosY;
+        cached.matrix = layers[i]->warpMatrix;
+        cached.filter = layers[i]->filter;
+    }
+    cachedActive = active;
+    cachedBackground = background;
+    cachesValid = true;
+}
+
+void TileCompositor::CompositeAround(const ImageView<PixelRGBA>& target, const Layer* const* layers, int count,
+    int active, PixelRGBA background)
+{
+    CompositeAround(target, layers, count, active, background, WholeTarget(target));
+}
+
+void TileCompositor::CompositeAround(const ImageView<PixelRGBA>& target, const Layer* const* layers, int count,
+    int active, PixelRGBA background, const DamageRect& region)
+{
+    if (active < 0 || active >= count || !layers[active])
+    {
+        Composite(target, layers, count, background, region);
+        return;
+    }
+    DamageRect clipped = region;
+    if (!ClipRegion(clipped, target.width, target.height)) return;
+
+    if (!CachesMatch(target, layers, count, active, background))
+        BuildCaches(target, layers, count, active, background);
+    tilesX = (target.width + COMPOSITE_TILE_WIDTH - 1) / COMPOSITE_TILE_WIDTH;
+    tilesY = (target.height + COMPOSITE_TILE_HEIGHT - 1) / COMPOSITE_TILE_HEIGHT;
+
+    // Per tile: copy what's below, blend the active layer, then what's above.
+    const Layer& layer = *layers[active];
+    const BlendRowFunc blendRow = GetBlendRowFunc();
+    const BlendStackRowFunc blendStack = GetBlendStackRowFunc();
+    ForEachTileIn(clipped, tilesX, target.width, target.height, [&](int tile, int left, int bottom, int right, int top)
+    {
+        // Covered by the layers above: what's under them doesn't show through at all.
+        if (aboveTiles[tile] == 2)
+        {
+            for (int y = bottom; y < top; y++)
+                memcpy(target[y] + left, aboveColor[y] + left, sizeof(PixelRGBA) * (right - left));
+            return;
+        }
+
+        for (int y = bottom; y < top; y++)
+            memcpy(target[y] + left, below[y] + left, sizeof(PixelRGBA) * (right - left));
+
+        BlendLayerInTile(target, layer, left, bottom, right, top, blendRow);
+
+        if (aboveTiles[tile])
+        {
+            for (int y = bottom; y < top; y++)
+                blendStack(aboveColor[y] + left, aboveTransmittance[y] + left, right - left, target[y] + left);
+        }
+    });
+}
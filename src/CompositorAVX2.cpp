@@ -0,0 +1,94 @@
+#include "Compositor.h"
+
+#include <immintrin.h>
+
+/*
+ *  Same as the SSE4.1 version (see CompositorSSE41.cpp), 4 pixels per 128-bit
+ *  lane. Unpacking and packing both work within lanes, so pixels come back out
+ *  in the order they went in.
+ */
+TARGET_AVX2 static FORCE_INLINE __m256i BlendWide(__m256i source, __m256i target)
+{
+    const __m256i alphaSpread = _mm256_setr_epi8(
+        6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+        6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+    const __m256i alpha = _mm256_shuffle_epi8(source, alphaSpread);
+    const __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+    __m256i v = _mm256_add_epi16(_mm256_mullo_epi16(source, alpha), _mm256_mullo_epi16(target, inverse));
+    v = _mm256_add_epi16(v, _mm256_set1_epi16(127));
+    v = _mm256_add_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)), _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(v, 8);
+}
+
+TARGET_AVX2 static void BlendRow(const PixelRGBA* source, int width, PixelRGBA* target)
+{
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+    const __m256i zero = _mm256_setzero_si256();
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(source + x));
+        __m256i alpha = _mm256_and_si256(s, alphaMask);
+        if (_mm256_testz_si256(alpha, alpha))
+            continue;
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1)
+        {
+            _mm256_storeu_si256((__m256i*)(target + x), s);
+            continue;
+        }
+
+        __m256i d = _mm256_loadu_si256((const __m256i*)(target + x));
+        __m256i low = BlendWide(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+        __m256i high = BlendWide(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+        _mm256_storeu_si256((__m256i*)(target + x), _mm256_packus_epi16(low, high));
+    }
+    if (x < width)
+        GetBlendRowFuncSSE41()(source + x, width - x, target + x);
+}
+
+/*
+ *  8 transmittance bytes widen to one per 32-bit lane, which puts each at the
+ *  start of its pixel for the spread; the rest is the SSE4.1 version.
+ */
+TARGET_AVX2 static void BlendStackRow(const PixelRGBA* color, const unsigned char* transmittance, int width, PixelRGBA* target)
+{
+    const __m256i spread = _mm256_setr_epi8(
+        0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12,
+        0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(127);
+    const __m256i one = _mm256_set1_epi16(1);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i through = _mm_loadl_epi64((const __m128i*)(transmittance + x));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(color + x));
+        if (_mm_testz_si128(through, through))
+        {
+            _mm256_storeu_si256((__m256i*)(target + x), c);
+            continue;
+        }
+
+        __m256i t = _mm256_shuffle_epi8(_mm256_cvtepu8_epi32(through), spread);
+        __m256i d = _mm256_loadu_si256((const __m256i*)(target + x));
+        __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(t, zero)), round);
+        __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(t, zero)), round);
+        low = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), one), 8);
+        high = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), one), 8);
+        _mm256_storeu_si256((__m256i*)(target + x), _mm256_adds_epu8(c, _mm256_packus_epi16(low, high)));
+    }
+    if (x < width)
+        GetBlendStackRowFuncSSE41()(color + x, transmittance + x, width - x, target + x);
+}
+
+BlendRowFunc GetBlendRowFuncAVX2()
+{
+    return BlendRow;
+}
+
+BlendStackRowFunc GetBlendStackRowFuncAVX2()
+{
+    return BlendStackRow;
+}
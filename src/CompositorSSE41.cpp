@@ -0,0 +1,94 @@
+#include "Compositor.h"
+
+#include <cstring>
+#include <immintrin.h>
+
+/*
+ *  Blends 2 pixels widened to 16-bit lanes: (s * a + d * (255 - a) + 127) / 255,
+ *  with the divide done as (v + (v >> 8) + 1) >> 8, exact for every v this can be.
+ */
+TARGET_SSE41 static FORCE_INLINE __m128i BlendWide(__m128i source, __m128i target)
+{
+    const __m128i alphaSpread = _mm_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+    const __m128i alpha = _mm_shuffle_epi8(source, alphaSpread);
+    const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    __m128i v = _mm_add_epi16(_mm_mullo_epi16(source, alpha), _mm_mullo_epi16(target, inverse));
+    v = _mm_add_epi16(v, _mm_set1_epi16(127));
+    v = _mm_add_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+/*
+ *  4 pixels per iteration. Runs of fully opaque or fully transparent pixels
+ *  (most of a typical layer) are copied or skipped without the multiplies.
+ */
+TARGET_SSE41 static void BlendRow(const PixelRGBA* source, int width, PixelRGBA* target)
+{
+    const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+    const __m128i zero = _mm_setzero_si128();
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(source + x));
+        __m128i alpha = _mm_and_si128(s, alphaMask);
+        if (_mm_testz_si128(alpha, alpha))
+            continue;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF)
+        {
+            _mm_storeu_si128((__m128i*)(target + x), s);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(target + x));
+        __m128i low = BlendWide(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i high = BlendWide(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i*)(target + x), _mm_packus_epi16(low, high));
+    }
+    if (x < width)
+        GetBlendRowFuncScalar()(source + x, width - x, target + x);
+}
+
+/*
+ *  4 pixels per iteration: each transmittance byte is spread over its pixel's
+ *  4 channels, then dst = C + (dst * T + 127) / 255 with the same exact divide.
+ *  Where the stack is opaque (T = 0 for all 4) it's just C.
+ */
+TARGET_SSE41 static void BlendStackRow(const PixelRGBA* color, const unsigned char* transmittance, int width, PixelRGBA* target)
+{
+    const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+    const __m128i zero = _mm_setzero_si128();
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        int through;
+        memcpy(&through, transmittance + x, sizeof(through));
+        __m128i c = _mm_loadu_si128((const __m128i*)(color + x));
+        if (through == 0)
+        {
+            _mm_storeu_si128((__m128i*)(target + x), c);
+            continue;
+        }
+
+        __m128i t = _mm_shuffle_epi8(_mm_cvtsi32_si128(through), spread);
+        __m128i d = _mm_loadu_si128((const __m128i*)(target + x));
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(t, zero)), _mm_set1_epi16(127));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(t, zero)), _mm_set1_epi16(127));
+        low = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), _mm_set1_epi16(1)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), _mm_set1_epi16(1)), 8);
+        _mm_storeu_si128((__m128i*)(target + x), _mm_adds_epu8(c, _mm_packus_epi16(low, high)));
+    }
+    if (x < width)
+        GetBlendStackRowFuncScalar()(color + x, transmittance + x, width - x, target + x);
+}
+
+BlendRowFunc GetBlendRowFuncSSE41()
+{
+    return BlendRow;
+}
+
+BlendStackRowFunc GetBlendStackRowFuncSSE41()
+{
+    return BlendStackRow;
+}
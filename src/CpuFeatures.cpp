@@ -0,0 +1,78 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void Cpuid(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+    for (int i = 0; i < 4; i++)
+        regs[i] = (unsigned int)info[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long ReadXCR0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+static SimdLevel QuerySimdLevel()
+{
+    unsigned int regs[4];
+    Cpuid(0, 0, regs);
+    const unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 1) return SimdLevel::Scalar;
+
+    Cpuid(1, 0, regs);
+    const bool sse41 = (regs[2] & (1u << 19)) != 0;
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    const bool avx = (regs[2] & (1u << 28)) != 0;
+    const bool fma = (regs[2] & (1u << 12)) != 0;
+    if (!sse41) return SimdLevel::Scalar;
+
+    // The OS has to save the wider registers on context switches too.
+    if (!osxsave || !avx || maxLeaf < 7) return SimdLevel::SSE41;
+    const unsigned long long xcr0 = ReadXCR0();
+    if ((xcr0 & 0x6) != 0x6) return SimdLevel::SSE41;
+
+    Cpuid(7, 0, regs);
+    const bool avx2 = (regs[1] & (1u << 5)) != 0;
+    const bool avx512f = (regs[1] & (1u << 16)) != 0;
+    const bool avx512bw = (regs[1] & (1u << 30)) != 0;
+    if (!avx2 || !fma) return SimdLevel::SSE41;
+
+    // Opmask and upper zmm state (bits 5-7) must also be enabled for AVX-512.
+    if (avx512f && avx512bw && (xcr0 & 0xE0) == 0xE0) return SimdLevel::AVX512;
+    return SimdLevel::AVX2;
+}
+
+SimdLevel DetectSimdLevel()
+{
+    static const SimdLevel level = QuerySimdLevel();
+    return level;
+}
+
+const char* SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::SSE41:  return "SSE4.1";
+        case SimdLevel::AVX2:   return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        default:                return "Scalar";
+    }
+}
@@ -0,0 +1,144 @@
+#include "DamageTracker.h"
+
+bool DamageRect::Empty() const
+{
+    return x0 >= x1 || y0 >= y1;
+}
+
+bool DamageRect::Overlaps(const DamageRect& other) const
+{
+    return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+}
+
+void DamageRect::Merge(const DamageRect& other)
+{
+    x0 = (other.x0 < x0) ? other.x0 : x0;
+    y0 = (other.y0 < y0) ? other.y0 : y0;
+    x1 = (other.x1 > x1) ? other.x1 : x1;
+    y1 = (other.y1 > y1) ? other.y1 : y1;
+}
+
+DamageTracker::DrawnLayer DamageTracker::Describe(const Layer* layer)
+{
+    DrawnLayer drawn;
+    drawn.layer = layer;
+    drawn.source = layer->rawImage.Data();
+    drawn.x = layer->rasterPosX;
+    drawn.y = layer->rasterPosY;
+    drawn.width = layer->outputWidth;
+    drawn.height = layer->outputHeight;
+    drawn.matrix = layer->warpMatrix;
+    drawn.filter = layer->filter;
+    return drawn;
+}
+
+bool DamageTracker::SameDrawing(const DrawnLayer& a, const DrawnLayer& b)
+{
+    return a.layer == b.layer && a.source == b.source && a.x == b.x && a.y == b.y &&
+        a.width == b.width && a.height == b.height && a.matrix == b.matrix && a.filter == b.filter;
+}
+
+void DamageTracker::AddDamage(const DrawnLayer& drawn)
+{
+    // Positions can be anywhere in int range (icons park at INT_MIN), so the far
+    // edges are worked out in 64 bits before clipping to the target.
+    const long long right = (long long)drawn.x + drawn.width, top = (long long)drawn.y + drawn.height;
+    DamageRect rect;
+    rect.x0 = drawn.x;
+    rect.y0 = drawn.y;
+    rect.x1 = (right < drawnWidth) ? (int)right : drawnWidth;
+    rect.y1 = (top < drawnHeight) ? (int)top : drawnHeight;
+    AddDamage(rect);
+}
+
+void DamageTracker::AddDamage(DamageRect rect)
+{
+    rect.x0 = (rect.x0 > 0) ? rect.x0 : 0;
+    rect.y0 = (rect.y0 > 0) ? rect.y0 : 0;
+    rect.x1 = (rect.x1 < drawnWidth) ? rect.x1 : drawnWidth;
+    rect.y1 = (rect.y1 < drawnHeight) ? rect.y1 : drawnHeight;
+    if (rect.Empty())
+        return;
+
+    // Rectangles stay disjoint: anything this one overlaps is taken into it,
+    // and the grown rectangle checked against the rest again.
+    for (size_t i = 0; i < damage.size();)
+    {
+        if (damage[i].Overlaps(rect))
+        {
+            rect.Merge(damage[i]);
+            damage.erase(damage.begin() + i);
+            i = 0;
+        }
+        else
+            i++;
+    }
+    damage.push_back(rect);
+
+    if ((int)damage.size() > DAMAGE_MAX_RECTS)
+    {
+        for (const DamageRect& other : damage)
+            rect.Merge(other);
+        damage.assign(1, rect);
+    }
+}
+
+const std::vector<DamageRect>& DamageTracker::Update(const Layer* const* layers, int count, int width, int height)
+{
+    damage.clear();
+    if (everything || width != drawnWidth || height != drawnHeight)
+    {
+        drawnWidth = width;
+        drawnHeight = height;
+        if (width > 0 && height > 0)
+            damage.push_back({ 0, 0, width, height });
+    }
+    else
+    {
+        // Layers are compared by their place in the stack, so a layer that moved
+        // up or down damages its box, as does whatever took its old place.
+        const int drawnCount = (int)drawn.size();
+        const int slots = (count > drawnCount) ? count : drawnCount;
+        for (int i = 0; i < slots; i++)
+        {
+            const bool wasDrawn = i < drawnCount && drawn[i].layer;
+            const bool isDrawn = i < count && layers[i];
+            if (!wasDrawn && !isDrawn)
+                continue;
+
+            if (isDrawn)
+            {
+                const DrawnLayer now = Describe(layers[i]);
+                if (wasDrawn && SameDrawing(drawn[i], now))
+                    continue;
+                AddDamage(now);
+            }
+            if (wasDrawn)
+                AddDamage(drawn[i]);
+        }
+        for (const DamageRect& rect : pending)
+            AddDamage(rect);
+    }
+    pending.clear();
+
+    drawn.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        if (layers[i])
+            drawn[i] = Describe(layers[i]);
+        else
+            drawn[i].layer = nullptr;
+    }
+    everything = false;
+    return damage;
+}
+
+void DamageTracker::DamageAll()
+{
+    everything = true;
+}
+
+void DamageTracker::Damage(const DamageRect& rect)
+{
+    pending.push_back(rect);
+}
@@ -0,0 +1,330 @@
+#include "Homography.h"
+
+#include <algorithm>
+#include <cmath>
+
+static Matrix3D ToMatrix3D(const double H[9])
+{
+    Matrix3D M;
+    M << (float)H[0], (float)H[1], (float)H[2],
+         (float)H[3], (float)H[4], (float)H[5],
+         (float)H[6], (float)H[7], (float)H[8];
+    return M;
+}
+
+bool SolveSquareToQuad(const Point corners[4], double H[9])
+{
+    const double x0 = corners[0].x, x1 = corners[1].x, x2 = corners[2].x, x3 = corners[3].x;
+    const double y0 = corners[0].y, y1 = corners[1].y, y2 = corners[2].y, y3 = corners[3].y;
+
+    // Four points only define a homography if no three of them are collinear,
+    // so check every triangle of corners against the quad's overall size.
+    double minX = x0, maxX = x0, minY = y0, maxY = y0;
+    for (int i = 1; i < 4; i++)
+    {
+        minX = fmin(minX, corners[i].x);
+        maxX = fmax(maxX, corners[i].x);
+        minY = fmin(minY, corners[i].y);
+        maxY = fmax(maxY, corners[i].y);
+    }
+    const double size = fmax(maxX - minX, maxY - minY);
+    const double minArea = HOMOGRAPHY_DEGENERATE_AREA * size * size;
+    for (int i = 0; i < 4; i++)
+    {
+        const Point& a = corners[i];
+        const Point& b = corners[(i + 1) % 4];
+        const Point& c = corners[(i + 2) % 4];
+        double area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (!(fabs(area) > minArea))
+            return false;
+    }
+
+    // x = (a u + b v + c) / (g u + h v + 1), likewise for y with d, e, f. Plugging in
+    // the square's corners leaves a 2x2 system for g and h, solved by Cramer's rule;
+    // for parallelograms sumX = sumY = 0, so g = h = 0 and the matrix is affine.
+    const double sumX = x0 - x1 + x2 - x3;
+    const double sumY = y0 - y1 + y2 - y3;
+    const double dx1 = x1 - x2, dx2 = x3 - x2;
+    const double dy1 = y1 - y2, dy2 = y3 - y2;
+    const double den = dx1 * dy2 - dx2 * dy1;
+
+    const double g = (sumX * dy2 - dx2 * sumY) / den;
+    const double h = (dx1 * sumY - sumX * dy1) / den;
+
+    H[0] = x1 - x0 + g * x1;
+    H[1] = x3 - x0 + h * x3;
+    H[2] = x0;
+    H[3] = y1 - y0 + g * y1;
+    H[4] = y3 - y0 + h * y3;
+    H[5] = y0;
+    H[6] = g;
+    H[7] = h;
+    H[8] = 1.0;
+    return true;
+}
+
+bool SolveHomographyExact(const Point src[4], const Point dst[4], double H[9])
+{
+    double squareToSrc[9], squareToDst[9];
+    if (!SolveSquareToQuad(src, squareToSrc) || !SolveSquareToQuad(dst, squareToDst))
+        return false;
+
+    // src -> square is the inverse of square -> src; the adjugate is that inverse
+    // up to scale, which a homography doesn't care about, so skip the division.
+    const double* S = squareToSrc;
+    const double adj[9] =
+    {
+        S[4] * S[8] - S[5] * S[7], S[2] * S[7] - S[1] * S[8], S[1] * S[5] - S[2] * S[4],
+        S[5] * S[6] - S[3] * S[8], S[0] * S[8] - S[2] * S[6], S[2] * S[3] - S[0] * S[5],
+        S[3] * S[7] - S[4] * S[6], S[1] * S[6] - S[0] * S[7], S[0] * S[4] - S[1] * S[3]
+    };
+
+    double product[9];
+    double largest = 0.0;
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++)
+        {
+            const double* D = squareToDst + row * 3;
+            product[row * 3 + col] = D[0] * adj[col] + D[1] * adj[3 + col] + D[2] * adj[6 + col];
+            largest = fmax(largest, fabs(product[row * 3 + col]));
+        }
+    }
+
+    // Scale so H(2, 2) = 1 like the LU solution. If it's (nearly) zero, src[0]'s
+    // corner of the plane maps to infinity, and there's no such scaling to be had.
+    if (!(fabs(product[8]) > 1e-12 * largest))
+        return false;
+
+    const double scale = 1.0 / product[8];
+    for (int i = 0; i < 8; i++)
+        H[i] = product[i] * scale;
+    H[8] = 1.0;
+    return true;
+}
+
+Matrix3D SolveHomography(const Point src[4], const Point dst[4])
+{
+    double H[9];
+    if (!SolveHomographyExact(src, dst, H))
+        return SolveHomographyLU(src, dst);
+    return ToMatrix3D(H);
+}
+
+Matrix3D SolveHomographyLU(const Point src[4], const Point dst[4])
+{
+    Matrix3D newM = Matrix3D::Identity();
+    Matrix8D projectiveSystem = Matrix8D::Zero();
+    Vector8D destPoints;
+    Vector8D solution;
+
+    // Populate 8x8 matrix for system to solve, and a vector with the destination
+    // points; first 4 elements are x-positions, last 4 are y-positions.
+    for (int i = 0; i < 4; i++)
+    {
+        destPoints(i, 0) = (float)dst[i].x;
+        destPoints(i + 4, 0) = (float)dst[i].y;
+
+        // 8x8 matrix to solve. Any points not set here are implicitly zero.
+        projectiveSystem(i, 0) = projectiveSystem(i + 4, 3) = (float)src[i].x;
+        projectiveSystem(i, 1) = projectiveSystem(i + 4, 4) = (float)src[i].y;
+        projectiveSystem(i, 2) = projectiveSystem(i + 4, 5) = 1;
+
+        projectiveSystem(i, 6)      = (float)(-src[i].x * dst[i].x);
+        projectiveSystem(i, 7)      = (float)(-src[i].y * dst[i].x);
+        projectiveSystem(i + 4, 6)  = (float)(-src[i].x * dst[i].y);
+        projectiveSystem(i + 4, 7)  = (float)(-src[i].y * dst[i].y);
+    }
+
+    // Solve and explicity set 3D matrix version of solution; do so for
+    // efficiency by avoiding for loops.
+    solution = projectiveSystem.partialPivLu().solve(destPoints);
+    newM(0, 0) = solution(0, 0);
+    newM(0, 1) = solution(1, 0);
+    newM(0, 2) = solution(2, 0);
+    newM(1, 0) = solution(3, 0);
+    newM(1, 1) = solution(4, 0);
+    newM(1, 2) = solution(5, 0);
+    newM(2, 0) = solution(6, 0);
+    newM(2, 1) = solution(7, 0);
+    newM(2, 2) = 1.0;
+    return newM;
+}
+
+Matrix3D SolveRectToQuad(int width, int height, const Point corners[4])
+{
+    // The rectangle is just the unit square scaled by (width, height), so fold
+    // that scale into the first two columns instead of solving quad to quad.
+    double H[9];
+    if (width > 0 && height > 0 && SolveSquareToQuad(corners, H))
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            H[row * 3 + 0] /= width;
+            H[row * 3 + 1] /= height;
+        }
+        return ToMatrix3D(H);
+    }
+
+    const Point rect[4] = { Point(0, 0), Point(width, 0), Point(width, height), Point(0, height) };
+    return SolveHomographyLU(rect, corners);
+}
+
+/*
+ *  Hartley normalization for one point set: the similarity T taking the weighted
+ *  centroid to the origin and the weighted average distance from it to sqrt(2).
+ */
+struct DltNormalization
+{
+    double centerX, centerY, scale;
+
+    bool Compute(const Point* points, int count, const double* weights)
+    {
+        double totalWeight = 0.0, sumX = 0.0, sumY = 0.0;
+        for (int i = 0; i < count; i++)
+        {
+            double w = weights ? weights[i] : 1.0;
+            if (!(w > 0.0)) continue;
+            totalWeight += w;
+            sumX += w * points[i].x;
+            sumY += w * points[i].y;
+        }
+        centerX = sumX / totalWeight;
+        centerY = sumY / totalWeight;
+
+        double sumDistance = 0.0;
+        for (int i = 0; i < count; i++)
+        {
+            double w = weights ? weights[i] : 1.0;
+            if (!(w > 0.0)) continue;
+            sumDistance += w * std::hypot(points[i].x - centerX, points[i].y - centerY);
+        }
+        double meanDistance = sumDistance / totalWeight;
+        scale = std::sqrt(2.0) / meanDistance;
+        return meanDistance > 0.0 && std::isfinite(scale);
+    }
+
+    void Apply(const Point& p, double& x, double& y) const
+    {
+        x = (p.x - centerX) * scale;
+        y = (p.y - centerY) * scale;
+    }
+};
+
+/*
+ *  The two DLT rows for one (weighted, normalized) pair, h being M row major:
+ *      [ 0  0  0  -x -y -1   y'x  y'y  y' ] h = 0
+ *      [ x  y  1   0  0  0  -x'x -x'y -x' ] h = 0
+ */
+static void DltRows(double x, double y, double dstX, double dstY, double rootWeight, double rows[2][9])
+{
+    const double a[9] = { 0.0, 0.0, 0.0, -x, -y, -1.0, dstY * x, dstY * y, dstY };
+    const double b[9] = { x, y, 1.0, 0.0, 0.0, 0.0, -dstX * x, -dstX * y, -dstX };
+    for (int k = 0; k < 9; k++)
+    {
+        rows[0][k] = a[k] * rootWeight;
+        rows[1][k] = b[k] * rootWeight;
+    }
+}
+
+// The solution is only unique if the second smallest singular value is clearly
+// above zero; below this fraction of the largest, the points are degenerate.
+static const double DLT_RANK_EPSILON = 1e-10;
+
+bool SolveHomographyDLT(const Point* src, const Point* dst, int count, const double* weights,
+    Matrix3D& M, DltMethod method)
+{
+    int used = 0;
+    for (int i = 0; i < count; i++)
+        used += (!weights || weights[i] > 0.0) ? 1 : 0;
+    if (used < 4)
+        return false;
+
+    DltNormalization srcNorm, dstNorm;
+    if (!srcNorm.Compute(src, count, weights) || !dstNorm.Compute(dst, count, weights))
+        return false;
+
+    // Null vector of the 2n x 9 system A, as the right singular vector (or the
+    // eigenvector of A^T A) belonging to the smallest singular value.
+    typedef Eigen::Matrix<double, 9, 1> Vector9d;
+    typedef Eigen::Matrix<double, 9, 9> Matrix9d;
+    Vector9d h;
+    double smallestKept, largest;
+
+    if (method == DltMethod::NormalEquations)
+    {
+        // Accumulate A^T A directly; only the lower triangle is read by the solver.
+        Matrix9d normal = Matrix9d::Zero();
+        for (int i = 0; i < count; i++)
+        {
+            double w = weights ? weights[i] : 1.0;
+            if (!(w > 0.0)) continue;
+
+            double x, y, dstX, dstY, rows[2][9];
+            srcNorm.Apply(src[i], x, y);
+            dstNorm.Apply(dst[i], dstX, dstY);
+            DltRows(x, y, dstX, dstY, std::sqrt(w), rows);
+            for (int r = 0; r < 2; r++)
+                for (int j = 0; j < 9; j++)
+                    for (int k = 0; k <= j; k++)
+                        normal(j, k) += rows[r][j] * rows[r][k];
+        }
+
+        // Eigenvalues come out ascending and are the squared singular values.
+        Eigen::SelfAdjointEigenSolver<Matrix9d> solver(normal);
+        if (solver.info() != Eigen::Success)
+            return false;
+        h = solver.eigenvectors().col(0);
+        smallestKept = std::sqrt(std::max(solver.eigenvalues()(1), 0.0));
+        largest = std::sqrt(std::max(solver.eigenvalues()(8), 0.0));
+    }
+    else
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, 9> system(2 * used, 9);
+        int row = 0;
+        for (int i = 0; i < count; i++)
+        {
+            double w = weights ? weights[i] : 1.0;
+            if (!(w > 0.0)) continue;
+
+            double x, y, dstX, dstY, rows[2][9];
+            srcNorm.Apply(src[i], x, y);
+            dstNorm.Apply(dst[i], dstX, dstY);
+            DltRows(x, y, dstX, dstY, std::sqrt(w), rows);
+            for (int r = 0; r < 2; r++, row++)
+                for (int k = 0; k < 9; k++)
+                    system(row, k) = rows[r][k];
+        }
+
+        // With exactly 4 pairs A is only 8 rows, so ask for the full V to get the 9th vector.
+        Eigen::JacobiSVD<Eigen::Matrix<double, Eigen::Dynamic, 9>> svd(system, Eigen::ComputeFullV);
+        const Eigen::VectorXd& singular = svd.singularValues();
+        h = svd.matrixV().col(8);
+        smallestKept = singular(7);
+        largest = singular(0);
+    }
+
+    if (!(smallestKept > DLT_RANK_EPSILON * largest))
+        return false;
+
+    // Undo the normalization: M = inverse(T_dst) * H * T_src.
+    Eigen::Matrix3d H;
+    H << h(0), h(1), h(2),
+         h(3), h(4), h(5),
+         h(6), h(7), h(8);
+
+    Eigen::Matrix3d srcT, dstInvT;
+    srcT << srcNorm.scale, 0.0, -srcNorm.scale * srcNorm.centerX,
+            0.0, srcNorm.scale, -srcNorm.scale * srcNorm.centerY,
+            0.0, 0.0, 1.0;
+    dstInvT << 1.0 / dstNorm.scale, 0.0, dstNorm.centerX,
+               0.0, 1.0 / dstNorm.scale, dstNorm.centerY,
+               0.0, 0.0, 1.0;
+    Eigen::Matrix3d result = dstInvT * H * srcT;
+
+    if (!(std::fabs(result(2, 2)) > 1e-12 * result.cwiseAbs().maxCoeff()))
+        return false;
+    result /= result(2, 2);
+    M = result.cast<float>();
+    return true;
+}
@@ -0,0 +1,211 @@
+#include "HomographyBatch.h"
+#include "WorkerPool.h"
+
+#include <cmath>
+#include <limits>
+
+// Problems handed to a thread at a time; a few microseconds of work each.
+static const int HOMOGRAPHY_BATCH_CHUNK = 1024;
+
+/*
+ *  The scalar solver is the reference for the vector ones: they do exactly the
+ *  same operations in the same order (no fused multiply-adds), one problem per
+ *  lane, so all of them round identically.
+ */
+
+static inline double Min(double a, double b) { return (a < b) ? a : b; }
+static inline double Max(double a, double b) { return (a > b) ? a : b; }
+
+/*
+ *  Square -> quad matrix (see SolveSquareToQuad) for problem n, plus its flags.
+ */
+static unsigned char SquareToQuad(const QuadArrays& quad, int n, double H[9])
+{
+    double x[4], y[4];
+    for (int i = 0; i < 4; i++)
+    {
+        x[i] = quad.x[i][n];
+        y[i] = quad.y[i][n];
+    }
+
+    double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (int i = 1; i < 4; i++)
+    {
+        minX = Min(minX, x[i]);
+        maxX = Max(maxX, x[i]);
+        minY = Min(minY, y[i]);
+        maxY = Max(maxY, y[i]);
+    }
+    const double size = Max(maxX - minX, maxY - minY);
+    const double sizeSquared = size * size;
+
+    double minArea = std::numeric_limits<double>::infinity();
+    int positive = 0, negative = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int b = (i + 1) & 3, c = (i + 2) & 3;
+        double area = (x[b] - x[i]) * (y[c] - y[i]) - (x[c] - x[i]) * (y[b] - y[i]);
+        minArea = Min(minArea, fabs(area));
+        positive += (area > 0.0);
+        negative += (area < 0.0);
+    }
+
+    unsigned char flags = 0;
+    if (!(minArea > HOMOGRAPHY_DEGENERATE_AREA * sizeSquared)) flags |= HOMOGRAPHY_DEGENERATE;
+    if (minArea < HOMOGRAPHY_ILL_CONDITIONED_AREA * sizeSquared) flags |= HOMOGRAPHY_ILL_CONDITIONED;
+    if (positive != 4 && negative != 4) flags |= HOMOGRAPHY_NOT_CONVEX;
+
+    const double sumX = x[0] - x[1] + x[2] - x[3];
+    const double sumY = y[0] - y[1] + y[2] - y[3];
+    const double dx1 = x[1] - x[2], dx2 = x[3] - x[2];
+    const double dy1 = y[1] - y[2], dy2 = y[3] - y[2];
+    const double den = dx1 * dy2 - dx2 * dy1;
+    const double g = (sumX * dy2 - dx2 * sumY) / den;
+    const double h = (dx1 * sumY - sumX * dy1) / den;
+
+    H[0] = x[1] - x[0] + g * x[1];
+    H[1] = x[3] - x[0] + h * x[3];
+    H[2] = x[0];
+    H[3] = y[1] - y[0] + g * y[1];
+    H[4] = y[3] - y[0] + h * y[3];
+    H[5] = y[0];
+    H[6] = g;
+    H[7] = h;
+    H[8] = 1.0;
+    return flags;
+}
+
+static void Adjugate(const double M[9], double adj[9])
+{
+    adj[0] = M[4] * M[8] - M[5] * M[7];
+    adj[1] = M[2] * M[7] - M[1] * M[8];
+    adj[2] = M[1] * M[5] - M[2] * M[4];
+    adj[3] = M[5] * M[6] - M[3] * M[8];
+    adj[4] = M[0] * M[8] - M[2] * M[6];
+    adj[5] = M[2] * M[3] - M[0] * M[5];
+    adj[6] = M[3] * M[7] - M[4] * M[6];
+    adj[7] = M[1] * M[6] - M[0] * M[7];
+    adj[8] = M[0] * M[4] - M[1] * M[3];
+}
+
+/*
+ *  Scales M so M[8] = 1; false if M[8] is too small next to the rest for that.
+ */
+static bool NormalizeHomography(double M[9])
+{
+    double largest = 0.0;
+    for (int i = 0; i < 9; i++)
+        largest = Max(largest, fabs(M[i]));
+    bool ok = fabs(M[8]) > 1e-12 * largest;
+
+    const double scale = 1.0 / M[8];
+    for (int i = 0; i < 8; i++)
+        M[i] = M[i] * scale;
+    M[8] = 1.0;
+    return ok;
+}
+
+static void SolveBatchScalar(const HomographyBatch& batch, int begin, int end)
+{
+    const double invWidth = 1.0 / batch.width, invHeight = 1.0 / batch.height;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    for (int n = begin; n < end; n++)
+    {
+        double H[9];
+        unsigned char flags = SquareToQuad(batch.dst, n, H);
+
+        if (batch.src)
+        {
+            // H = (square -> dst) * adj(square -> src), like SolveHomography.
+            double S[9], adj[9], D[9];
+            flags |= SquareToQuad(*batch.src, n, S);
+            Adjugate(S, adj);
+            for (int i = 0; i < 9; i++)
+                D[i] = H[i];
+            for (int row = 0; row < 3; row++)
+                for (int col = 0; col < 3; col++)
+                    H[row * 3 + col] = D[row * 3] * adj[col] + D[row * 3 + 1] * adj[3 + col] + D[row * 3 + 2] * adj[6 + col];
+            if (!NormalizeHomography(H))
+                flags |= HOMOGRAPHY_DEGENERATE;
+        }
+        else
+        {
+            for (int row = 0; row < 3; row++)
+            {
+                H[row * 3] = H[row * 3] * invWidth;
+                H[row * 3 + 1] = H[row * 3 + 1] * invHeight;
+            }
+        }
+
+        double inverse[9];
+        Adjugate(H, inverse);
+        if (!NormalizeHomography(inverse))
+            flags |= HOMOGRAPHY_DEGENERATE;
+
+        const bool degenerate = (flags & HOMOGRAPHY_DEGENERATE) != 0;
+        for (int k = 0; k < 9; k++)
+        {
+            batch.forward.m[k][n] = degenerate ? nan : (float)H[k];
+            batch.inverse.m[k][n] = degenerate ? nan : (float)inverse[k];
+        }
+        batch.flags[n] = flags;
+    }
+}
+
+HomographyBatchFunc GetHomographyBatchFuncScalar()
+{
+    return SolveBatchScalar;
+}
+
+HomographyBatchFunc GetHomographyBatchFunc()
+{
+    static const HomographyBatchFunc func = []
+    {
+        switch (DetectSimdLevel())
+        {
+            case SimdLevel::AVX512: return GetHomographyBatchFuncAVX512();
+            case SimdLevel::AVX2:   return GetHomographyBatchFuncAVX2();
+            default:                return GetHomographyBatchFuncScalar();
+        }
+    }();
+    return func;
+}
+
+static void RunBatch(const HomographyBatch& batch, int count)
+{
+    const HomographyBatchFunc solve = GetHomographyBatchFunc();
+    const int chunkCount = (count + HOMOGRAPHY_BATCH_CHUNK - 1) / HOMOGRAPHY_BATCH_CHUNK;
+    WorkerPool::Get().ParallelFor(chunkCount, [&](int chunk)
+    {
+        int begin = chunk * HOMOGRAPHY_BATCH_CHUNK;
+        int end = (begin + HOMOGRAPHY_BATCH_CHUNK < count) ? (begin + HOMOGRAPHY_BATCH_CHUNK) : count;
+        solve(batch, begin, end);
+    });
+}
+
+void SolveRectToQuadBatch(int width, int height, const QuadArrays& dst, int count,
+    const HomographyArrays& forward, const HomographyArrays& inverse, unsigned char* flags)
+{
+    // An empty rectangle has no homography; don't rely on inf/NaN arithmetic to say so.
+    if (width <= 0 || height <= 0)
+    {
+        for (int n = 0; n < count; n++)
+        {
+            for (int k = 0; k < 9; k++)
+                forward.m[k][n] = inverse.m[k][n] = std::numeric_limits<float>::quiet_NaN();
+            flags[n] = HOMOGRAPHY_DEGENERATE;
+        }
+        return;
+    }
+
+    HomographyBatch batch = { nullptr, (double)width, (double)height, dst, forward, inverse, flags };
+    RunBatch(batch, count);
+}
+
+void SolveQuadToQuadBatch(const QuadArrays& src, const QuadArrays& dst, int count,
+    const HomographyArrays& forward, const HomographyArrays& inverse, unsigned char* flags)
+{
+    HomographyBatch batch = { &src, 1.0, 1.0, dst, forward, inverse, flags };
+    RunBatch(batch, count);
+}
@@ -0,0 +1,187 @@
+#include "HomographyBatch.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+// gcc and clang treat these intrinsics as plain vector arithmetic and would fuse
+// multiplies into adds now that FMA is enabled, rounding differently from the
+// scalar solver. (MSVC never contracts intrinsics.)
+#if defined(__clang__)
+    #pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+    #pragma GCC optimize("fp-contract=off")
+#endif
+
+/*
+ *  4 problems at a time, one per double lane. Mirrors SolveBatchScalar operation
+ *  for operation (separate multiplies and adds, IEEE division) so the results
+ *  match it bit for bit; the leftover problems go through the scalar solver.
+ */
+
+TARGET_AVX2 static FORCE_INLINE __m256d Abs(__m256d value)
+{
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), value);
+}
+
+TARGET_AVX2 static FORCE_INLINE __m256d MulSub(__m256d a, __m256d b, __m256d c, __m256d d)
+{
+    return _mm256_sub_pd(_mm256_mul_pd(a, b), _mm256_mul_pd(c, d));
+}
+
+/*
+ *  Square -> quad matrices for problems [n, n + 4), plus their flag masks.
+ */
+TARGET_AVX2 static FORCE_INLINE void SquareToQuad4(const QuadArrays& quad, int n, __m256d H[9],
+    __m256d& degenerate, __m256d& illConditioned, __m256d& notConvex)
+{
+    __m256d x[4], y[4];
+    for (int i = 0; i < 4; i++)
+    {
+        x[i] = _mm256_loadu_pd(quad.x[i] + n);
+        y[i] = _mm256_loadu_pd(quad.y[i] + n);
+    }
+
+    __m256d minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (int i = 1; i < 4; i++)
+    {
+        minX = _mm256_min_pd(minX, x[i]);
+        maxX = _mm256_max_pd(maxX, x[i]);
+        minY = _mm256_min_pd(minY, y[i]);
+        maxY = _mm256_max_pd(maxY, y[i]);
+    }
+    const __m256d size = _mm256_max_pd(_mm256_sub_pd(maxX, minX), _mm256_sub_pd(maxY, minY));
+    const __m256d sizeSquared = _mm256_mul_pd(size, size);
+
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d minArea = _mm256_set1_pd(HUGE_VAL);
+    __m256d allPositive = _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), allNegative = allPositive;
+    for (int i = 0; i < 4; i++)
+    {
+        int b = (i + 1) & 3, c = (i + 2) & 3;
+        __m256d area = MulSub(_mm256_sub_pd(x[b], x[i]), _mm256_sub_pd(y[c], y[i]),
+            _mm256_sub_pd(x[c], x[i]), _mm256_sub_pd(y[b], y[i]));
+        minArea = _mm256_min_pd(minArea, Abs(area));
+        allPositive = _mm256_and_pd(allPositive, _mm256_cmp_pd(area, zero, _CMP_GT_OQ));
+        allNegative = _mm256_and_pd(allNegative, _mm256_cmp_pd(area, zero, _CMP_LT_OQ));
+    }
+
+    degenerate = _mm256_or_pd(degenerate, _mm256_cmp_pd(minArea,
+        _mm256_mul_pd(_mm256_set1_pd(HOMOGRAPHY_DEGENERATE_AREA), sizeSquared), _CMP_NGT_UQ));
+    illConditioned = _mm256_or_pd(illConditioned, _mm256_cmp_pd(minArea,
+        _mm256_mul_pd(_mm256_set1_pd(HOMOGRAPHY_ILL_CONDITIONED_AREA), sizeSquared), _CMP_LT_OQ));
+    notConvex = _mm256_or_pd(notConvex, _mm256_andnot_pd(_mm256_or_pd(allPositive, allNegative),
+        _mm256_castsi256_pd(_mm256_set1_epi64x(-1))));
+
+    const __m256d sumX = _mm256_sub_pd(_mm256_add_pd(_mm256_sub_pd(x[0], x[1]), x[2]), x[3]);
+    const __m256d sumY = _mm256_sub_pd(_mm256_add_pd(_mm256_sub_pd(y[0], y[1]), y[2]), y[3]);
+    const __m256d dx1 = _mm256_sub_pd(x[1], x[2]), dx2 = _mm256_sub_pd(x[3], x[2]);
+    const __m256d dy1 = _mm256_sub_pd(y[1], y[2]), dy2 = _mm256_sub_pd(y[3], y[2]);
+    const __m256d den = MulSub(dx1, dy2, dx2, dy1);
+    const __m256d g = _mm256_div_pd(MulSub(sumX, dy2, dx2, sumY), den);
+    const __m256d h = _mm256_div_pd(MulSub(dx1, sumY, sumX, dy1), den);
+
+    H[0] = _mm256_add_pd(_mm256_sub_pd(x[1], x[0]), _mm256_mul_pd(g, x[1]));
+    H[1] = _mm256_add_pd(_mm256_sub_pd(x[3], x[0]), _mm256_mul_pd(h, x[3]));
+    H[2] = x[0];
+    H[3] = _mm256_add_pd(_mm256_sub_pd(y[1], y[0]), _mm256_mul_pd(g, y[1]));
+    H[4] = _mm256_add_pd(_mm256_sub_pd(y[3], y[0]), _mm256_mul_pd(h, y[3]));
+    H[5] = y[0];
+    H[6] = g;
+    H[7] = h;
+    H[8] = _mm256_set1_pd(1.0);
+}
+
+TARGET_AVX2 static FORCE_INLINE void Adjugate4(const __m256d M[9], __m256d adj[9])
+{
+    adj[0] = MulSub(M[4], M[8], M[5], M[7]);
+    adj[1] = MulSub(M[2], M[7], M[1], M[8]);
+    adj[2] = MulSub(M[1], M[5], M[2], M[4]);
+    adj[3] = MulSub(M[5], M[6], M[3], M[8]);
+    adj[4] = MulSub(M[0], M[8], M[2], M[6]);
+    adj[5] = MulSub(M[2], M[3], M[0], M[5]);
+    adj[6] = MulSub(M[3], M[7], M[4], M[6]);
+    adj[7] = MulSub(M[1], M[6], M[0], M[7]);
+    adj[8] = MulSub(M[0], M[4], M[1], M[3]);
+}
+
+/*
+ *  Scales M so M[8] = 1, returning the lanes where M[8] was too small for that.
+ */
+TARGET_AVX2 static FORCE_INLINE __m256d NormalizeHomography4(__m256d M[9])
+{
+    __m256d largest = _mm256_setzero_pd();
+    for (int i = 0; i < 9; i++)
+        largest = _mm256_max_pd(largest, Abs(M[i]));
+    __m256d bad = _mm256_cmp_pd(Abs(M[8]), _mm256_mul_pd(_mm256_set1_pd(1e-12), largest), _CMP_NGT_UQ);
+
+    const __m256d scale = _mm256_div_pd(_mm256_set1_pd(1.0), M[8]);
+    for (int i = 0; i < 8; i++)
+        M[i] = _mm256_mul_pd(M[i], scale);
+    M[8] = _mm256_set1_pd(1.0);
+    return bad;
+}
+
+TARGET_AVX2 static void SolveBatchAVX2(const HomographyBatch& batch, int begin, int end)
+{
+    const __m256d invWidth = _mm256_set1_pd(1.0 / batch.width);
+    const __m256d invHeight = _mm256_set1_pd(1.0 / batch.height);
+    const __m256d nan = _mm256_set1_pd(NAN);
+
+    int n = begin;
+    for (; n + 4 <= end; n += 4)
+    {
+        __m256d degenerate = _mm256_setzero_pd(), illConditioned = degenerate, notConvex = degenerate;
+        __m256d H[9];
+        SquareToQuad4(batch.dst, n, H, degenerate, illConditioned, notConvex);
+
+        if (batch.src)
+        {
+            __m256d S[9], adj[9], D[9];
+            SquareToQuad4(*batch.src, n, S, degenerate, illConditioned, notConvex);
+            Adjugate4(S, adj);
+            for (int i = 0; i < 9; i++)
+                D[i] = H[i];
+            for (int row = 0; row < 3; row++)
+                for (int col = 0; col < 3; col++)
+                    H[row * 3 + col] = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(D[row * 3], adj[col]),
+                        _mm256_mul_pd(D[row * 3 + 1], adj[3 + col])), _mm256_mul_pd(D[row * 3 + 2], adj[6 + col]));
+            degenerate = _mm256_or_pd(degenerate, NormalizeHomography4(H));
+        }
+        else
+        {
+            for (int row = 0; row < 3; row++)
+            {
+                H[row * 3] = _mm256_mul_pd(H[row * 3], invWidth);
+                H[row * 3 + 1] = _mm256_mul_pd(H[row * 3 + 1], invHeight);
+            }
+        }
+
+        __m256d inverse[9];
+        Adjugate4(H, inverse);
+        degenerate = _mm256_or_pd(degenerate, NormalizeHomography4(inverse));
+
+        for (int k = 0; k < 9; k++)
+        {
+            _mm_storeu_ps(batch.forward.m[k] + n, _mm256_cvtpd_ps(_mm256_blendv_pd(H[k], nan, degenerate)));
+            _mm_storeu_ps(batch.inverse.m[k] + n, _mm256_cvtpd_ps(_mm256_blendv_pd(inverse[k], nan, degenerate)));
+        }
+
+        int degenerateBits = _mm256_movemask_pd(degenerate);
+        int illBits = _mm256_movemask_pd(illConditioned);
+        int convexBits = _mm256_movemask_pd(notConvex);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            batch.flags[n + lane] = (unsigned char)(
+                (((degenerateBits >> lane) & 1) ? HOMOGRAPHY_DEGENERATE : 0) |
+                (((convexBits >> lane) & 1) ? HOMOGRAPHY_NOT_CONVEX : 0) |
+                (((illBits >> lane) & 1) ? HOMOGRAPHY_ILL_CONDITIONED : 0));
+        }
+    }
+    if (n < end)
+        GetHomographyBatchFuncScalar()(batch, n, end);
+}
+
+HomographyBatchFunc GetHomographyBatchFuncAVX2()
+{
+    return SolveBatchAVX2;
+}
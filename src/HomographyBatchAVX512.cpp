@@ -0,0 +1,183 @@
+#include "HomographyBatch.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+// gcc and clang treat these intrinsics as plain vector arithmetic and would fuse
+// multiplies into adds now that FMA is enabled, rounding differently from the
+// scalar solver. (MSVC never contracts intrinsics.)
+#if defined(__clang__)
+    #pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+    #pragma GCC optimize("fp-contract=off")
+#endif
+
+/*
+ *  8 problems at a time, one per double lane. Mirrors SolveBatchScalar operation
+ *  for operation (separate multiplies and adds, IEEE division) so the results
+ *  match it bit for bit; the leftover problems go through the scalar solver.
+ */
+
+TARGET_AVX512 static FORCE_INLINE __m512d Abs(__m512d value)
+{
+    return _mm512_abs_pd(value);
+}
+
+TARGET_AVX512 static FORCE_INLINE __m512d MulSub(__m512d a, __m512d b, __m512d c, __m512d d)
+{
+    return _mm512_sub_pd(_mm512_mul_pd(a, b), _mm512_mul_pd(c, d));
+}
+
+/*
+ *  Square -> quad matrices for problems [n, n + 8), plus their flag masks.
+ */
+TARGET_AVX512 static FORCE_INLINE void SquareToQuad8(const QuadArrays& quad, int n, __m512d H[9],
+    __mmask8& degenerate, __mmask8& illConditioned, __mmask8& notConvex)
+{
+    __m512d x[4], y[4];
+    for (int i = 0; i < 4; i++)
+    {
+        x[i] = _mm512_loadu_pd(quad.x[i] + n);
+        y[i] = _mm512_loadu_pd(quad.y[i] + n);
+    }
+
+    __m512d minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (int i = 1; i < 4; i++)
+    {
+        minX = _mm512_min_pd(minX, x[i]);
+        maxX = _mm512_max_pd(maxX, x[i]);
+        minY = _mm512_min_pd(minY, y[i]);
+        maxY = _mm512_max_pd(maxY, y[i]);
+    }
+    const __m512d size = _mm512_max_pd(_mm512_sub_pd(maxX, minX), _mm512_sub_pd(maxY, minY));
+    const __m512d sizeSquared = _mm512_mul_pd(size, size);
+
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d minArea = _mm512_set1_pd(HUGE_VAL);
+    __mmask8 allPositive = 0xFF, allNegative = 0xFF;
+    for (int i = 0; i < 4; i++)
+    {
+        int b = (i + 1) & 3, c = (i + 2) & 3;
+        __m512d area = MulSub(_mm512_sub_pd(x[b], x[i]), _mm512_sub_pd(y[c], y[i]),
+            _mm512_sub_pd(x[c], x[i]), _mm512_sub_pd(y[b], y[i]));
+        minArea = _mm512_min_pd(minArea, Abs(area));
+        allPositive &= _mm512_cmp_pd_mask(area, zero, _CMP_GT_OQ);
+        allNegative &= _mm512_cmp_pd_mask(area, zero, _CMP_LT_OQ);
+    }
+
+    degenerate |= _mm512_cmp_pd_mask(minArea,
+        _mm512_mul_pd(_mm512_set1_pd(HOMOGRAPHY_DEGENERATE_AREA), sizeSquared), _CMP_NGT_UQ);
+    illConditioned |= _mm512_cmp_pd_mask(minArea,
+        _mm512_mul_pd(_mm512_set1_pd(HOMOGRAPHY_ILL_CONDITIONED_AREA), sizeSquared), _CMP_LT_OQ);
+    notConvex |= (__mmask8)~(allPositive | allNegative);
+
+    const __m512d sumX = _mm512_sub_pd(_mm512_add_pd(_mm512_sub_pd(x[0], x[1]), x[2]), x[3]);
+    const __m512d sumY = _mm512_sub_pd(_mm512_add_pd(_mm512_sub_pd(y[0], y[1]), y[2]), y[3]);
+    const __m512d dx1 = _mm512_sub_pd(x[1], x[2]), dx2 = _mm512_sub_pd(x[3], x[2]);
+    const __m512d dy1 = _mm512_sub_pd(y[1], y[2]), dy2 = _mm512_sub_pd(y[3], y[2]);
+    const __m512d den = MulSub(dx1, dy2, dx2, dy1);
+    const __m512d g = _mm512_div_pd(MulSub(sumX, dy2, dx2, sumY), den);
+    const __m512d h = _mm512_div_pd(MulSub(dx1, sumY, sumX, dy1), den);
+
+    H[0] = _mm512_add_pd(_mm512_sub_pd(x[1], x[0]), _mm512_mul_pd(g, x[1]));
+    H[1] = _mm512_add_pd(_mm512_sub_pd(x[3], x[0]), _mm512_mul_pd(h, x[3]));
+    H[2] = x[0];
+    H[3] = _mm512_add_pd(_mm512_sub_pd(y[1], y[0]), _mm512_mul_pd(g, y[1]));
+    H[4] = _mm512_add_pd(_mm512_sub_pd(y[3], y[0]), _mm512_mul_pd(h, y[3]));
+    H[5] = y[0];
+    H[6] = g;
+    H[7] = h;
+    H[8] = _mm512_set1_pd(1.0);
+}
+
+TARGET_AVX512 static FORCE_INLINE void Adjugate8(const __m512d M[9], __m512d adj[9])
+{
+    adj[0] = MulSub(M[4], M[8], M[5], M[7]);
+    adj[1] = MulSub(M[2], M[7], M[1], M[8]);
+    adj[2] = MulSub(M[1], M[5], M[2], M[4]);
+    adj[3] = MulSub(M[5], M[6], M[3], M[8]);
+    adj[4] = MulSub(M[0], M[8], M[2], M[6]);
+    adj[5] = MulSub(M[2], M[3], M[0], M[5]);
+    adj[6] = MulSub(M[3], M[7], M[4], M[6]);
+    adj[7] = MulSub(M[1], M[6], M[0], M[7]);
+    adj[8] = MulSub(M[0], M[4], M[1], M[3]);
+}
+
+/*
+ *  Scales M so M[8] = 1, returning the lanes where M[8] was too small for that.
+ */
+TARGET_AVX512 static FORCE_INLINE __mmask8 NormalizeHomography8(__m512d M[9])
+{
+    __m512d largest = _mm512_setzero_pd();
+    for (int i = 0; i < 9; i++)
+        largest = _mm512_max_pd(largest, Abs(M[i]));
+    __mmask8 bad = _mm512_cmp_pd_mask(Abs(M[8]), _mm512_mul_pd(_mm512_set1_pd(1e-12), largest), _CMP_NGT_UQ);
+
+    const __m512d scale = _mm512_div_pd(_mm512_set1_pd(1.0), M[8]);
+    for (int i = 0; i < 8; i++)
+        M[i] = _mm512_mul_pd(M[i], scale);
+    M[8] = _mm512_set1_pd(1.0);
+    return bad;
+}
+
+TARGET_AVX512 static void SolveBatchAVX512(const HomographyBatch& batch, int begin, int end)
+{
+    const __m512d invWidth = _mm512_set1_pd(1.0 / batch.width);
+    const __m512d invHeight = _mm512_set1_pd(1.0 / batch.height);
+    const __m512d nan = _mm512_set1_pd(NAN);
+
+    int n = begin;
+    for (; n + 8 <= end; n += 8)
+    {
+        __mmask8 degenerate = 0, illConditioned = 0, notConvex = 0;
+        __m512d H[9];
+        SquareToQuad8(batch.dst, n, H, degenerate, illConditioned, notConvex);
+
+        if (batch.src)
+        {
+            __m512d S[9], adj[9], D[9];
+            SquareToQuad8(*batch.src, n, S, degenerate, illConditioned, notConvex);
+            Adjugate8(S, adj);
+            for (int i = 0; i < 9; i++)
+                D[i] = H[i];
+            for (int row = 0; row < 3; row++)
+                for (int col = 0; col < 3; col++)
+                    H[row * 3 + col] = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(D[row * 3], adj[col]),
+                        _mm512_mul_pd(D[row * 3 + 1], adj[3 + col])), _mm512_mul_pd(D[row * 3 + 2], adj[6 + col]));
+            degenerate |= NormalizeHomography8(H);
+        }
+        else
+        {
+            for (int row = 0; row < 3; row++)
+            {
+                H[row * 3] = _mm512_mul_pd(H[row * 3], invWidth);
+                H[row * 3 + 1] = _mm512_mul_pd(H[row * 3 + 1], invHeight);
+            }
+        }
+
+        __m512d inverse[9];
+        Adjugate8(H, inverse);
+        degenerate |= NormalizeHomography8(inverse);
+
+        for (int k = 0; k < 9; k++)
+        {
+            _mm256_storeu_ps(batch.forward.m[k] + n, _mm512_cvtpd_ps(_mm512_mask_blend_pd(degenerate, H[k], nan)));
+            _mm256_storeu_ps(batch.inverse.m[k] + n, _mm512_cvtpd_ps(_mm512_mask_blend_pd(degenerate, inverse[k], nan)));
+        }
+
+        for (int lane = 0; lane < 8; lane++)
+        {
+            batch.flags[n + lane] = (unsigned char)(
+                (((degenerate >> lane) & 1) ? HOMOGRAPHY_DEGENERATE : 0) |
+                (((notConvex >> lane) & 1) ? HOMOGRAPHY_NOT_CONVEX : 0) |
+                (((illConditioned >> lane) & 1) ? HOMOGRAPHY_ILL_CONDITIONED : 0));
+        }
+    }
+    if (n < end)
+        GetHomographyBatchFuncScalar()(batch, n, end);
+}
+
+HomographyBatchFunc GetHomographyBatchFuncAVX512()
+{
+    return SolveBatchAVX512;
+}
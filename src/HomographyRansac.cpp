@@ -0,0 +1,297 @@
+#include "HomographyRansac.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Hypotheses per round, and per task within a round. Rounds are a fixed size
+// (rather than scaled to the thread count) so that where the adaptive stop lands,
+// and so the result, is the same on every machine.
+static const int RANSAC_ROUND_TASKS = 16;
+static const int RANSAC_TASK_HYPOTHESES = 8;
+
+// Pairs counted between checks on whether a hypothesis can still win.
+static const int RANSAC_COUNT_CHUNK = 256;
+
+// Tries at drawing a usable sample before a hypothesis is given up on.
+static const int RANSAC_SAMPLE_ATTEMPTS = 16;
+
+// Refit / recount passes on the winner's inliers.
+static const int RANSAC_REFINE_PASSES = 3;
+
+static int CountInliersScalar(const float H[9], const RansacPoints& points,
+    float thresholdSquared, int begin, int end, unsigned char* inliers)
+{
+    int count = 0;
+    for (int i = begin; i < end; i++)
+    {
+        // Compare against the threshold scaled by w^2 rather than dividing by w.
+        const float x = points.srcX[i], y = points.srcY[i];
+        const float u = H[0] * x + H[1] * y + H[2];
+        const float v = H[3] * x + H[4] * y + H[5];
+        const float w = H[6] * x + H[7] * y + H[8];
+        const float du = u - points.dstX[i] * w;
+        const float dv = v - points.dstY[i] * w;
+        const bool inlier = (w > 0.0f) && (du * du + dv * dv <= thresholdSquared * (w * w));
+        count += inlier;
+        if (inliers)
+            inliers[i] = inlier;
+    }
+    return count;
+}
+
+CountInliersFunc GetCountInliersFuncScalar()
+{
+    return CountInliersScalar;
+}
+
+CountInliersFunc GetCountInliersFunc()
+{
+    static const CountInliersFunc func = []
+    {
+        switch (DetectSimdLevel())
+        {
+            case SimdLevel::AVX512: return GetCountInliersFuncAVX512();
+            case SimdLevel::AVX2:   return GetCountInliersFuncAVX2();
+            default:                return GetCountInliersFuncScalar();
+        }
+    }();
+    return func;
+}
+
+/*
+ *  SplitMix64; one generator per hypothesis, seeded from its index, so samples
+ *  don't depend on which thread draws them.
+ */
+static unsigned long long NextRandom(unsigned long long& state)
+{
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static double TriangleArea(const Point& a, const Point& b, const Point& c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+}
+
+/*
+ *  Hypothesis number "hypothesis": the homography through a random sample of
+ *  4 pairs, or false if no usable sample turned up.
+ */
+static bool MakeHypothesis(const Point* src, const Point* dst, int count, unsigned int seed,
+    int hypothesis, double H[9])
+{
+    unsigned long long state = ((unsigned long long)seed << 32) ^ (unsigned int)hypothesis;
+    for (int attempt = 0; attempt < RANSAC_SAMPLE_ATTEMPTS; attempt++)
+    {
+        int sample[4];
+        for (int i = 0; i < 4; i++)
+        {
+            bool repeated;
+            do
+            {
+                sample[i] = (int)(((NextRandom(state) >> 32) * (unsigned long long)count) >> 32);
+                repeated = false;
+                for (int j = 0; j < i; j++)
+                    repeated |= (sample[j] == sample[i]);
+            } while (repeated);
+        }
+
+        Point s[4], d[4];
+        for (int i = 0; i < 4; i++)
+        {
+            s[i] = src[sample[i]];
+            d[i] = dst[sample[i]];
+        }
+
+        // A homography keeps every triangle's orientation, or flips all of them
+        // (a mirror). Mixed flips mean a mismatched pair, so skip the solve.
+        int same = 0, flipped = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            double product = TriangleArea(s[i], s[(i + 1) & 3], s[(i + 2) & 3]) *
+                TriangleArea(d[i], d[(i + 1) & 3], d[(i + 2) & 3]);
+            same += (product > 0.0);
+            flipped += (product < 0.0);
+        }
+        if (same != 4 && flipped != 4)
+            continue;
+
+        if (SolveHomographyExact(s, d, H))
+            return true;
+    }
+    return false;
+}
+
+/*
+ *  Inliers of H among all the pairs, giving up (and returning -1) as soon as
+ *  the count can no longer reach "target".
+ */
+static int ScoreHypothesis(const float H[9], const RansacPoints& points, int count,
+    float thresholdSquared, int target, CountInliersFunc countInliers)
+{
+    int inliers = 0;
+    for (int begin = 0; begin < count; begin += RANSAC_COUNT_CHUNK)
+    {
+        int end = std::min(begin + RANSAC_COUNT_CHUNK, count);
+        inliers += countInliers(H, points, thresholdSquared, begin, end, nullptr);
+        if (inliers + (count - end) < target)
+            return -1;
+    }
+    return inliers;
+}
+
+static void ToFloat(const double H[9], float F[9])
+{
+    for (int i = 0; i < 9; i++)
+        F[i] = (float)H[i];
+}
+
+static void ToFloat(const Matrix3D& M, float F[9])
+{
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 3; col++)
+            F[row * 3 + col] = M(row, col);
+}
+
+/*
+ *  Hypotheses needed to draw an all-inlier sample with the given confidence,
+ *  if a fraction "inlierRatio" of the pairs are inliers.
+ */
+static int RequiredIterations(double inlierRatio, double confidence, int maxIterations)
+{
+    double allInliers = pow(inlierRatio, 4.0);
+    if (allInliers >= 1.0)
+        return 1;
+    if (allInliers <= 0.0)
+        return maxIterations;
+
+    double needed = log(1.0 - confidence) / log(1.0 - allInliers);
+    return (needed < (double)maxIterations) ? std::max(1, (int)ceil(needed)) : maxIterations;
+}
+
+bool EstimateHomographyRansac(const Point* src, const Point* dst, int count,
+    const RansacOptions& options, RansacResult& result)
+{
+    if (count < 4)
+        return false;
+
+    std::vector<float> pointData(4 * (size_t)count);
+    float* srcX = pointData.data();
+    float* srcY = srcX + count;
+    float* dstX = srcY + count;
+    float* dstY = dstX + count;
+    for (int i = 0; i < count; i++)
+    {
+        srcX[i] = (float)src[i].x;
+        srcY[i] = (float)src[i].y;
+        dstX[i] = (float)dst[i].x;
+        dstY[i] = (float)dst[i].y;
+    }
+    const RansacPoints points = { srcX, srcY, dstX, dstY };
+    const float thresholdSquared = (float)(options.threshold * options.threshold);
+    const double confidence = std::min(std::max(options.confidence, 0.0), 1.0 - 1e-12);
+    const CountInliersFunc countInliers = GetCountInliersFunc();
+
+    struct Hypothesis
+    {
+        double H[9];
+        int inliers;
+    };
+    Hypothesis rounds[RANSAC_ROUND_TASKS * RANSAC_TASK_HYPOTHESES];
+
+    double bestH[9];
+    int bestInliers = -1;
+    int iterations = 0;
+    int required = std::max(options.maxIterations, 0);
+
+    while (iterations < required)
+    {
+        const int roundSize = std::min((int)(sizeof(rounds) / sizeof(rounds[0])), required - iterations);
+        const int taskCount = (roundSize + RANSAC_TASK_HYPOTHESES - 1) / RANSAC_TASK_HYPOTHESES;
+
+        // Anything that can't at least match the best so far is cut short; ties
+        // would go to the earlier hypothesis anyway.
+        const int target = std::max(bestInliers + 1, 4);
+        WorkerPool::Get().ParallelFor(taskCount, [&](int task)
+        {
+            int begin = task * RANSAC_TASK_HYPOTHESES;
+            int end = std::min(begin + RANSAC_TASK_HYPOTHESES, roundSize);
+            for (int n = begin; n < end; n++)
+            {
+                Hypothesis& hypothesis = rounds[n];
+                hypothesis.inliers = -1;
+                if (!MakeHypothesis(src, dst, count, options.seed, iterations + n, hypothesis.H))
+                    continue;
+
+                float H[9];
+                ToFloat(hypothesis.H, H);
+                hypothesis.inliers = ScoreHypothesis(H, points, count, thresholdSquared, target, countInliers);
+            }
+        });
+
+        for (int n = 0; n < roundSize; n++)
+        {
+            if (rounds[n].inliers > bestInliers)
+            {
+                bestInliers = rounds[n].inliers;
+                std::copy(rounds[n].H, rounds[n].H + 9, bestH);
+            }
+        }
+        iterations += roundSize;
+
+        if (bestInliers >= 4)
+            required = std::min(required, RequiredIterations((double)bestInliers / count, confidence, options.maxIterations));
+    }
+
+    if (bestInliers < 4)
+        return false;
+
+    Matrix3D best;
+    best << (float)bestH[0], (float)bestH[1], (float)bestH[2],
+            (float)bestH[3], (float)bestH[4], (float)bestH[5],
+            (float)bestH[6], (float)bestH[7], (float)bestH[8];
+
+    std::vector<unsigned char> inliers(count);
+    float H[9];
+    ToFloat(bestH, H);
+    bestInliers = countInliers(H, points, thresholdSquared, 0, count, inliers.data());
+
+    // Refit to every inlier. The least squares fit beats the 4 pair sample even
+    // when it trades a borderline pair or two, so always take the first one; then
+    // repeat while that keeps picking up more.
+    if (options.refine)
+    {
+        std::vector<double> weights(count);
+        std::vector<unsigned char> refitInliers(count);
+        for (int pass = 0; pass < RANSAC_REFINE_PASSES; pass++)
+        {
+            for (int i = 0; i < count; i++)
+                weights[i] = inliers[i];
+
+            Matrix3D refit;
+            if (!SolveHomographyDLT(src, dst, count, weights.data(), refit))
+                break;
+
+            ToFloat(refit, H);
+            int refitCount = countInliers(H, points, thresholdSquared, 0, count, refitInliers.data());
+            if (pass > 0 && refitCount < bestInliers)
+                break;
+
+            best = refit;
+            inliers.swap(refitInliers);
+            bool improved = refitCount > bestInliers;
+            bestInliers = refitCount;
+            if (!improved)
+                break;
+        }
+    }
+
+    result.matrix = best;
+    result.inlierCount = bestInliers;
+    result.iterations = iterations;
+    result.inliers.swap(inliers);
+    return true;
+}
@@ -0,0 +1,66 @@
+#include "HomographyRansac.h"
+
+#include <immintrin.h>
+
+// Keep gcc and clang from fusing the multiplies and adds below now that FMA is
+// enabled, so the counts match the scalar counter exactly. (MSVC never contracts
+// intrinsics.)
+#if defined(__clang__)
+    #pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+    #pragma GCC optimize("fp-contract=off")
+#endif
+
+/*
+ *  8 pairs at a time, with the same operations in the same order as
+ *  CountInliersScalar. Each lane keeps its own count (subtracting the all-ones
+ *  compare mask adds 1), summed once at the end.
+ */
+TARGET_AVX2 static int CountInliersAVX2(const float H[9], const RansacPoints& points,
+    float thresholdSquared, int begin, int end, unsigned char* inliers)
+{
+    __m256 h[9];
+    for (int k = 0; k < 9; k++)
+        h[k] = _mm256_set1_ps(H[k]);
+    const __m256 threshold = _mm256_set1_ps(thresholdSquared);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256i counts = _mm256_setzero_si256();
+    int i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(points.srcX + i);
+        const __m256 y = _mm256_loadu_ps(points.srcY + i);
+        const __m256 u = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(h[0], x), _mm256_mul_ps(h[1], y)), h[2]);
+        const __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(h[3], x), _mm256_mul_ps(h[4], y)), h[5]);
+        const __m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(h[6], x), _mm256_mul_ps(h[7], y)), h[8]);
+        const __m256 du = _mm256_sub_ps(u, _mm256_mul_ps(_mm256_loadu_ps(points.dstX + i), w));
+        const __m256 dv = _mm256_sub_ps(v, _mm256_mul_ps(_mm256_loadu_ps(points.dstY + i), w));
+        const __m256 distance = _mm256_add_ps(_mm256_mul_ps(du, du), _mm256_mul_ps(dv, dv));
+
+        const __m256 inlier = _mm256_and_ps(_mm256_cmp_ps(w, zero, _CMP_GT_OQ),
+            _mm256_cmp_ps(distance, _mm256_mul_ps(threshold, _mm256_mul_ps(w, w)), _CMP_LE_OQ));
+        counts = _mm256_sub_epi32(counts, _mm256_castps_si256(inlier));
+
+        if (inliers)
+        {
+            int bits = _mm256_movemask_ps(inlier);
+            for (int lane = 0; lane < 8; lane++)
+                inliers[i + lane] = (unsigned char)((bits >> lane) & 1);
+        }
+    }
+
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(counts), _mm256_extracti128_si256(counts, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    int count = _mm_cvtsi128_si32(sum);
+
+    if (i < end)
+        count += GetCountInliersFuncScalar()(H, points, thresholdSquared, i, end, inliers);
+    return count;
+}
+
+CountInliersFunc GetCountInliersFuncAVX2()
+{
+    return CountInliersAVX2;
+}
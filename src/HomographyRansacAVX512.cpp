@@ -0,0 +1,56 @@
+#include "HomographyRansac.h"
+
+#include <immintrin.h>
+
+// See HomographyRansacAVX2.cpp.
+#if defined(__clang__)
+    #pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+    #pragma GCC optimize("fp-contract=off")
+#endif
+
+/*
+ *  16 pairs at a time, otherwise the same as CountInliersAVX2. The compare
+ *  results live in mask registers, which add 1 to just the inlier lanes' counts.
+ */
+TARGET_AVX512 static int CountInliersAVX512(const float H[9], const RansacPoints& points,
+    float thresholdSquared, int begin, int end, unsigned char* inliers)
+{
+    __m512 h[9];
+    for (int k = 0; k < 9; k++)
+        h[k] = _mm512_set1_ps(H[k]);
+    const __m512 threshold = _mm512_set1_ps(thresholdSquared);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512i one = _mm512_set1_epi32(1);
+
+    __m512i counts = _mm512_setzero_si512();
+    int i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        const __m512 x = _mm512_loadu_ps(points.srcX + i);
+        const __m512 y = _mm512_loadu_ps(points.srcY + i);
+        const __m512 u = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(h[0], x), _mm512_mul_ps(h[1], y)), h[2]);
+        const __m512 v = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(h[3], x), _mm512_mul_ps(h[4], y)), h[5]);
+        const __m512 w = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(h[6], x), _mm512_mul_ps(h[7], y)), h[8]);
+        const __m512 du = _mm512_sub_ps(u, _mm512_mul_ps(_mm512_loadu_ps(points.dstX + i), w));
+        const __m512 dv = _mm512_sub_ps(v, _mm512_mul_ps(_mm512_loadu_ps(points.dstY + i), w));
+        const __m512 distance = _mm512_add_ps(_mm512_mul_ps(du, du), _mm512_mul_ps(dv, dv));
+
+        const __mmask16 inlier = _mm512_cmp_ps_mask(w, zero, _CMP_GT_OQ) &
+            _mm512_cmp_ps_mask(distance, _mm512_mul_ps(threshold, _mm512_mul_ps(w, w)), _CMP_LE_OQ);
+        counts = _mm512_mask_add_epi32(counts, inlier, counts, one);
+
+        if (inliers)
+            _mm_storeu_si128((__m128i*)(inliers + i), _mm512_cvtepi32_epi8(_mm512_maskz_mov_epi32(inlier, one)));
+    }
+    int count = _mm512_reduce_add_epi32(counts);
+
+    if (i < end)
+        count += GetCountInliersFuncScalar()(H, points, thresholdSquared, i, end, inliers);
+    return count;
+}
+
+CountInliersFunc GetCountInliersFuncAVX512()
+{
+    return CountInliersAVX512;
+}
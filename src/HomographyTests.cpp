@@ -0,0 +1,648 @@
+/*
+ *  Homography tests: checks the closed form solvers in Homography.h against
+ *  the LU reference on random quads, and that degenerate quads take the
+ *  fallback (or fail) instead of returning garbage; likewise for the batch
+ *  solvers and RANSAC inlier counters at every instruction set the CPU has. Prints every failed check
+ *  and exits with 1 if there were any.
+ *
+ *  Usage: HomographyTests
+ */
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Homography.h"
+#include "HomographyBatch.h"
+#include "HomographyRansac.h"
+#include "WorkerPool.h"
+
+static int failures = 0;
+
+static void Check(bool ok, const std::string& what)
+{
+    if (!ok)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+static Point Map(const double H[9], const Point& p)
+{
+    const double w = H[6] * p.x + H[7] * p.y + H[8];
+    return Point((H[0] * p.x + H[1] * p.y + H[2]) / w, (H[3] * p.x + H[4] * p.y + H[5]) / w);
+}
+
+// Evaluated in double, so only the rounding of M itself to float counts.
+static Point Map(const Matrix3D& M, const Point& p)
+{
+    const double H[9] =
+    {
+        M(0, 0), M(0, 1), M(0, 2),
+        M(1, 0), M(1, 1), M(1, 2),
+        M(2, 0), M(2, 1), M(2, 2)
+    };
+    return Map(H, p);
+}
+
+/*
+ *  Largest distance, in pixels, between where M takes src[i] and dst[i].
+ */
+template <typename Matrix>
+static double ReprojectionError(const Matrix& M, const Point src[4], const Point dst[4])
+{
+    double worst = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        const Point p = Map(M, src[i]);
+        const double error = std::hypot(p.x - dst[i].x, p.y - dst[i].y);
+        worst = (error > worst || std::isnan(error)) ? error : worst;
+    }
+    return worst;
+}
+
+/*
+ *  Whether the quad's corners turn the same way all the way around.
+ */
+static bool IsConvex(const Point quad[4])
+{
+    int positive = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        const Point& a = quad[i];
+        const Point& b = quad[(i + 1) % 4];
+        const Point& c = quad[(i + 2) % 4];
+        positive += ((b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x) > 0.0);
+    }
+    return positive == 0 || positive == 4;
+}
+
+/*
+ *  A random convex quad about the size of a window, one corner in each
+ *  quadrant around (cx, cy), in the corner order the solvers use.
+ */
+static void RandomQuad(std::mt19937& rng, double cx, double cy, Point quad[4])
+{
+    std::uniform_real_distribution<double> offset(50.0, 600.0);
+    const double signX[4] = { -1.0, 1.0, 1.0, -1.0 };
+    const double signY[4] = { -1.0, -1.0, 1.0, 1.0 };
+    do
+    {
+        for (int i = 0; i < 4; i++)
+            quad[i] = Point(cx + signX[i] * offset(rng), cy + signY[i] * offset(rng));
+    } while (!IsConvex(quad));
+}
+
+/*
+ *  The closed form (in double, and rounded to a float Matrix3D) against the
+ *  8x8 LU system on random convex quads. Some of them are strongly projective,
+ *  where even rounding the exact matrix to float moves corners a fraction of a
+ *  pixel, so the float solvers are held to the LU's error rather than to zero.
+ */
+static void TestRandomQuads()
+{
+    const int quadCount = 1000;
+    std::mt19937 rng(1);
+    double worstExact = 0.0, worstClosed = 0.0, worstLU = 0.0;
+    double totalClosed = 0.0, totalLU = 0.0;
+    for (int n = 0; n < quadCount; n++)
+    {
+        Point src[4], dst[4];
+        RandomQuad(rng, 700.0, 500.0, src);
+        RandomQuad(rng, 900.0, 600.0, dst);
+
+        double H[9];
+        const bool exact = SolveHomographyExact(src, dst, H);
+        Check(exact, "SolveHomographyExact solves random convex quad " + std::to_string(n));
+        if (!exact)
+            continue;
+        worstExact = std::fmax(worstExact, ReprojectionError(H, src, dst));
+        const double closed = ReprojectionError(SolveHomography(src, dst), src, dst);
+        const double lu = ReprojectionError(SolveHomographyLU(src, dst), src, dst);
+        worstClosed = std::fmax(worstClosed, closed);
+        worstLU = std::fmax(worstLU, lu);
+        totalClosed += closed;
+        totalLU += lu;
+    }
+
+    std::cout << "Random convex quads, worst (mean) reprojection error: exact " << worstExact
+        << " px, closed form " << worstClosed << " (" << totalClosed / quadCount << ") px, LU "
+        << worstLU << " (" << totalLU / quadCount << ") px" << std::endl;
+    Check(worstExact < 1e-6, "SolveHomographyExact reprojects to within 1e-6 px");
+    Check(worstClosed < 0.5, "SolveHomography reprojects to within half a pixel");
+    Check(worstClosed <= worstLU, "SolveHomography's worst error is no worse than SolveHomographyLU's");
+    Check(totalClosed <= totalLU, "SolveHomography's mean error is no worse than SolveHomographyLU's");
+}
+
+/*
+ *  Quads too close to degenerate for the closed form: SolveHomographyExact
+ *  refuses them, and SolveHomography hands them to the LU solver as is.
+ */
+static void TestNearDegenerateFallback()
+{
+    const Point square[4] = { Point(0, 0), Point(100, 0), Point(100, 100), Point(0, 100) };
+    const Point nearlyCollinear[4] = { Point(0, 0), Point(100, 0), Point(200, 1e-9), Point(0, 100) };
+    const Point repeated[4] = { Point(10, 10), Point(10, 10), Point(300, 200), Point(20, 220) };
+    const Point* quads[] = { nearlyCollinear, repeated };
+
+    for (const Point* quad : quads)
+    {
+        for (int asSource = 0; asSource < 2; asSource++)
+        {
+            const Point* src = asSource ? quad : square;
+            const Point* dst = asSource ? square : quad;
+            const std::string name = std::string(quad == repeated ? "repeated" : "nearly collinear")
+                + (asSource ? " source" : " destination");
+
+            double H[9];
+            Check(!SolveHomographyExact(src, dst, H), "SolveHomographyExact refuses a " + name);
+
+            const Matrix3D fallback = SolveHomography(src, dst);
+            const Matrix3D lu = SolveHomographyLU(src, dst);
+            const bool same = (fallback.array() == lu.array() || (fallback.array().isNaN() && lu.array().isNaN())).all();
+            Check(same, "SolveHomography falls back to SolveHomographyLU for a " + name);
+        }
+    }
+}
+
+/*
+ *  SolveRectToQuad folds the rectangle into the unit square solution; it has
+ *  to agree with solving the rectangle's corners quad to quad.
+ */
+static void TestRectToQuad()
+{
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> size(1, 4000);
+    double worstCorner = 0.0, worstDifference = 0.0;
+    for (int n = 0; n < 200; n++)
+    {
+        const int width = size(rng), height = size(rng);
+        const Point rect[4] = { Point(0, 0), Point(width, 0), Point(width, height), Point(0, height) };
+        Point dst[4];
+        RandomQuad(rng, 900.0, 600.0, dst);
+
+        const Matrix3D fromRect = SolveRectToQuad(width, height, dst);
+        const Matrix3D fromQuad = SolveHomography(rect, dst);
+        worstCorner = std::fmax(worstCorner, ReprojectionError(fromRect, rect, dst));
+
+        // Both have M(2, 2) = 1, so they should map everything the same, not just the corners.
+        for (int i = 0; i <= 4; i++)
+        {
+            for (int j = 0; j <= 4; j++)
+            {
+                const Point p(width * i / 4.0, height * j / 4.0);
+                const Point a = Map(fromRect, p), b = Map(fromQuad, p);
+                worstDifference = std::fmax(worstDifference, std::hypot(a.x - b.x, a.y - b.y));
+            }
+        }
+    }
+
+    std::cout << "Rect to quad: worst corner error " << worstCorner << " px, worst difference from quad to quad "
+        << worstDifference << " px" << std::endl;
+    Check(worstCorner < 0.01, "SolveRectToQuad reprojects to within 0.01 px");
+    Check(worstDifference < 0.01, "SolveRectToQuad agrees with SolveHomography to within 0.01 px");
+}
+
+/*
+ *  Corners all on one line have no homography at all.
+ */
+static void TestCollinear()
+{
+    const Point square[4] = { Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1) };
+    const Point line[4] = { Point(0, 0), Point(100, 0), Point(200, 0), Point(300, 0) };
+    const Point diagonal[4] = { Point(0, 0), Point(10, 10), Point(20, 20), Point(30, 30) };
+    const Point* lines[] = { line, diagonal };
+
+    for (const Point* collinear : lines)
+    {
+        double H[9];
+        for (int i = 0; i < 9; i++)
+            H[i] = 42.0;
+        Check(!SolveHomographyExact(square, collinear, H), "SolveHomographyExact fails for collinear destination corners");
+        Check(!SolveHomographyExact(collinear, square, H), "SolveHomographyExact fails for collinear source corners");
+        Check(!SolveSquareToQuad(collinear, H), "SolveSquareToQuad fails for collinear corners");
+
+        bool untouched = true;
+        for (int i = 0; i < 9; i++)
+            untouched = untouched && H[i] == 42.0;
+        Check(untouched, "failed solves leave H untouched");
+    }
+}
+
+/*
+ *  "count" quads in the structure-of-arrays layout the batch solvers take.
+ */
+struct QuadSet
+{
+    std::vector<double> x[4], y[4];
+
+    explicit QuadSet(int count)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            x[i].resize(count);
+            y[i].resize(count);
+        }
+    }
+
+    void Set(int n, const Point quad[4])
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            x[i][n] = quad[i].x;
+            y[i][n] = quad[i].y;
+        }
+    }
+
+    QuadArrays Arrays() const
+    {
+        QuadArrays arrays;
+        for (int i = 0; i < 4; i++)
+        {
+            arrays.x[i] = x[i].data();
+            arrays.y[i] = y[i].data();
+        }
+        return arrays;
+    }
+};
+
+/*
+ *  Everything one batch solve writes.
+ */
+struct BatchOutput
+{
+    std::vector<float> forward[9], inverse[9];
+    std::vector<unsigned char> flags;
+
+    explicit BatchOutput(int count) : flags(count)
+    {
+        for (int k = 0; k < 9; k++)
+        {
+            forward[k].resize(count);
+            inverse[k].resize(count);
+        }
+    }
+
+    void Fill(HomographyBatch& batch)
+    {
+        for (int k = 0; k < 9; k++)
+        {
+            batch.forward.m[k] = forward[k].data();
+            batch.inverse.m[k] = inverse[k].data();
+        }
+        batch.flags = flags.data();
+    }
+
+    bool operator==(const BatchOutput& other) const
+    {
+        const size_t bytes = flags.size() * sizeof(float);
+        for (int k = 0; k < 9; k++)
+            if (memcmp(forward[k].data(), other.forward[k].data(), bytes) || memcmp(inverse[k].data(), other.inverse[k].data(), bytes))
+                return false;
+        return flags == other.flags;
+    }
+};
+
+/*
+ *  The vector batch solvers against the scalar one, bit for bit, rect to quad
+ *  and quad to quad. A few degenerate quads are mixed in so the NaN outputs and
+ *  flags are compared too, and the problems are split at an odd index so the
+ *  vector loops' partial lanes run.
+ */
+static void TestBatchInstructionSets()
+{
+    const int count = 1003;
+    std::mt19937 rng(3);
+    QuadSet src(count), dst(count);
+    for (int n = 0; n < count; n++)
+    {
+        Point quad[4];
+        RandomQuad(rng, 700.0, 500.0, quad);
+        if (n % 97 == 5)
+            quad[2] = Point(2.0 * quad[1].x - quad[0].x, 2.0 * quad[1].y - quad[0].y);     // Collinear with 0 and 1
+        src.Set(n, quad);
+        RandomQuad(rng, 900.0, 600.0, quad);
+        if (n % 89 == 7)
+            quad[3] = quad[0];
+        dst.Set(n, quad);
+    }
+    const QuadArrays srcArrays = src.Arrays();
+
+    struct Solver
+    {
+        SimdLevel level;
+        HomographyBatchFunc func;
+    };
+    std::vector<Solver> solvers;
+    solvers.push_back({ SimdLevel::Scalar, GetHomographyBatchFuncScalar() });
+    if (DetectSimdLevel() >= SimdLevel::AVX2)
+        solvers.push_back({ SimdLevel::AVX2, GetHomographyBatchFuncAVX2() });
+    if (DetectSimdLevel() >= SimdLevel::AVX512)
+        solvers.push_back({ SimdLevel::AVX512, GetHomographyBatchFuncAVX512() });
+
+    for (int quadToQuad = 0; quadToQuad < 2; quadToQuad++)
+    {
+        std::vector<BatchOutput> outputs;
+        for (const Solver& solver : solvers)
+        {
+            HomographyBatch batch;
+            batch.src = quadToQuad ? &srcArrays : nullptr;
+            batch.width = 640.0;
+            batch.height = 480.0;
+            batch.dst = dst.Arrays();
+            outputs.push_back(BatchOutput(count));
+            outputs.back().Fill(batch);
+            solver.func(batch, 0, 13);
+            solver.func(batch, 13, count);
+        }
+
+        const std::string kind = quadToQuad ? "quad to quad" : "rect to quad";
+        int degenerate = 0;
+        for (unsigned char flags : outputs[0].flags)
+            degenerate += (flags & HOMOGRAPHY_DEGENERATE) != 0;
+        Check(degenerate > 0, "the " + kind + " batch includes degenerate problems");
+        for (size_t i = 1; i < solvers.size(); i++)
+            Check(outputs[i] == outputs[0], std::string(SimdLevelName(solvers[i].level)) + " " + kind +
+                " batch is bit-identical to Scalar");
+    }
+    std::cout << "Batch solvers compared at " << solvers.size() << " instruction set(s)" << std::endl;
+}
+
+/*
+ *  The flags, through the public entry points (so the widest solver): a good
+ *  quad, collinear corners, a concave quad and a quad thin enough to be ill
+ *  conditioned without being degenerate.
+ */
+static void TestBatchFlags()
+{
+    const Point good[4] = { Point(10, 20), Point(600, 40), Point(650, 500), Point(30, 450) };
+    const Point collinear[4] = { Point(0, 0), Point(100, 0), Point(200, 0), Point(100, 100) };
+    const Point concave[4] = { Point(0, 0), Point(100, 0), Point(30, 30), Point(0, 100) };
+    const Point thin[4] = { Point(0, 0), Point(1000, 0), Point(1000, 0.5), Point(0, 0.5) };
+    const Point* quads[] = { good, collinear, concave, thin };
+    const char* names[] = { "good", "collinear", "concave", "thin" };
+    const unsigned char expected[] =
+    {
+        0,
+        HOMOGRAPHY_DEGENERATE | HOMOGRAPHY_NOT_CONVEX | HOMOGRAPHY_ILL_CONDITIONED,
+        HOMOGRAPHY_NOT_CONVEX,
+        HOMOGRAPHY_ILL_CONDITIONED
+    };
+    const int count = 4;
+
+    QuadSet dst(count), src(count);
+    for (int n = 0; n < count; n++)
+    {
+        dst.Set(n, quads[n]);
+        src.Set(n, good);
+    }
+
+    for (int quadToQuad = 0; quadToQuad < 2; quadToQuad++)
+    {
+        HomographyBatch batch;
+        BatchOutput output(count);
+        output.Fill(batch);
+        if (quadToQuad)
+            SolveQuadToQuadBatch(src.Arrays(), dst.Arrays(), count, batch.forward, batch.inverse, batch.flags);
+        else
+            SolveRectToQuadBatch(640, 480, dst.Arrays(), count, batch.forward, batch.inverse, batch.flags);
+
+        const std::string kind = quadToQuad ? " (quad to quad)" : " (rect to quad)";
+        for (int n = 0; n < count; n++)
+        {
+            Check(output.flags[n] == expected[n], std::string(names[n]) + " quad gets flags " +
+                std::to_string(expected[n]) + ", not " + std::to_string(output.flags[n]) + kind);
+
+            bool allNaN = true, allFinite = true;
+            for (int k = 0; k < 9; k++)
+            {
+                allNaN = allNaN && std::isnan(output.forward[k][n]) && std::isnan(output.inverse[k][n]);
+                allFinite = allFinite && std::isfinite(output.forward[k][n]) && std::isfinite(output.inverse[k][n]);
+            }
+            if (expected[n] & HOMOGRAPHY_DEGENERATE)
+                Check(allNaN, std::string(names[n]) + " quad gets NaN matrices" + kind);
+            else
+                Check(allFinite, std::string(names[n]) + " quad gets finite matrices" + kind);
+        }
+    }
+}
+
+/*
+ *  Largest distance between where M and the true matrix take points across a
+ *  (width x height) area.
+ */
+static double GridError(const Matrix3D& M, const double trueH[9], double width, double height)
+{
+    double worst = 0.0;
+    for (int i = 0; i <= 8; i++)
+    {
+        for (int j = 0; j <= 8; j++)
+        {
+            const Point p(width * i / 8.0, height * j / 8.0);
+            const Point a = Map(M, p), b = Map(trueH, p);
+            const double error = std::hypot(a.x - b.x, a.y - b.y);
+            worst = (error > worst || std::isnan(error)) ? error : worst;
+        }
+    }
+    return worst;
+}
+
+/*
+ *  SolveHomographyDLT on more than 4 pairs: exact pairs, pairs with noise, and
+ *  pairs with gross outliers that are weighted out, against a known matrix.
+ */
+static void TestDLT()
+{
+    const double trueH[9] = { 0.9, 0.12, 40.0, -0.08, 1.1, 25.0, 0.0002, -0.0001, 1.0 };
+    const double width = 1000.0, height = 800.0;
+    const int count = 200, outlierCount = 40;
+
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> position(0.0, 1.0);
+    std::normal_distribution<double> noise(0.0, 0.5);
+    std::uniform_real_distribution<double> gross(-200.0, 200.0);
+    std::vector<Point> src(count), exact(count), noisy(count), spoiled(count);
+    std::vector<double> weights(count);
+    for (int i = 0; i < count; i++)
+    {
+        src[i] = Point(width * position(rng), height * position(rng));
+        exact[i] = Map(trueH, src[i]);
+        noisy[i] = Point(exact[i].x + noise(rng), exact[i].y + noise(rng));
+        const bool outlier = i < outlierCount;
+        spoiled[i] = outlier ? Point(noisy[i].x + gross(rng), noisy[i].y + gross(rng)) : noisy[i];
+        weights[i] = outlier ? 0.0 : 1.0 + position(rng);
+    }
+
+    const DltMethod methods[] = { DltMethod::SVD, DltMethod::NormalEquations };
+    const char* methodNames[] = { "SVD", "normal equations" };
+    for (int m = 0; m < 2; m++)
+    {
+        const std::string method = std::string(" (") + methodNames[m] + ")";
+        Matrix3D M;
+        const bool exactOk = SolveHomographyDLT(src.data(), exact.data(), count, nullptr, M, methods[m]);
+        Check(exactOk && GridError(M, trueH, width, height) < 0.01, "SolveHomographyDLT recovers the matrix from exact pairs" + method);
+
+        // Averaged over 200 pairs, the noise moves the fit less than it moves any one
+        // pair, even out at the corners of the area where the fit is least certain.
+        const bool noisyOk = SolveHomographyDLT(src.data(), noisy.data(), count, nullptr, M, methods[m]);
+        const double noisyError = noisyOk ? GridError(M, trueH, width, height) : INFINITY;
+        Check(noisyError < 0.5, "SolveHomographyDLT fits pairs with 0.5 px of noise to within 0.5 px" + method);
+
+        // The outliers have weight 0, so they must make no difference at all.
+        Matrix3D inliersOnly, weighted;
+        const bool inliersOk = SolveHomographyDLT(src.data() + outlierCount, noisy.data() + outlierCount,
+            count - outlierCount, weights.data() + outlierCount, inliersOnly, methods[m]);
+        const bool weightedOk = SolveHomographyDLT(src.data(), spoiled.data(), count, weights.data(), weighted, methods[m]);
+        Check(inliersOk && weightedOk && GridError(weighted, trueH, width, height) < 0.5,
+            "SolveHomographyDLT weights out gross outliers" + method);
+        Check(weightedOk && inliersOk && (weighted.array() == inliersOnly.array()).all(),
+            "SolveHomographyDLT ignores pairs with weight 0" + method);
+
+        std::cout << "DLT" << method << ": noisy pairs " << noisyError << " px from the true matrix" << std::endl;
+    }
+
+    // Too few weighted pairs, or all of them on a line, pin down nothing.
+    Matrix3D untouched = Matrix3D::Constant(42.0f);
+    std::vector<Point> line(count);
+    for (int i = 0; i < count; i++)
+        line[i] = Point(src[i].x, 2.0 * src[i].x + 5.0);
+    std::vector<double> three(count, 0.0);
+    three[0] = three[1] = three[2] = 1.0;
+    Check(!SolveHomographyDLT(line.data(), exact.data(), count, nullptr, untouched), "SolveHomographyDLT fails for collinear points");
+    Check(!SolveHomographyDLT(src.data(), exact.data(), count, three.data(), untouched), "SolveHomographyDLT fails with 3 weighted pairs");
+    Check((untouched.array() == 42.0f).all(), "failed DLT solves leave M untouched");
+}
+
+/*
+ *  EstimateHomographyRansac on a synthetic split of inliers (a known matrix plus
+ *  a little noise) and outliers (random points): it has to find the split and
+ *  the matrix, give the same answer on 1 thread as on several, and every inlier
+ *  counter has to agree with the scalar one.
+ */
+static void TestRansac()
+{
+    const double trueH[9] = { 1.05, -0.1, 30.0, 0.07, 0.95, -12.0, 0.0001, 0.00015, 1.0 };
+    const double width = 1200.0, height = 900.0;
+    const int count = 600;
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> position(0.0, 1.0);
+    std::normal_distribution<double> noise(0.0, 0.3);
+    std::vector<Point> src(count), dst(count);
+    std::vector<unsigned char> isInlier(count);
+    for (int i = 0; i < count; i++)
+    {
+        src[i] = Point(width * position(rng), height * position(rng));
+        isInlier[i] = (i % 5) < 3;
+        if (isInlier[i])
+        {
+            const Point p = Map(trueH, src[i]);
+            dst[i] = Point(p.x + noise(rng), p.y + noise(rng));
+        }
+        else
+            dst[i] = Point(width * position(rng), height * position(rng));
+    }
+
+    // Random outliers can land within the threshold by chance, but only a few.
+    RansacOptions options;
+    options.seed = 7;
+    RansacResult one, many;
+    const int threads = WorkerPool::Get().GetThreadCount();
+    WorkerPool::Get().SetThreadCount(1);
+    const bool oneOk = EstimateHomographyRansac(src.data(), dst.data(), count, options, one);
+    WorkerPool::Get().SetThreadCount(4);
+    const bool manyOk = EstimateHomographyRansac(src.data(), dst.data(), count, options, many);
+    WorkerPool::Get().SetThreadCount(threads);
+
+    Check(oneOk && manyOk, "EstimateHomographyRansac succeeds with 40% outliers");
+    if (!oneOk || !manyOk)
+        return;
+    int missed = 0, accepted = 0;
+    for (int i = 0; i < count; i++)
+    {
+        missed += isInlier[i] && !one.inliers[i];
+        accepted += !isInlier[i] && one.inliers[i];
+    }
+    const double error = GridError(one.matrix, trueH, width, height);
+    std::cout << "RANSAC: " << one.iterations << " hypotheses, " << missed << " inliers missed, " << accepted
+        << " outliers accepted, " << error << " px from the true matrix" << std::endl;
+    Check(missed == 0, "EstimateHomographyRansac finds every inlier");
+    Check(accepted <= 3, "EstimateHomographyRansac accepts at most a few outliers");
+    Check(one.inlierCount == count * 3 / 5 - missed + accepted, "EstimateHomographyRansac's inlier count matches its inlier flags");
+    Check(error < 0.5, "EstimateHomographyRansac recovers the matrix to within 0.5 px");
+
+    Check((one.matrix.array() == many.matrix.array()).all() && one.inliers == many.inliers &&
+        one.inlierCount == many.inlierCount && one.iterations == many.iterations,
+        "EstimateHomographyRansac gives the same result on 1 and 4 threads");
+
+    // Every counter against the scalar one, for the true matrix and some near and
+    // far misses, over ranges that leave partial vectors at both ends.
+    std::vector<float> pointData(4 * (size_t)count);
+    for (int i = 0; i < count; i++)
+    {
+        pointData[i] = (float)src[i].x;
+        pointData[count + i] = (float)src[i].y;
+        pointData[2 * count + i] = (float)dst[i].x;
+        pointData[3 * count + i] = (float)dst[i].y;
+    }
+    const RansacPoints points = { &pointData[0], &pointData[count], &pointData[2 * count], &pointData[3 * count] };
+    const float thresholdSquared = (float)(options.threshold * options.threshold);
+
+    struct Counter
+    {
+        SimdLevel level;
+        CountInliersFunc func;
+    };
+    std::vector<Counter> counters;
+    counters.push_back({ SimdLevel::Scalar, GetCountInliersFuncScalar() });
+    if (DetectSimdLevel() >= SimdLevel::AVX2)
+        counters.push_back({ SimdLevel::AVX2, GetCountInliersFuncAVX2() });
+    if (DetectSimdLevel() >= SimdLevel::AVX512)
+        counters.push_back({ SimdLevel::AVX512, GetCountInliersFuncAVX512() });
+
+    std::uniform_real_distribution<double> jitter(-1.0, 1.0);
+    for (int h = 0; h < 20; h++)
+    {
+        // Jitter grows with h, up to a matrix that maps most points behind the horizon.
+        float H[9];
+        for (int k = 0; k < 9; k++)
+            H[k] = (float)(trueH[k] * (1.0 + 0.002 * h * h * jitter(rng)));
+        const int begin = h % 7, end = count - h % 11;
+
+        std::vector<unsigned char> reference(count, 2);
+        const int expected = counters[0].func(H, points, thresholdSquared, begin, end, reference.data());
+        for (size_t c = 1; c < counters.size(); c++)
+        {
+            std::vector<unsigned char> flags(count, 2);
+            const int counted = counters[c].func(H, points, thresholdSquared, begin, end, flags.data());
+            Check(counted == expected && flags == reference, std::string(SimdLevelName(counters[c].level)) +
+                " inlier counter agrees with Scalar for hypothesis " + std::to_string(h));
+            Check(counters[c].func(H, points, thresholdSquared, begin, end, nullptr) == expected,
+                std::string(SimdLevelName(counters[c].level)) + " inlier counter counts the same without flags");
+        }
+    }
+}
+
+int main()
+{
+    TestRandomQuads();
+    TestNearDegenerateFallback();
+    TestRectToQuad();
+    TestCollinear();
+    TestBatchInstructionSets();
+    TestBatchFlags();
+    TestDLT();
+    TestRansac();
+
+    if (failures)
+    {
+        std::cout << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All homography checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "Image.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// Images get allocated and freed from worker threads too, so the counters are atomic.
+static std::atomic<unsigned long long> allocationCount{ 0 };
+static std::atomic<unsigned long long> freeCount{ 0 };
+static std::atomic<size_t> bytesInUse{ 0 };
+static std::atomic<size_t> peakBytesInUse{ 0 };
+
+ImageMemoryStats GetImageMemoryStats()
+{
+    ImageMemoryStats stats;
+    stats.allocations = allocationCount;
+    stats.frees = freeCount;
+    stats.bytesInUse = bytesInUse;
+    stats.peakBytesInUse = peakBytesInUse;
+    return stats;
+}
+
+void* AllocateImageMemory(size_t bytes)
+{
+#ifdef _MSC_VER
+    void* memory = _aligned_malloc(bytes, IMAGE_ALIGNMENT);
+#else
+    void* memory = nullptr;
+    if (posix_memalign(&memory, IMAGE_ALIGNMENT, bytes) != 0) memory = nullptr;
+#endif
+    if (!memory) throw std::bad_alloc();
+
+    allocationCount++;
+    size_t inUse = (bytesInUse += bytes);
+    size_t peak = peakBytesInUse;
+    while (inUse > peak && !peakBytesInUse.compare_exchange_weak(peak, inUse)) {}
+    return memory;
+}
+
+void FreeImageMemory(void* memory, size_t bytes)
+{
+    if (!memory) return;
+
+#ifdef _MSC_VER
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+    freeCount++;
+    bytesInUse -= bytes;
+}
@@ -0,0 +1,121 @@
+#include "ImageIO.h"
+
+#include <OpenImageIO/imageio.h>
+
+#include <memory>
+#include <vector>
+
+OIIO_NAMESPACE_USING
+
+// Scanlines decoded at a time when an image needs converting to RGBA8.
+static const int LOAD_BAND_ROWS = 64;
+
+bool ReadImageRGBA(const std::string& path, Image<PixelRGBA>& image, std::string& error)
+{
+    // Create the oiio file handler for the image
+    std::unique_ptr<ImageInput> openFile = ImageInput::open(path);
+    if (!openFile)
+    {
+        error = geterror();
+        image.Reset();
+        return false;
+    }
+
+    // Anything deeper than 8 bits (16-bit, half, float) is read as 16-bit and rounded down here.
+    const ImageSpec& spec = openFile->spec();
+    const int channels = (spec.nchannels < 4) ? spec.nchannels : 4;
+    const bool sixteenBit = spec.format.size() > 1;
+    const TypeDesc readFormat = sixteenBit ? TypeDesc::UINT16 : TypeDesc::UINT8;
+    image.Resize(spec.width, spec.height);
+
+    bool readOk = !image.Empty() && channels > 0;
+    if (readOk && channels == 4 && !sixteenBit)
+    {
+        // Already RGBA8, so decode straight into the image, scanlines bottom-up
+        // (negative y stride) since OpenGL starts from the bottom row.
+        const stride_t rowBytes = (stride_t)image.Stride() * sizeof(PixelRGBA);
+        readOk = openFile->read_image(0, 0, 0, channels, readFormat, image[spec.height - 1], AutoStride, -rowBytes);
+    }
+    else if (readOk)
+    {
+        // Everything else is read a band of scanlines at a time and expanded to
+        // RGBA (and flipped) from there, so the only full size buffer is the image.
+        const size_t scanlineBytes = (size_t)spec.width * channels * readFormat.size();
+        std::vector<unsigned char> scanlines(scanlineBytes * LOAD_BAND_ROWS);
+        for (int y = 0; readOk && y < spec.height; y += LOAD_BAND_ROWS)
+        {
+            int yEnd = (y + LOAD_BAND_ROWS < spec.height) ? (y + LOAD_BAND_ROWS) : spec.height;
+            readOk = openFile->read_scanlines(0, 0, spec.y + y, spec.y + yEnd, 0, 0, channels, readFormat, scanlines.data());
+            if (readOk)
+                PixelRGBA::ScanlinesToImage(image.View(), scanlines.data(), y, yEnd - y, channels, sixteenBit);
+        }
+    }
+
+    if (!readOk)
+    {
+        error = openFile->geterror();
+        image.Reset();
+        return false;
+    }
+
+    // Close file. Don't need to manually destroy it due to nature of unique_ptrs.
+    openFile->close();
+    return true;
+}
+
+bool ReadImageSize(const std::string& path, int& width, int& height, std::string& error)
+{
+    std::unique_ptr<ImageInput> openFile = ImageInput::open(path);
+    if (!openFile)
+    {
+        error = geterror();
+        width = height = 0;
+        return false;
+    }
+
+    width = openFile->spec().width;
+    height = openFile->spec().height;
+    openFile->close();
+    return true;
+}
+
+bool WriteImageRGBA(const std::string& path, const ImageView<const PixelRGBA>& image, std::string& error)
+{
+    // create the oiio file handler for the image
+    std::unique_ptr<ImageOutput> outFile = ImageOutput::create(path);
+    if (!outFile)
+    {
+        error = geterror();
+        return false;
+    }
+
+    // Try RGBA first, then fall back to RGB for formats without alpha.
+    ImageSpec spec(image.width, image.height, 4, TypeDesc::UINT8);
+    if (!outFile->open(path, spec))
+    {
+        spec.nchannels = 3;
+        if (!outFile->open(path, spec))
+        {
+            error = outFile->geterror();
+            return false;
+        }
+    }
+
+    // Pixels stay 4 bytes apart even when only RGB is written, and rows go
+    // out top first, so start from the last row with a negative stride.
+    const stride_t rowBytes = (stride_t)image.stride * sizeof(PixelRGBA);
+    if (!outFile->write_image(TypeDesc::UINT8, image[image.height - 1], sizeof(PixelRGBA), -rowBytes))
+    {
+        error = outFile->geterror();
+        outFile->close();
+        return false;
+    }
+
+    // close the image file after the image is written
+    if (!outFile->close())
+    {
+        error = outFile->geterror();
+        return false;
+    }
+    return true;
+}
@@ -1,19 +1,206 @@
 #include "Layer.h"
+#include "Homography.h"
+#include "ImageIO.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Number of output rows handed to a thread at a time while warping.
+static const int WARP_BAND_ROWS = 16;
+
+// Source pixels trimmed off each edge of a resampled warp's interior (see
+// WarpPlan::interior). The kernels decide what's inside from their own float
+// (or, with warpTolerance, approximated) source positions, which can be a
+// little off the exact mapping; copies and the identity need no margin.
+static const double WARP_INTERIOR_INSET = 1.0;
+
+// Source rows an output row has to cross per source column before a Nearest
+// warp reads the tiled copy (with Layer::tiledSource). Flatter rows read the
+// source nearly in order, which the plain layout does best. Rotating a 4096 x
+// 4096 source, the tiled copy took 1.1-1.2x as long at 0 degrees, 0.5-0.7x at
+// 5-20, 0.8-1.0x at 30-60 and 0.6-0.9x at 90.
+static const double TILED_MIN_ROW_SLOPE = 1.0 / 64.0;
+
+/*
+ *  Whether the rows of the output cut across the source's rows more steeply
+ *  than TILED_MIN_ROW_SLOPE, going by their direction where they cross the
+ *  source's center.
+ */
+static bool RowsCrossSourceRows(const Matrix3D& invM, int width, int height)
+{
+    // d(u, v)/dx at (u, v) = (width / 2, height / 2), up to the scale 1 / w,
+    // which doesn't change the slope.
+    const double du = invM(0, 0) - width / 2.0 * invM(2, 0);
+    const double dv = invM(1, 0) - height / 2.0 * invM(2, 0);
+    return fabs(dv) > fabs(du) * TILED_MIN_ROW_SLOPE;
+}
 
 Layer::Layer()
 {
-    rawImageData = warpedImageData = nullptr;
     imageWidth = 0;
     imageHeight = 0;
+    outputWidth = 0;
+    outputHeight = 0;
     rasterPosX = 0;
     rasterPosY = 0;
     warpMatrix = Matrix3D::Identity();
+    filter = WarpFilter::Nearest;
+    warpTolerance = WARP_DEFAULT_TOLERANCE;
+    tiledSource = false;
+    warpBlockWidth = 0;
+    warpDeferred = false;
+    sourceOpaque = false;
+}
+
+ImageView<const PixelRGBA> Layer::WarpedView() const
+{
+    // A deferred warp has nothing to show, but rawImage would be the wrong pixels.
+    if (warpDeferred && plan.kind != WarpKind::Identity)
+        return warpedImage.View();
+    return warpedImage.Empty() ? rawImage.View() : warpedImage.View();
 }
 
-Layer::~Layer()
+/*
+ *  Pixels [xStart, xEnd) of row y of "invM", stepped to from pixel rowStart
+ *  the way the kernels re-anchor (see WarpRows), so a piece of a row starting
+ *  on one of its anchors comes out the same as the whole row would.
+ */
+static WarpSpan AnchoredSpan(const Matrix3D& invM, int y, int rowStart, int xStart, int xEnd)
 {
-    if (rawImageData) PixelRGBA::DeletePixmap(rawImageData);
-    if (warpedImageData) PixelRGBA::DeletePixmap(warpedImageData);
+    WarpSpan span;
+    span.stepU = invM(0, 0);
+    span.stepV = invM(1, 0);
+    span.stepW = invM(2, 0);
+    span.downU = invM(0, 1);
+    span.downV = invM(1, 1);
+    span.downW = invM(2, 1);
+    span.u = (double)invM(0, 0) * rowStart + (double)invM(0, 1) * y + invM(0, 2);
+    span.v = (double)invM(1, 0) * rowStart + (double)invM(1, 1) * y + invM(1, 2);
+    span.w = (double)invM(2, 0) * rowStart + (double)invM(2, 1) * y + invM(2, 2);
+    const int offset = xStart - rowStart;
+    span.u = span.u + span.stepU * offset;
+    span.v = span.v + span.stepV * offset;
+    span.w = span.w + span.stepW * offset;
+    span.count = xEnd - xStart;
+    return span;
+}
+
+const PixelRGBA* Layer::OutputRow(int y, int xBegin, int xEnd, PixelRGBA* scratch) const
+{
+    if (!warpDeferred || plan.kind == WarpKind::Identity)
+        return WarpedView()[y] + xBegin;
+
+    // Output pixel x goes to row[x - xBegin]; the margin before it takes the
+    // part of the first anchor's span left of xBegin.
+    PixelRGBA* row = scratch + WARP_ANCHOR_SPAN;
+    const int count = xEnd - xBegin;
+
+    // The columns of this row that land inside the source.
+    int start, end;
+    if (plan.kind == WarpKind::Translation)
+    {
+        const int srcY = y - plan.offsetY;
+        start = (xBegin > plan.offsetX) ? xBegin : plan.offsetX;
+        end = (xEnd < imageWidth + plan.offsetX) ? xEnd : (imageWidth + plan.offsetX);
+        if (srcY < 0 || srcY >= imageHeight || start >= end)
+        {
+            memset(row, 0, sizeof(PixelRGBA) * count);
+            return row;
+        }
+        memcpy(row + (start - xBegin), rawImage[srcY] + (start - plan.offsetX), sizeof(PixelRGBA) * (end - start));
+    }
+    else
+    {
+        int rowStart, rowEnd;
+        if (!plan.clip.RowSpan(y, outputWidth, rowStart, rowEnd))
+            rowStart = rowEnd = 0;
+        start = (xBegin > rowStart) ? xBegin : rowStart;
+        end = (xEnd < rowEnd) ? xEnd : rowEnd;
+        if (start >= end)
+        {
+            memset(row, 0, sizeof(PixelRGBA) * count);
+            return row;
+        }
+
+        // Sample from the row's anchors on either side, as WarpRows would.
+        const int anchorStart = rowStart + (start - rowStart) / WARP_ANCHOR_SPAN * WARP_ANCHOR_SPAN;
+        int anchorEnd = rowStart + (end - rowStart + WARP_ANCHOR_SPAN - 1) / WARP_ANCHOR_SPAN * WARP_ANCHOR_SPAN;
+        anchorEnd = (anchorEnd < rowEnd) ? anchorEnd : rowEnd;
+        const WarpSpan span = AnchoredSpan(plan.inverse, y, rowStart, anchorStart, anchorEnd);
+        PixelRGBA* out = row + (anchorStart - xBegin);
+        if (filter == WarpFilter::Trilinear)
+            WarpSpanTrilinear(mips, span, out);
+        else
+        {
+            const bool tiled = plan.tiled;
+            GetWarpKernels().Get(filter, tiled)(tiled ? tiles.view : rawImage.View(), span, out);
+        }
+    }
+    memset(row, 0, sizeof(PixelRGBA) * (start - xBegin));
+    memset(row + (end - xBegin), 0, sizeof(PixelRGBA) * (xEnd - end));
+    return row;
+}
+
+bool Layer::OpaqueOver(int xBegin, int yBegin, int xEnd, int yEnd) const
+{
+    // Output pixels sample at their integer coordinates, so those are what has
+    // to be inside. The interior can reach past the output box, which isn't drawn.
+    return sourceOpaque && xBegin < xEnd && yBegin < yEnd && xBegin >= 0 && yBegin >= 0 &&
+        xEnd <= outputWidth && yEnd <= outputHeight &&
+        plan.interior.ContainsBox(xBegin, yBegin, xEnd - 1, yEnd - 1);
+}
+
+bool Layer::OpaqueSpan(int y, int& xStart, int& xEnd) const
+{
+    if (!sourceOpaque || y < 0 || y >= outputHeight || !plan.interior.InnerSpan(y, xStart, xEnd))
+        return false;
+    xStart = (xStart > 0) ? xStart : 0;
+    xEnd = (xEnd < outputWidth) ? xEnd : outputWidth;
+    return xStart < xEnd;
+}
+
+void Layer::DeferWarp()
+{
+    warpDeferred = true;
+    warpedImage.Reset();
+}
+
+void Layer::MaterializeWarp()
+{
+    if (!warpDeferred)
+        return;
+    warpDeferred = false;
+    WarpOutput();
+}
+
+bool Layer::ReadImageFile(const std::string& path, std::string& error)
+{
+    mips.Clear();
+    tiles.Clear();
+    warpedImage.Reset();
+    plan = WarpPlan();
+    bool readOk = ReadImageRGBA(path, rawImage, error);
+
+    // Unwarped, so the layer displays rawImage until it's warped.
+    warpMatrix = Matrix3D::Identity();
+    rasterPosX = 0;
+    rasterPosY = 0;
+    imageWidth = outputWidth = rawImage.Width();
+    imageHeight = outputHeight = rawImage.Height();
+    plan.interior.Build(warpMatrix, imageWidth, imageHeight);
+
+    sourceOpaque = !rawImage.Empty();
+    for (int y = 0; y < rawImage.Height() && sourceOpaque; y++)
+    {
+        const PixelRGBA* row = rawImage[y];
+        unsigned char alpha = 255;
+        for (int x = 0; x < rawImage.Width(); x++)
+            alpha &= row[x].a;
+        sourceOpaque = (alpha == 255);
+    }
+    return readOk;
 }
 
 void Layer::MoveImage(int offsetX, int offsetY)
@@ -24,6 +211,26 @@ void Layer::MoveImage(int offsetX, int offsetY)
 
 void Layer::InvWarpLayer(const Matrix3D& M)
 {
+    // Work out the cheapest way to produce this warp (see ClassifyWarp); from here
+    // on the pixels come from "snapped", which matches M to well under a pixel.
+    Matrix3D snapped;
+    const WarpKind kind = ClassifyWarp(M, imageWidth, imageHeight, snapped);
+    WarpClipQuad interior;
+    const bool copied = (kind == WarpKind::Identity || kind == WarpKind::Translation);
+    interior.Build(snapped, imageWidth, imageHeight, copied ? 0.0 : WARP_INTERIOR_INSET + warpTolerance);
+
+    // The identity warp is just the source, which WarpedView() shows directly.
+    if (kind == WarpKind::Identity)
+    {
+        plan = WarpPlan();
+        plan.interior = interior;
+        warpedImage.Reset();
+        outputWidth = imageWidth;
+        outputHeight = imageHeight;
+        warpMatrix = M;
+        return;
+    }
+
     // First compute bounding box required for output pixmap, using the difference
     // between the forward-mapped min and max values to find the width and height.
     Vector3D forwardMappedCorners[4];
@@ -33,10 +240,10 @@ void Layer::InvWarpLayer(const Matrix3D& M)
     srcPoints[2] << (float)imageWidth, (float)imageHeight, 1.0f;
     srcPoints[3] << 0.0f, (float)imageHeight, 1.0f;
 
-    forwardMappedCorners[0] = M * srcPoints[0];         // Lower left
-    forwardMappedCorners[1] = M * srcPoints[1];         // Lower right
-    forwardMappedCorners[2] = M * srcPoints[2];         // Upper right
-    forwardMappedCorners[3] = M * srcPoints[3];         // Upper left
+    forwardMappedCorners[0] = snapped * srcPoints[0];         // Lower left
+    forwardMappedCorners[1] = snapped * srcPoints[1];         // Lower right
+    forwardMappedCorners[2] = snapped * srcPoints[2];         // Upper right
+    forwardMappedCorners[3] = snapped * srcPoints[3];         // Upper left
 
     // Also normalize these values!
     for (int i = 0; i < 4; i++)
@@ -62,41 +269,300 @@ void Layer::InvWarpLayer(const Matrix3D& M)
     
     // Get inverse matrix; also shift raster position based on minimum x/y values
     // so the transformed image stays within the bounds of the allocated pixmap
-    Matrix3D invM = M.inverse();
+    Matrix3D invM = snapped.inverse();
+    if (kind != WarpKind::Projective)
+    {
+        // Exactly (0, 0, 1), so every span is affine and the kernels skip the divide.
+        invM(2, 0) = invM(2, 1) = 0.0f;
+        invM(2, 2) = 1.0f;
+    }
     rasterPosX += (int)(minX + rasterPosX) - rasterPosX;
     rasterPosY += (int)(minY + rasterPosY) - rasterPosY;
 
-    // Allocate output pixmap and begin computing each necessary pixel via inverse mapping.
-    if (warpedImageData[0] != nullptr) PixelRGBA::DeletePixmap(warpedImageData);
-    warpedImageData = PixelRGBA::CreatePixmap(outHeight, outWidth, false);
-
     outputWidth = outWidth;
     outputHeight = outHeight;
 
-    // Inverse map for each output pixel
-    for (int y = 0; y < outHeight; y++)
-        for (int x = 0; x < outWidth; x++)
+    // Outline of the warped image, so each row only inverse maps what it can hit.
+    plan.kind = kind;
+    plan.inverse = invM;
+    plan.clip.Build(snapped, imageWidth, imageHeight);
+    plan.interior = interior;
+
+    // Whole pixel offsets sample every source pixel exactly at its center, which
+    // every filter (and mip level 0) reproduces as is, so those rows are copies.
+    plan.offsetX = (int)snapped(0, 2);
+    plan.offsetY = (int)snapped(1, 2);
+    if (filter == WarpFilter::Trilinear && kind != WarpKind::Translation && !mips.IsBuilt())
+        mips.Build(rawImage.View());
+    // Only Nearest reads the tiled copy: the filtered kernels' row pair loads
+    // straddle tiles, and measured slower from it at every angle but a few degrees.
+    plan.tiled = tiledSource && filter == WarpFilter::Nearest && kind != WarpKind::Translation &&
+        RowsCrossSourceRows(invM, imageWidth, imageHeight);
+    if (plan.tiled && !tiles.IsBuilt())
+        tiles.Build(rawImage.View());
+
+    // A deferred warp is sampled when it's composited instead (see OutputRow).
+    if (!warpDeferred)
+        WarpOutput();
+
+    warpMatrix = M;
+}
+
+void Layer::WarpOutput()
+{
+    if (plan.kind == WarpKind::Identity)
+    {
+        warpedImage.Reset();
+        return;
+    }
+
+    // Size the output image and begin computing each necessary pixel via inverse mapping.
+    // Resize reuses the old buffer whenever it fits, so dragging a corner around doesn't
+    // allocate (and page fault in) a fresh multi-megabyte image on every mouse event.
+    warpedImage.Resize(outputWidth, outputHeight);
+
+    // Split the output into bands of rows and inverse map them on every core.
+    // Each pixel only depends on its own coordinates, so the result is identical
+    // no matter how many threads end up running the bands.
+    const int bandCount = (outputHeight + WARP_BAND_ROWS - 1) / WARP_BAND_ROWS;
+    WorkerPool::Get().ParallelFor(bandCount, [&](int band)
+    {
+        int yBegin = band * WARP_BAND_ROWS;
+        int yEnd = (yBegin + WARP_BAND_ROWS < outputHeight) ? (yBegin + WARP_BAND_ROWS) : outputHeight;
+        if (plan.kind == WarpKind::Translation)
+            TranslateRows(plan.offsetX, plan.offsetY, yBegin, yEnd);
+        else
+            WarpRows(plan.inverse, plan.clip, yBegin, yEnd);
+    });
+}
+
+bool Layer::WarpToCorners(const Point corners[4])
+{
+    // The matrix maps into output space, which starts at the raster position.
+    Point destPoints[4];
+    for (int i = 0; i < 4; i++)
+        destPoints[i] = Point(corners[i].x - rasterPosX, corners[i].y - rasterPosY);
+
+    // Collinear, repeated or NaN corners leave no invertible matrix, which
+    // InvWarpLayer would turn into nonsense output sizes; check that first.
+    Matrix3D M = SolveRectToQuad(imageWidth, imageHeight, destPoints);
+    if (!M.allFinite() || !M.inverse().allFinite())
+        return false;
+
+    // Same bounding box InvWarpLayer sizes the output with.
+    double minX = destPoints[0].x, maxX = destPoints[0].x;
+    double minY = destPoints[0].y, maxY = destPoints[0].y;
+    for (int i = 1; i < 4; i++)
+    {
+        minX = std::min(minX, destPoints[i].x);
+        maxX = std::max(maxX, destPoints[i].x);
+        minY = std::min(minY, destPoints[i].y);
+        maxY = std::max(maxY, destPoints[i].y);
+    }
+    if ((int)(maxX - minX) <= 0 || (int)(maxY - minY) <= 0)
+        return false;
+
+    InvWarpLayer(M);
+    return true;
+}
+
+void Layer::MapCorners(Point points[5]) const
+{
+    const double srcX[5] = { 0.0, (double)imageWidth, (double)imageWidth, 0.0, imageWidth / 2.0 };
+    const double srcY[5] = { 0.0, 0.0, (double)imageHeight, (double)imageHeight, imageHeight / 2.0 };
+
+    // Forward map and normalize each point.
+    for (int i = 0; i < 5; i++)
+    {
+        Vector3D srcPoint, imgPoint;
+        srcPoint << (float)srcX[i], (float)srcY[i], 1.0f;
+        imgPoint = warpMatrix * srcPoint;
+        points[i].x = imgPoint(0, 0) / imgPoint(2, 0) + rasterPosX;
+        points[i].y = imgPoint(1, 0) / imgPoint(2, 0) + rasterPosY;
+    }
+}
+
+void Layer::TranslateRows(int offsetX, int offsetY, int yBegin, int yEnd)
+{
+    // Columns of the output row that land inside the source; the same for every row.
+    int xStart = (offsetX > 0) ? offsetX : 0;
+    int xEnd = (imageWidth + offsetX < outputWidth) ? (imageWidth + offsetX) : outputWidth;
+    if (xEnd < xStart)
+        xEnd = xStart = 0;
+
+    for (int y = yBegin; y < yEnd; y++)
+    {
+        PixelRGBA* outRow = warpedImage[y];
+        const int srcY = y - offsetY;
+        if (srcY < 0 || srcY >= imageHeight || xStart == xEnd)
         {
-            // Mapped pixel coordinates
-            Vector3D pixel_out;
-            pixel_out << (float)x, (float)y, 1.0f;
+            memset(outRow, 0, sizeof(PixelRGBA) * outputWidth);
+            continue;
+        }
+        memset(outRow, 0, sizeof(PixelRGBA) * xStart);
+        memcpy(outRow + xStart, rawImage[srcY] + (xStart - offsetX), sizeof(PixelRGBA) * (xEnd - xStart));
+        memset(outRow + xEnd, 0, sizeof(PixelRGBA) * (outputWidth - xEnd));
+    }
+}
 
-            Vector3D pixel_in = invM * pixel_out;
+void Layer::WarpRows(const Matrix3D& invM, const WarpClipQuad& clip, int yBegin, int yEnd)
+{
+    // The per row arrays below hold one band; longer ranges go a band at a time.
+    if (yEnd - yBegin > WARP_BAND_ROWS)
+    {
+        for (int y = yBegin; y < yEnd; y += WARP_BAND_ROWS)
+            WarpRows(invM, clip, y, (y + WARP_BAND_ROWS < yEnd) ? (y + WARP_BAND_ROWS) : yEnd);
+        return;
+    }
 
-            // Normalize pixmap; dividing u' and v' by the w' component
-            double u = pixel_in(0, 0) / pixel_in(2, 0);
-            double v = pixel_in(1, 0) / pixel_in(2, 0);
+    // InvWarpLayer decided whether to use (and built) the tiled copy.
+    const bool tiled = plan.tiled && filter != WarpFilter::Trilinear;
+    const WarpSource src = tiled ? tiles.view : rawImage.View();
+    const WarpSpanFunc kernel = GetWarpKernels().Get(filter, tiled);
+    auto warpSpan = [&](const WarpSpan& span, PixelRGBA* out)
+    {
+        if (filter == WarpFilter::Trilinear)
+            WarpSpanTrilinear(mips, span, out);
+        else
+            kernel(src, span, out);
+    };
 
-            // Get proper inversely mapped pixel from input map. If not in bounds,
-            // set it to a clear pixel.
-            PixelRGBA inPixel;
-            if (std::lround(u) < 0 || std::lround(v) < 0 || std::lround(u) >= imageWidth || std::lround(v) >= imageHeight)
-                inPixel.r = inPixel.g = inPixel.b = inPixel.a = 0;
-            else
-                inPixel = rawImageData[std::lround(v)][std::lround(u)];
+    // The homogeneous source coordinates (u*w, v*w, w) are affine in x, so each
+    // row only needs its starting point; the kernel steps along it with invM's first column.
+    WarpSpan span;
+    span.stepU = invM(0, 0);
+    span.stepV = invM(1, 0);
+    span.stepW = invM(2, 0);
+    span.downU = invM(0, 1);
+    span.downV = invM(1, 1);
+    span.downW = invM(2, 1);
+    auto rowSpan = [&](int y, int xStart, int xEnd)
+    {
+        span.u = (double)invM(0, 0) * xStart + (double)invM(0, 1) * y + invM(0, 2);
+        span.v = (double)invM(1, 0) * xStart + (double)invM(1, 1) * y + invM(1, 2);
+        span.w = (double)invM(2, 0) * xStart + (double)invM(2, 1) * y + invM(2, 2);
+        span.count = xEnd - xStart;
+        return span;
+    };
+    auto projectiveSpan = [&](int y, int xStart, int xEnd)
+    {
+        warpSpan(rowSpan(y, xStart, xEnd), warpedImage[y] + xStart);
+    };
 
-            warpedImageData[y][x] = inPixel;
+    // Rows outside the warped quad (or the triangles beside it) are just cleared.
+    int rowStart[WARP_BAND_ROWS], rowEnd[WARP_BAND_ROWS];
+    int minStart = outputWidth, maxEnd = 0;
+    for (int y = yBegin; y < yEnd; y++)
+    {
+        PixelRGBA* outRow = warpedImage[y];
+        int& xStart = rowStart[y - yBegin];
+        int& xEnd = rowEnd[y - yBegin];
+        if (!clip.RowSpan(y, outputWidth, xStart, xEnd))
+        {
+            memset(outRow, 0, sizeof(PixelRGBA) * outputWidth);
+            xStart = xEnd = 0;
+            continue;
         }
+        memset(outRow, 0, sizeof(PixelRGBA) * xStart);
+        memset(outRow + xEnd, 0, sizeof(PixelRGBA) * (outputWidth - xEnd));
+        minStart = (xStart < minStart) ? xStart : minStart;
+        maxEnd = (xEnd > maxEnd) ? xEnd : maxEnd;
+    }
 
-    warpMatrix = M;
-}
\ No newline at end of file
+    // Pixels [xStart, xEnd) of row y stepped to from the row's first pixel, with
+    // the same arithmetic the kernels re-anchor with, so a row warped in pieces
+    // starting on anchors gives the same pixels as the row in one piece.
+    auto blockSpan = [&](int y, int xStart, int xEnd)
+    {
+        return AnchoredSpan(invM, y, rowStart[y - yBegin], xStart, xEnd);
+    };
+
+    // An invalid clip quad means part of the source maps behind the viewer, where
+    // nothing is close to affine; warp those rows exactly. Otherwise only tile
+    // corners get the exact mapping, and each tile's share of a row is an affine span.
+    const bool approximate = (warpTolerance > 0.0) && clip.valid;
+    // Kept per thread (cleared, not freed), so warping every band doesn't allocate.
+    thread_local std::vector<WarpTile> warpTiles;
+    warpTiles.clear();
+    if (approximate && minStart < maxEnd)
+    {
+        BuildWarpTiles(invM, minStart, yBegin, maxEnd, yEnd, warpTolerance, warpTiles);
+        std::sort(warpTiles.begin(), warpTiles.end(), [](const WarpTile& a, const WarpTile& b) { return a.x0 < b.x0; });
+    }
+
+    // Pixels [xStart, xEnd) of row y. Tiles are walked left to right, so runs of
+    // exact tiles merge back into one projective span, up to the next line of the
+    // tile grid; blocks are cut on those lines too, so neither where a run starts
+    // nor where its anchors fall depends on the block width.
+    auto warpRow = [&](int y, int xStart, int xEnd)
+    {
+        if (!approximate)
+        {
+            warpSpan(blockSpan(y, xStart, xEnd), warpedImage[y] + xStart);
+            return;
+        }
+
+        int exactStart = xStart, exactEnd = xStart;
+        for (const WarpTile& tile : warpTiles)
+        {
+            if (y < tile.y0 || y >= tile.y1)
+                continue;
+            int start = (xStart > tile.x0) ? xStart : tile.x0;
+            int end = (xEnd < tile.x1) ? xEnd : tile.x1;
+            if (start >= end)
+                continue;
+
+            if (exactStart < exactEnd && (start - minStart) % WARP_TILE_SIZE == 0)
+            {
+                projectiveSpan(y, exactStart, exactEnd);
+                exactStart = exactEnd = start;
+            }
+            if (tile.exact)
+            {
+                if (exactStart == exactEnd)
+                    exactStart = start;
+                exactEnd = end;
+                continue;
+            }
+            if (exactStart < exactEnd)
+                projectiveSpan(y, exactStart, exactEnd);
+            exactStart = exactEnd = end;
+
+            WarpSpan affine;
+            tile.RowSpan(y, start, end, affine);
+            warpSpan(affine, warpedImage[y] + start);
+        }
+        if (exactStart < exactEnd)
+            projectiveSpan(y, exactStart, exactEnd);
+    };
+
+    // Walk the band a block of columns at a time (see ChooseWarpBlockWidth), with
+    // the width picked from the Jacobian at the band's center unless it's set.
+    // Exact blocks are counted from each row's own start, so every piece of a row
+    // begins on one of its anchors (widths are multiples of WARP_ANCHOR_SPAN).
+    // Approximated ones are counted from the tile grid's origin in multiples of
+    // WARP_TILE_SIZE, so they never cut a tile's span.
+    const int blockAlign = approximate ? WARP_TILE_SIZE : WARP_ANCHOR_SPAN;
+    int blockWidth = (warpBlockWidth > 0) ? warpBlockWidth :
+        ChooseWarpBlockWidth(invM, (minStart + maxEnd) / 2, (yBegin + yEnd) / 2, yEnd - yBegin, tiled);
+    blockWidth = (blockWidth + blockAlign - 1) / blockAlign * blockAlign;
+    int maxLength = approximate ? maxEnd - minStart : 0;
+    for (int y = yBegin; y < yEnd && !approximate; y++)
+    {
+        int length = rowEnd[y - yBegin] - rowStart[y - yBegin];
+        maxLength = (length > maxLength) ? length : maxLength;
+    }
+
+    for (int blockOffset = 0; blockOffset < maxLength; blockOffset += blockWidth)
+    {
+        for (int y = yBegin; y < yEnd; y++)
+        {
+            const int xStart = rowStart[y - yBegin], xEnd = rowEnd[y - yBegin];
+            const int blockStart = (approximate ? minStart : xStart) + blockOffset;
+            const int start = (xStart > blockStart) ? xStart : blockStart;
+            const int end = (xEnd - blockStart > blockWidth) ? (blockStart + blockWidth) : xEnd;
+            if (start < end)
+                warpRow(y, start, end);
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#include "MipPyramid.h"
+#include "WorkerPool.h"
+
+#include <cmath>
+
+// Output rows of a mip level handed to a thread at a time while building.
+static const int MIP_BAND_ROWS = 32;
+
+// Pixels of a span that share one level of detail in WarpSpanTrilinear.
+static const int MIP_TILE_SIZE = 16;
+
+void MipPyramid::Build(const WarpSource& image)
+{
+    Clear();
+    if (image.Empty()) return;
+    levels.push_back(image);
+
+    // Every level is allocated up front so "levels" can point into "levelImages".
+    int levelWidth = image.width, levelHeight = image.height;
+    while (levelWidth > 1 || levelHeight > 1)
+    {
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+        levelImages.emplace_back(levelWidth, levelHeight);
+    }
+
+    const MipDownsampleFunc downsample = GetWarpKernels().downsample;
+    for (Image<PixelRGBA>& levelImage : levelImages)
+    {
+        const WarpSource parent = levels.back();
+        const WarpSource level = levelImage.View();
+
+        const int bandCount = (level.height + MIP_BAND_ROWS - 1) / MIP_BAND_ROWS;
+        WorkerPool::Get().ParallelFor(bandCount, [&](int band)
+        {
+            int yBegin = band * MIP_BAND_ROWS;
+            int yEnd = (yBegin + MIP_BAND_ROWS < level.height) ? (yBegin + MIP_BAND_ROWS) : level.height;
+            for (int y = yBegin; y < yEnd; y++)
+            {
+                // An odd last row is averaged with itself, same as an odd last column.
+                int top = 2 * y;
+                int bottom = (top + 1 < parent.height) ? (top + 1) : top;
+                downsample(parent[top], parent[bottom], parent.width, levelImage[y]);
+            }
+        });
+        levels.push_back(level);
+    }
+}
+
+void MipPyramid::Clear()
+{
+    levels.clear();
+    levelImages.clear();
+}
+
+bool MipPyramid::IsBuilt() const
+{
+    return !levels.empty();
+}
+
+/*
+ *  Level of detail at homogeneous source position (uw, vw, w): log2 of the longer
+ *  side of the output pixel's footprint in the source, from the derivatives of
+ *  u = uw / w and v = vw / w along x (step*) and y (down*).
+ */
+static double LevelOfDetail(const WarpSpan& span, double uw, double vw, double w)
+{
+    double invW = 1.0 / w;
+    double u = uw * invW, v = vw * invW;
+    double dudx = (span.stepU - u * span.stepW) * invW;
+    double dvdx = (span.stepV - v * span.stepW) * invW;
+    double dudy = (span.downU - u * span.downW) * invW;
+    double dvdy = (span.downV - v * span.downW) * invW;
+
+    double lengthX = dudx * dudx + dvdx * dvdx;
+    double lengthY = dudy * dudy + dvdy * dvdy;
+    double longest = (lengthX > lengthY) ? lengthX : lengthY;
+    return 0.5 * std::log2(longest);
+}
+
+/*
+ *  The part of "span" starting at pixel "first", expressed in the coordinates of
+ *  mip level "level". Level pixel centers sit at (u + 0.5) / 2^level - 0.5, which
+ *  is still linear in the homogeneous coordinates, so the kernel can step it as usual.
+ */
+static WarpSpan LevelSpan(const WarpSpan& span, int first, int count, int level)
+{
+    const double scale = 1.0 / (double)(1 << level);
+    double uw = span.u + span.stepU * first;
+    double vw = span.v + span.stepV * first;
+    double w = span.w + span.stepW * first;
+
+    WarpSpan levelSpan = span;
+    levelSpan.u = (uw + 0.5 * w) * scale - 0.5 * w;
+    levelSpan.v = (vw + 0.5 * w) * scale - 0.5 * w;
+    levelSpan.w = w;
+    levelSpan.stepU = (span.stepU + 0.5 * span.stepW) * scale - 0.5 * span.stepW;
+    levelSpan.stepV = (span.stepV + 0.5 * span.stepW) * scale - 0.5 * span.stepW;
+    levelSpan.count = count;
+    return levelSpan;
+}
+
+void WarpSpanTrilinear(const MipPyramid& mips, const WarpSpan& span, PixelRGBA* out)
+{
+    const WarpSpanFunc bilinear = GetWarpKernels().bilinear;
+    const int lastLevel = (int)mips.levels.size() - 1;
+    if (lastLevel <= 0)
+    {
+        if (lastLevel == 0) bilinear(mips.levels[0], span, out);
+        return;
+    }
+
+    PixelRGBA coarser[MIP_TILE_SIZE];
+    for (int first = 0; first < span.count; first += MIP_TILE_SIZE)
+    {
+        int count = (first + MIP_TILE_SIZE < span.count) ? MIP_TILE_SIZE : (span.count - first);
+        double center = first + 0.5 * (count - 1);
+        double w = span.w + span.stepW * center;
+
+        // Magnified (or behind the viewer, where the kernel clears everything): full resolution.
+        double lod = (w > 0.0) ? LevelOfDetail(span, span.u + span.stepU * center, span.v + span.stepV * center, w) : 0.0;
+        if (!(lod > 0.0))
+        {
+            bilinear(mips.levels[0], LevelSpan(span, first, count, 0), out + first);
+            continue;
+        }
+
+        int level = (lod < lastLevel) ? (int)lod : lastLevel;
+        int weight = (level < lastLevel) ? (int)std::lround((lod - level) * 256.0) : 0;
+        if (weight >= 256)
+        {
+            level++;
+            weight = 0;
+        }
+
+        bilinear(mips.levels[level], LevelSpan(span, first, count, level), out + first);
+        if (weight == 0) continue;
+
+        // Blend toward the next level in the same 8-bit fixed point the bilinear kernels use.
+        bilinear(mips.levels[level + 1], LevelSpan(span, first, count, level + 1), coarser);
+        unsigned char* fine = &out[first].r;
+        const unsigned char* coarse = &coarser[0].r;
+        for (int c = 0; c < 4 * count; c++)
+            fine[c] = (unsigned char)((fine[c] * (256 - weight) + coarse[c] * weight + 128) >> 8);
+    }
+}
@@ -0,0 +1,52 @@
+#include "PixelConvert.h"
+
+#include <cstring>
+
+static inline unsigned char ToByte(unsigned char sample)
+{
+    return sample;
+}
+
+// Exactly round(sample / 257) for every 16-bit value.
+static inline unsigned char ToByte(unsigned short sample)
+{
+    return (unsigned char)(((unsigned)sample * 255 + 32895) >> 16);
+}
+
+template <typename Sample, int Channels>
+static void ConvertRowScalar(const void* source, int width, PixelRGBA* out)
+{
+    const Sample* samples = (const Sample*)source;
+    for (int x = 0; x < width; x++, samples += Channels)
+    {
+        PixelRGBA& pixel = out[x];
+        pixel.r = ToByte(samples[0]);
+        pixel.g = (Channels >= 3) ? ToByte(samples[1]) : pixel.r;
+        pixel.b = (Channels >= 3) ? ToByte(samples[2]) : pixel.r;
+        pixel.a = (Channels == 4) ? ToByte(samples[3]) : (Channels == 2) ? ToByte(samples[1]) : 255;
+    }
+}
+
+static void ConvertRowRGBA8(const void* source, int width, PixelRGBA* out)
+{
+    memcpy(out, source, sizeof(PixelRGBA) * width);
+}
+
+ConvertRowFunc GetConvertRowFuncScalar(int channels, bool sixteenBit)
+{
+    switch (channels)
+    {
+        case 1:     return sixteenBit ? ConvertRowScalar<unsigned short, 1> : ConvertRowScalar<unsigned char, 1>;
+        case 2:     return sixteenBit ? ConvertRowScalar<unsigned short, 2> : ConvertRowScalar<unsigned char, 2>;
+        case 3:     return sixteenBit ? ConvertRowScalar<unsigned short, 3> : ConvertRowScalar<unsigned char, 3>;
+        default:    return sixteenBit ? ConvertRowScalar<unsigned short, 4> : ConvertRowRGBA8;
+    }
+}
+
+ConvertRowFunc GetConvertRowFunc(int channels, bool sixteenBit)
+{
+    // Every converter is a byte shuffle; 128-bit pshufb already keeps up with memory.
+    if (DetectSimdLevel() >= SimdLevel::SSE41)
+        return GetConvertRowFuncSSE41(channels, sixteenBit);
+    return GetConvertRowFuncScalar(channels, sixteenBit);
+}
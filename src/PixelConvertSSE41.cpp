@@ -0,0 +1,122 @@
+#include "PixelConvert.h"
+
+#include <immintrin.h>
+
+// Source pixels narrowed at a time by the 16-bit converters.
+static const int NARROW_CHUNK_PIXELS = 128;
+
+/*
+ *  Shuffles 16 gray bytes out to 16 opaque pixels.
+ */
+TARGET_SSE41 static void ConvertRowGray8(const void* source, int width, PixelRGBA* out)
+{
+    const unsigned char* samples = (const unsigned char*)source;
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    const __m128i spread[4] = {
+        _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+        _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+        _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+        _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1)
+    };
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i gray = _mm_loadu_si128((const __m128i*)(samples + x));
+        for (int i = 0; i < 4; i++)
+            _mm_storeu_si128((__m128i*)(out + x + 4 * i), _mm_or_si128(_mm_shuffle_epi8(gray, spread[i]), alpha));
+    }
+    if (x < width)
+        GetConvertRowFuncScalar(1, false)(samples + x, width - x, out + x);
+}
+
+/*
+ *  8 (gray, alpha) pairs per load, each spread out to (gray, gray, gray, alpha).
+ */
+TARGET_SSE41 static void ConvertRowGrayAlpha8(const void* source, int width, PixelRGBA* out)
+{
+    const unsigned char* samples = (const unsigned char*)source;
+    const __m128i low = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+    const __m128i high = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i pairs = _mm_loadu_si128((const __m128i*)(samples + 2 * x));
+        _mm_storeu_si128((__m128i*)(out + x), _mm_shuffle_epi8(pairs, low));
+        _mm_storeu_si128((__m128i*)(out + x + 4), _mm_shuffle_epi8(pairs, high));
+    }
+    if (x < width)
+        GetConvertRowFuncScalar(2, false)(samples + 2 * x, width - x, out + x);
+}
+
+/*
+ *  4 RGB pixels (12 of the 16 bytes loaded) per iteration. The load reads 4 bytes
+ *  past the pixels it uses, so the loop stops while that's still inside the row.
+ */
+TARGET_SSE41 static void ConvertRowRGB8(const void* source, int width, PixelRGBA* out)
+{
+    const unsigned char* samples = (const unsigned char*)source;
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+    int x = 0;
+    for (; x + 6 <= width; x += 4)
+    {
+        __m128i rgb = _mm_loadu_si128((const __m128i*)(samples + 3 * x));
+        _mm_storeu_si128((__m128i*)(out + x), _mm_or_si128(_mm_shuffle_epi8(rgb, spread), alpha));
+    }
+    if (x < width)
+        GetConvertRowFuncScalar(3, false)(samples + 3 * x, width - x, out + x);
+}
+
+/*
+ *  Rounds "count" 16-bit samples to 8 bits. With t = min(v + 128, 65535),
+ *  (t - (t >> 8)) >> 8 equals round(v / 257) for every v, all in 16-bit lanes.
+ */
+TARGET_SSE41 static void NarrowSamples(const unsigned short* samples, int count, unsigned char* out)
+{
+    const __m128i round = _mm_set1_epi16(128);
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i low = _mm_adds_epu16(_mm_loadu_si128((const __m128i*)(samples + i)), round);
+        __m128i high = _mm_adds_epu16(_mm_loadu_si128((const __m128i*)(samples + i + 8)), round);
+        low = _mm_srli_epi16(_mm_sub_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_sub_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(low, high));
+    }
+    for (; i < count; i++)
+        out[i] = (unsigned char)(((unsigned)samples[i] * 255 + 32895) >> 16);
+}
+
+/*
+ *  16-bit sources are narrowed a chunk at a time into a small buffer that stays
+ *  in L1, then run through the matching 8-bit converter.
+ */
+template <int Channels>
+TARGET_SSE41 static void ConvertRow16(const void* source, int width, PixelRGBA* out)
+{
+    const unsigned short* samples = (const unsigned short*)source;
+    const ConvertRowFunc convert8 = GetConvertRowFuncSSE41(Channels, false);
+    alignas(16) unsigned char narrowed[NARROW_CHUNK_PIXELS * Channels];
+
+    for (int x = 0; x < width; x += NARROW_CHUNK_PIXELS)
+    {
+        int count = (x + NARROW_CHUNK_PIXELS < width) ? NARROW_CHUNK_PIXELS : (width - x);
+        NarrowSamples(samples + (ptrdiff_t)x * Channels, count * Channels, narrowed);
+        convert8(narrowed, count, out + x);
+    }
+}
+
+ConvertRowFunc GetConvertRowFuncSSE41(int channels, bool sixteenBit)
+{
+    switch (channels)
+    {
+        case 1:     return sixteenBit ? ConvertRow16<1> : ConvertRowGray8;
+        case 2:     return sixteenBit ? ConvertRow16<2> : ConvertRowGrayAlpha8;
+        case 3:     return sixteenBit ? ConvertRow16<3> : ConvertRowRGB8;
+        default:    return sixteenBit ? ConvertRow16<4> : GetConvertRowFuncScalar(4, false);
+    }
+}
@@ -1,7 +1,12 @@
 #include "ProjectiveWarper.h"
 
+#include <cstring>
+
 const int ProjectiveWarper::MAX_LAYERS = 10;
 
+// What the window shows where there are no layers; glClearColor(0.05, 0.05, 0.05, 1) as bytes.
+static const PixelRGBA WINDOW_BACKGROUND = { 13, 13, 13, 255 };
+
 ProjectiveWarper::ProjectiveWarper()
 {
     windowHeight = 500;
@@ -37,7 +42,7 @@ ProjectiveWarper::~ProjectiveWarper()
 
 /*
  *	Prompts the user for an image file name. If image found, place image
- *	data into given layer using OIIO helper functions.
+ *	data into given layer using OIIO helper functions (see Layer::ReadImageFile).
  *  This will overwrite any data stored in the layer. Only use when making new one.
  */
 bool ProjectiveWarper::ReadImageFile(Layer* writeToLayer, std::string openFileName)
@@ -48,39 +53,12 @@ bool ProjectiveWarper::ReadImageFile(Layer* writeToLayer, std::string openFileNa
         std::cin >> openFileName;
     }
 
-    // Create the oiio file handler for the image
-    std::unique_ptr<ImageInput> openFile = ImageInput::open(openFileName);
-    if (!openFile) {
-        std::cerr << "Could not open image for " << openFileName << ", error = " << geterror() << std::endl;
-        openFileName = "";  // Don't need file name anymore, reset now in case of error
-        return false;
-    }
-
-    // Get image spec data from opened image file and use spec 
-    // to allocate correct space for reading the pixel data.
-    const ImageSpec& spec = openFile->spec();
-    unsigned char* readPixmap = new unsigned char[spec.width * spec.height * spec.nchannels];
-
-    // Override currentImgData with new data from read_image.
-    if (!openFile->read_image(TypeDesc::UINT8, readPixmap))
+    std::string error;
+    if (!writeToLayer->ReadImageFile(openFileName, error))
     {
-        std::cerr << "Could not read data from " << openFileName << ", error = " << geterror() << std::endl;
-        openFileName = "";
+        std::cerr << "Could not read image " << openFileName << ", error = " << error << std::endl;
         return false;
     }
-
-    // Read successful, copy into layer.
-    if (writeToLayer->rawImageData) PixelRGBA::DeletePixmap(writeToLayer->rawImageData);
-    PixelRGBA::ContiguousDataToPixmap(writeToLayer->rawImageData, readPixmap, spec.width, spec.height, spec.nchannels);
-    writeToLayer->warpedImageData = PixelRGBA::CopyPixmap(writeToLayer->rawImageData, spec.height, spec.width);
-    writeToLayer->rasterPosX = 0;
-    writeToLayer->rasterPosY = 0;
-    writeToLayer->imageWidth = spec.width;
-    writeToLayer->imageHeight = spec.height;
-
-    // Close file. Don't need to manually destroy it due to nature of unique_ptrs.
-    openFile->close();
-    delete[] readPixmap;
     return true;
 }
 
@@ -96,60 +74,15 @@ void ProjectiveWarper::WriteImage()
 
     std::cin >> outFileName;
 
-    // Pixmap vars and window width/height.
-    int w = glutGet(GLUT_WINDOW_WIDTH);
-    int h = glutGet(GLUT_WINDOW_HEIGHT);
-    unsigned char* pixmap = new unsigned char[4 * windowWidth * windowHeight];
-
-    // create the oiio file handler for the image
-    std::unique_ptr<ImageOutput> outfile = ImageOutput::create(outFileName);
-    if (!outfile) {
-        std::cerr << "Could not create output image for " << outFileName << ", error = " << geterror() << std::endl;
-        return;
-    }
-
-    // Open a file for writing the image. The file header will indicate an image of
-    // width w, height h, and 4 channels per pixel (RGBA). All channels will be of
-    // type unsigned char
-    ImageSpec spec(windowWidth, windowHeight, 4, TypeDesc::UINT8);
-    if (!outfile->open(outFileName, spec)) {
-        while (spec.nchannels > 0)
-        {
-            spec.nchannels--;
-            if (!outfile->open(outFileName, spec))
-            {
-                std::cerr << "Could not open " << outFileName << ", error = " << geterror() << std::endl;
-                return;
-            }
-            else
-                break;
-        }
-    }
+    // The frame is what the window shows, already on the CPU. Both OpenGL and
+    // Image keep the bottom row first, so WriteImageRGBA does the flip.
+    if (frame.Empty()) return;
 
-    // Get the current pixels from the OpenGL framebuffer and store in pixmap
-    // Also determine proper format for glReadPixels to use based on number of channels!
-    auto format = (spec.nchannels >= 4) ? GL_RGBA : (spec.nchannels == 3) ? GL_RGB : (spec.nchannels == 2) ? GL_LUMINANCE_ALPHA : GL_LUMINANCE;
-    glReadPixels(0, 0, w, h, format, GL_UNSIGNED_BYTE, pixmap);
-
-    // Write the image to the file. All channel values in the pixmap are taken to be
-    // unsigned chars. Flip image as well due to OpenGL storing pixmaps differently.
-    int sclineLength = windowWidth * spec.nchannels * sizeof(unsigned char);
-    if (!outfile->write_image(TypeDesc::UINT8, pixmap + (windowHeight - 1) * sclineLength, AutoStride, -sclineLength))
-    {
-        std::cerr << "Could not write image to " << outFileName << ", error = " << geterror() << std::endl;
-        return;
-    }
+    std::string error;
+    if (!WriteImageRGBA(outFileName, frame.View(), error))
+        std::cerr << "Could not write image to " << outFileName << ", error = " << error << std::endl;
     else
         std::cout << "Image is stored" << std::endl;
-
-    // close the image file after the image is written
-    if (!outfile->close())
-    {
-        std::cerr << "Could not close " << outFileName << ", error = " << geterror() << std::endl;
-        return;
-    }
-
-    delete[] pixmap;
 }
 
 /*
@@ -202,7 +135,7 @@ bool ProjectiveWarper::DeleteLayer(const int& layer)
     if (activeLayer >= 0)
         std::cout << "\nLayer " << activeLayer << " is now selected!\n";
     layerBoundPointsDirty = true;
-    glutPostRedisplay();
+    RequestRedisplay();
     return true;
 }
 
@@ -223,87 +156,75 @@ bool ProjectiveWarper::ResetLayer(const int& layer)
 }
 
 /*
- *  Renders a given layer (if the index exists) based on it's stored raster position
+ *  Switches a layer to the next resampling filter (nearest -> bilinear -> bicubic -> trilinear)
+ *  and re-warps it in place with its current corners.
+ */
+bool ProjectiveWarper::CycleLayerFilter(const int& layer)
+{
+    if (layer < 0 || layer >= (int)layers.size())
+        return false;
+
+    Layer* filterLayer = layers[layer].get();
+    int nextFilter = ((int)filterLayer->filter + 1) % (int)WarpFilter::Count;
+    filterLayer->filter = (WarpFilter)nextFilter;
+    std::cout << "Layer " << layer << " now uses " << WarpFilterName(filterLayer->filter) << " filtering\n";
+
+    if (layerBoundPointsDirty)
+        MapSelectedLayerPoints();
+    ProjectiveWarpLayer(filterLayer);
+    return true;
+}
+
+/*
+ *  Blends a given layer into the frame at it's stored raster position, only
+ *  inside "region".
  */
-void ProjectiveWarper::RenderLayer(const Layer* rendLayer)
+void ProjectiveWarper::RenderLayer(const Layer* rendLayer, const DamageRect& region)
 {
-    // To anyone online who sees this who might care, yes, I know glDrawPixels is deprecated
-    // and slow. I do not care in this case. OpenGL was not the focus the project; this was made
-    // for the purpose of improving my ability to architecture larger programs well and learn
-    // how projective warping works on a conceptual level (matrices and all)
-    glRasterPos2d(0, 0);
-    glBitmap(0, 0, 0, 0, (float)rendLayer->rasterPosX, (float)rendLayer->rasterPosY, NULL);
-    glDrawPixels(rendLayer->outputWidth, rendLayer->outputHeight, GL_RGBA, GL_UNSIGNED_BYTE, rendLayer->warpedImageData[0]);
+    CompositeLayer(frame.View(), *rendLayer, region);
+}
+
+/*
+ *  Use instead of glutPostRedisplay, so DisplayLayers knows the window's
+ *  contents are still there and only the damaged part needs uploading.
+ */
+void ProjectiveWarper::RequestRedisplay()
+{
+    redisplayRequested = true;
+    glutPostRedisplay();
+}
+
+/*
+ *  Draws the part of the frame inside "rect" over the same part of the window.
+ *  The frame is already blended (and its alpha isn't coverage any more), so it
+ *  replaces the framebuffer as is.
+ */
+void ProjectiveWarper::UploadFrame(const DamageRect& rect)
+{
+    glRasterPos2i(rect.x0, rect.y0);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, frame.Stride());
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.x0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.y0);
+    glDrawPixels(rect.x1 - rect.x0, rect.y1 - rect.y0, GL_RGBA, GL_UNSIGNED_BYTE, frame.Data());
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 }
 
 /*
  *  Using the currently set positions of the active layer's forward mapped points
  *  (either from directly forward mapping or recently moving one with the mouse),
- *  create a warp matrix based on the known uv-coordinates and xy-coordinates.
- *  
- *  Formula I used to simplify these calculations for each individual matrix coefficient
- *  can be found here: http://graphics.cs.cmu.edu/courses/15-463/2008_fall/Papers/proj.pdf
- *  
- *  I tried using the fast method on page 4, but it wasn't working for some reason no matter
- *  how hard I tried. Therefore I do the traditional 8x8 system with gaussian elimination on pg. 3
+ *  create a warp matrix based on the known uv-coordinates and xy-coordinates
+ *  (see SolveHomography) and warp the layer with it.
  */
 void ProjectiveWarper::ProjectiveWarpLayer(Layer* warpLayer)
 {
-    Matrix3D newM = Matrix3D::Identity();
-    Matrix8D projectiveSystem = Matrix8D::Zero();
-    Vector8D destPoints;
-    Vector8D solution;
-    Vector8D srcPoints;
-    srcPoints << 0, warpLayer->imageWidth, warpLayer->imageWidth, 0, 0, 0, warpLayer->imageHeight, warpLayer->imageHeight;
-    
-    // Caching these since they're called in below loop, should be slightly faster.
-    const int& imgRasterPosX = warpLayer->rasterPosX;
-    const int& imgRasterPosY = warpLayer->rasterPosY;
-
-    // Populate 8x8 matrix for system to solve. Also populate a vector
-    // with destination points (where they were moved to by the mouse) by removing
-    // the raster position.
-    for (int i = 0; i < 4; i++)
-    {
-        // Desintation points, first 4 elements are x-positions, last 4 are y-positions.
-        destPoints(i, 0) = activeLayerBoundPoints[i].x - imgRasterPosX;
-        destPoints(i + 4, 0) = activeLayerBoundPoints[i].y - imgRasterPosY;
-    
-        // 8x8 matrix to solve. Any points not set here are implicitly zero.
-        projectiveSystem(i, 0) = projectiveSystem(i + 4, 3) = srcPoints(i, 0);
-        projectiveSystem(i, 1) = projectiveSystem(i + 4, 4) = srcPoints(i + 4, 0);
-        projectiveSystem(i, 2) = projectiveSystem(i + 4, 5) = 1;
-        
-        projectiveSystem(i, 6)      = -srcPoints(i, 0) * destPoints(i, 0);
-        projectiveSystem(i, 7)      = -srcPoints(i + 4, 0) * destPoints(i, 0);
-        projectiveSystem(i + 4, 6)  = -srcPoints(i, 0) * destPoints(i + 4, 0);
-        projectiveSystem(i + 4, 7)  = -srcPoints(i + 4, 0) * destPoints(i + 4, 0);
-    }
-
-    // Solve and explicity set 3D matrix version of solution; do so for
-    // efficiency by avoiding for loops.
-    solution = projectiveSystem.partialPivLu().solve(destPoints);
-    newM(0, 0) = solution(0, 0);
-    newM(0, 1) = solution(1, 0);
-    newM(0, 2) = solution(2, 0);
-    newM(1, 0) = solution(3, 0);
-    newM(1, 1) = solution(4, 0);
-    newM(1, 2) = solution(5, 0);
-    newM(2, 0) = solution(6, 0);
-    newM(2, 1) = solution(7, 0);
-    newM(2, 2) = 1.0;
-
-    warpLayer->InvWarpLayer(newM);
+    warpLayer->WarpToCorners(activeLayerBoundPoints);
 
     // Move center icon to proper position after warping.
-    Vector3D srcCenter, imgPoint;
-    srcCenter << warpLayer->imageWidth / 2, warpLayer->imageHeight / 2, 1.0;
-
-    imgPoint = newM * srcCenter;
-    imgPoint(0, 0) = imgPoint(0, 0) / imgPoint(2, 0);
-    imgPoint(1, 0) = imgPoint(1, 0) / imgPoint(2, 0);
-    activeLayerBoundPoints[4].x = imgPoint(0, 0) + warpLayer->rasterPosX;
-    activeLayerBoundPoints[4].y = imgPoint(1, 0) + warpLayer->rasterPosY;
+    Point mappedPoints[5];
+    warpLayer->MapCorners(mappedPoints);
+    activeLayerBoundPoints[4] = mappedPoints[4];
 }
 
 /*
@@ -312,35 +233,7 @@ void ProjectiveWarper::ProjectiveWarpLayer(Layer* warpLayer)
  */
 void ProjectiveWarper::MapSelectedLayerPoints()
 {
-    Layer* selectedLayer = layers[activeLayer].get();
-    const float& inWidth = (float)selectedLayer->imageWidth;
-    const float& inHeight = (float)selectedLayer->imageHeight;
-
-    // Get forward mapped points of corners and image center
-    Vector3D imgPoints[5];
-    Vector3D srcPoints[5];
-    srcPoints[0] << 0.0, 0.0, 1.0;
-    srcPoints[1] << inWidth, 0.0, 1.0;
-    srcPoints[2] << inWidth, inHeight, 1.0;
-    srcPoints[3] << 0.0, inHeight, 1.0;
-    srcPoints[4] << inWidth / 2, inHeight / 2, 1.0;
-
-    const Matrix3D& mTemp = selectedLayer->warpMatrix;
-    imgPoints[0] = mTemp * srcPoints[0]; // Lower left
-    imgPoints[1] = mTemp * srcPoints[1]; // Lower right
-    imgPoints[2] = mTemp * srcPoints[2]; // Upper right
-    imgPoints[3] = mTemp * srcPoints[3]; // Upper left
-    imgPoints[4] = mTemp * srcPoints[4]; // Middle
-
-    // Normalize and set calculated values to proper points.
-    for (int i = 0; i < 5; i++)
-    {
-        imgPoints[i](0, 0) = imgPoints[i](0, 0) / imgPoints[i](2, 0);
-        imgPoints[i](1, 0) = imgPoints[i](1, 0) / imgPoints[i](2, 0);
-        activeLayerBoundPoints[i].x = imgPoints[i](0, 0) + selectedLayer->rasterPosX;
-        activeLayerBoundPoints[i].y = imgPoints[i](1, 0) + selectedLayer->rasterPosY;
-    }
-
+    layers[activeLayer]->MapCorners(activeLayerBoundPoints);
     layerBoundPointsDirty = false;
 }
 
@@ -360,42 +253,97 @@ void ProjectiveWarper::ResetMouseStates()
  */
 void ProjectiveWarper::DisplayLayers()
 {
-    glClearColor(0.05, 0.05, 0.05, 1);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    // Render layers first.
+    // Layers are composited on the CPU a tile at a time (see TileCompositor),
+    // then the changed parts of the frame go to OpenGL. Only the active
+    // layer gets dragged and warped, so everything under and over it is kept
+    // composited; the compositor notices when a swap or a new selection changes that.
+    // The other layers don't keep warped copies at all: they're sampled from
+    // their sources whenever those caches are rebuilt (see Layer::DeferWarp).
+    frame.Resize(windowWidth, windowHeight);
+    std::vector<const Layer*> stack(layers.size());
     for (int i = 0; i < (int)layers.size(); i++)
-        RenderLayer(layers[i].get());    
-
-    if (saveWindowThisFrame)
     {
-        WriteImage();
-        saveWindowThisFrame = false;
+        if (i == activeLayer)
+            layers[i]->MaterializeWarp();
+        else
+            layers[i]->DeferWarp();
+        stack[i] = layers[i].get();
     }
 
-    // Render icon points to proper forward mapped location on the screen.
-    else if (!layers.empty())
+    // Icons go on the active layer's corners and center, except on a frame
+    // that's being saved. They're drawn over the layers rather than kept in the
+    // stack, so the damage they do is worked out here.
+    Layer* icons[5] = { cornerIcon.get(), cornerIcon.get(), cornerIcon.get(), cornerIcon.get(), centerIcon.get() };
+    DamageRect iconRects[5];
+    int iconCount = 0;
+    if (!saveWindowThisFrame && !layers.empty())
     {
         if (layerBoundPointsDirty)
             MapSelectedLayerPoints();
 
-        // Render corners
-        for (int i = 0; i < 4; i++)
+        for (; iconCount < 5; iconCount++)
         {
-            cornerIcon->rasterPosX = (int)activeLayerBoundPoints[i].x - (cornerIcon->outputWidth / 2);
-            cornerIcon->rasterPosY = (int)activeLayerBoundPoints[i].y - (cornerIcon->outputHeight / 2);
-            RenderLayer(cornerIcon.get());
+            const Layer* icon = icons[iconCount];
+            const int x = (int)activeLayerBoundPoints[iconCount].x - (icon->outputWidth / 2);
+            const int y = (int)activeLayerBoundPoints[iconCount].y - (icon->outputHeight / 2);
+            iconRects[iconCount] = { x, y, x + icon->outputWidth, y + icon->outputHeight };
         }
+    }
+    for (int i = 0; i < 5; i++)
+    {
+        const bool wasDrawn = i < drawnIconCount, isDrawn = i < iconCount;
+        if (wasDrawn && isDrawn && memcmp(&drawnIcons[i], &iconRects[i], sizeof(DamageRect)) == 0)
+            continue;
+        if (wasDrawn)
+            damage.Damage(drawnIcons[i]);
+        if (isDrawn)
+            damage.Damage(iconRects[i]);
+        drawnIcons[i] = iconRects[i];
+    }
+    drawnIconCount = iconCount;
 
-        // Render center
-        centerIcon->rasterPosX = (int)activeLayerBoundPoints[4].x - (centerIcon->outputWidth / 2);
-        centerIcon->rasterPosY = (int)activeLayerBoundPoints[4].y - (centerIcon->outputHeight / 2);
-        RenderLayer(centerIcon.get());
+    // Only what changed since the last frame is composited again: the old and
+    // new boxes of every layer or icon that moved, was warped, was deleted or
+    // swapped. The rest of the frame is still right from before.
+    const std::vector<DamageRect>& damaged = damage.Update(stack.data(), (int)stack.size(), frame.Width(), frame.Height());
+    for (const DamageRect& rect : damaged)
+    {
+        compositor.CompositeAround(frame.View(), stack.data(), (int)stack.size(), activeLayer, WINDOW_BACKGROUND, rect);
+        for (int i = 0; i < iconCount; i++)
+        {
+            icons[i]->rasterPosX = iconRects[i].x0;
+            icons[i]->rasterPosY = iconRects[i].y0;
+            RenderLayer(icons[i], rect);
+        }
     }
 
+    // The caches CompositeAround blends from are a few levels off wherever the
+    // layers over the active one are translucent, and which pixels are depends
+    // on the selection; a saved frame is composited exactly, and all of it goes
+    // up so the window matches.
+    if (saveWindowThisFrame)
+    {
+        compositor.Composite(frame.View(), stack.data(), (int)stack.size(), WINDOW_BACKGROUND);
+        WriteImage();
+        saveWindowThisFrame = false;
+        windowContentsLost = true;
+    }
+
+    // A redisplay we asked for finds the window as we left it, so only the
+    // damage goes up. Otherwise the window was uncovered or resized, and
+    // whatever it shows now can't be trusted. GLUT folds an expose into a
+    // pending redisplay, so the reshape and status callbacks flag those too.
+    glDisable(GL_BLEND);
+    if (redisplayRequested && !windowContentsLost)
+    {
+        for (const DamageRect& rect : damaged)
+            UploadFrame(rect);
+    }
+    else if (!frame.Empty())
+        UploadFrame({ 0, 0, frame.Width(), frame.Height() });
+    redisplayRequested = false;
+    windowContentsLost = false;
+
     glFlush();
 }
 
@@ -408,6 +356,7 @@ void ProjectiveWarper::HandleWindowReshape(int newWidth, int newHeight)
     // Now store new window sizes.
     windowWidth = newWidth;
     windowHeight = newHeight;
+    windowContentsLost = true;
 
     // Set the viewport to be the entire window
     glViewport(0, 0, windowWidth, windowHeight);
@@ -418,6 +367,18 @@ void ProjectiveWarper::HandleWindowReshape(int newWidth, int newHeight)
     gluOrtho2D(0, windowWidth, 0, windowHeight);
 }
 
+/*
+ *  Handles the display window being covered, uncovered or hidden, any of
+ *  which can leave parts of it showing something other than the last frame.
+ *	Use this in the glut window status callback!
+ */
+void ProjectiveWarper::HandleWindowStatus(int state)
+{
+    windowContentsLost = true;
+    if (state != GLUT_HIDDEN && state != GLUT_FULLY_COVERED)
+        glutPostRedisplay();
+}
+
 /*
  *  Handle normal key presses and call appropriate functions.
  */
@@ -445,10 +406,15 @@ void ProjectiveWarper::HandleKeyPresses(unsigned char key, int x, int y)
         case 'r':
             ResetLayer(activeLayer);
             break;
+        // Cycle resampling filter of the current layer.
+        case 'F':
+        case 'f':
+            CycleLayerFilter(activeLayer);
+            break;
         default:
             break;
     }
-    glutPostRedisplay();
+    RequestRedisplay();
 }
 
 /*
@@ -485,7 +451,7 @@ void ProjectiveWarper::HandleSpecialKeyPresses(int key, int x, int y)
             activeLayer = newLayer;
             break;
     }
-    glutPostRedisplay();
+    RequestRedisplay();
 }
 
 /*
@@ -561,7 +527,7 @@ void ProjectiveWarper::HandleClickedMouseMotion(int x, int y)
             boundPoint.x += mouseMoveX;
             boundPoint.y += mouseMoveY;
         }
-        glutPostRedisplay();
+        RequestRedisplay();
     }
 
     // A point is being clicked by mouse, move this point and warp the image.
@@ -572,7 +538,7 @@ void ProjectiveWarper::HandleClickedMouseMotion(int x, int y)
 
         ProjectiveWarpLayer(layers[activeLayer].get());
     }
-    glutPostRedisplay();
+    RequestRedisplay();
 }
 
 /*
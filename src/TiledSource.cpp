@@ -0,0 +1,54 @@
+#include "TiledSource.h"
+#include "WorkerPool.h"
+
+#include <cstring>
+
+TiledSource::TiledSource()
+{
+    view = { nullptr, 0, 0, 0 };
+}
+
+void TiledSource::Build(const WarpSource& image)
+{
+    Clear();
+    if (image.Empty()) return;
+
+    const int tilePixels = WARP_SOURCE_TILE * WARP_SOURCE_TILE;
+    const int tilesAcross = (image.width + WARP_SOURCE_TILE - 1) / WARP_SOURCE_TILE;
+    const int tilesDown = (image.height + WARP_SOURCE_TILE - 1) / WARP_SOURCE_TILE;
+
+    // A row of tiles is a multiple of IMAGE_ALIGNMENT bytes, so the stride is exactly that row.
+    storage.Resize(tilesAcross * tilePixels, tilesDown);
+
+    WorkerPool::Get().ParallelFor(tilesDown, [&](int tileRow)
+    {
+        PixelRGBA* tiles = storage[tileRow];
+        for (int row = 0; row < WARP_SOURCE_TILE; row++)
+        {
+            const int y = tileRow * WARP_SOURCE_TILE + row;
+            for (int tile = 0; tile < tilesAcross; tile++)
+            {
+                PixelRGBA* out = tiles + tile * tilePixels + row * WARP_SOURCE_TILE;
+                const int x = tile * WARP_SOURCE_TILE;
+                const int copied = (y < image.height) ?
+                    ((image.width - x < WARP_SOURCE_TILE) ? (image.width - x) : WARP_SOURCE_TILE) : 0;
+                if (copied > 0)
+                    memcpy(out, image[y] + x, sizeof(PixelRGBA) * copied);
+                memset(out + copied, 0, sizeof(PixelRGBA) * (WARP_SOURCE_TILE - copied));
+            }
+        }
+    });
+
+    view = { storage.Data(), image.width, image.height, storage.Stride() };
+}
+
+void TiledSource::Clear()
+{
+    storage.Reset();
+    view = { nullptr, 0, 0, 0 };
+}
+
+bool TiledSource::IsBuilt() const
+{
+    return !storage.Empty();
+}
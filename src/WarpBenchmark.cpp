@@ -0,0 +1,341 @@
+/*
+ *  Warp benchmark: times the warp loop on synthetic layers, on one thread, and
+ *  reports nanoseconds per output pixel. Every case runs "reps" times and the
+ *  fastest run is reported, which is the least disturbed by everything else on
+ *  the machine.
+ *
+ *  Usage: WarpBenchmark [-r reps] [-b width,width,...]
+ *
+ *  -b lists the block widths the cache blocking section sweeps; 0 is the
+ *  width ChooseWarpBlockWidth picks.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "WarpCore.h"
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Size of the source image most cases warp.
+static const int BENCH_SOURCE_WIDTH = 1200;
+static const int BENCH_SOURCE_HEIGHT = 900;
+
+// Size of the (square) source the tiled source cases rotate.
+static const int BENCH_TILED_SOURCE_SIZE = 4096;
+
+/*
+ *  Makes "layer" an unwarped (width x height) image of noise, so neither the
+ *  cache nor the kernels' transparent pixel skipping flatters anything.
+ */
+static void FillLayer(Layer& layer, int width, int height)
+{
+    layer.rawImage.Resize(width, height);
+    unsigned int seed = 1;
+    for (int y = 0; y < height; y++)
+    {
+        PixelRGBA* row = layer.rawImage[y];
+        for (int x = 0; x < width; x++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            memcpy(&row[x], &seed, sizeof(PixelRGBA));
+        }
+    }
+    layer.imageWidth = layer.outputWidth = width;
+    layer.imageHeight = layer.outputHeight = height;
+    layer.rasterPosX = layer.rasterPosY = 0;
+    layer.warpMatrix = Matrix3D::Identity();
+    layer.warpedImage.Reset();
+    layer.mips.Clear();
+    layer.tiles.Clear();
+}
+
+/*
+ *  The warp loop as it was before the kernels: a full 3x3 product and two
+ *  divides per pixel, and std::lround on every coordinate.
+ */
+static void WarpPerPixel(const Layer& layer, const Matrix3D& invM, Image<PixelRGBA>& out)
+{
+    for (int y = 0; y < out.Height(); y++)
+        for (int x = 0; x < out.Width(); x++)
+        {
+            Vector3D pixel_out;
+            pixel_out << (float)x, (float)y, 1.0f;
+
+            Vector3D pixel_in = invM * pixel_out;
+
+            double u = pixel_in(0, 0) / pixel_in(2, 0);
+            double v = pixel_in(1, 0) / pixel_in(2, 0);
+
+            PixelRGBA inPixel;
+            if (std::lround(u) < 0 || std::lround(v) < 0 || std::lround(u) >= layer.imageWidth || std::lround(v) >= layer.imageHeight)
+                inPixel.r = inPixel.g = inPixel.b = inPixel.a = 0;
+            else
+                inPixel = layer.rawImage[std::lround(v)][std::lround(u)];
+
+            out[y][x] = inPixel;
+        }
+}
+
+/*
+ *  Fastest of "reps" runs of "work", in milliseconds.
+ */
+template <typename Work>
+static double BestOf(int reps, Work work)
+{
+    double best = 0.0;
+    for (int i = 0; i < reps; i++)
+    {
+        BenchClock::time_point start = BenchClock::now();
+        work();
+        const double ms = std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+        best = (i == 0 || ms < best) ? ms : best;
+    }
+    return best;
+}
+
+static void WarpFromOrigin(Layer& layer, const Matrix3D& M)
+{
+    layer.rasterPosX = layer.rasterPosY = 0;
+    layer.InvWarpLayer(M);
+}
+
+static void PrintRow(const std::string& name, const std::string& variant, double ms, long long pixels)
+{
+    std::cout << "  " << std::left << std::setw(22) << name << std::setw(16) << variant << std::right
+        << std::fixed << std::setprecision(2) << std::setw(9) << ms << " ms"
+        << std::setw(9) << ms * 1e6 / (double)pixels << " ns/px" << std::endl;
+}
+
+/*
+ *  The old per pixel loop against the incrementally stepped one (nearest
+ *  filter), scalar and with the widest kernels the CPU has.
+ */
+static void BenchSteppedLoop(int reps)
+{
+    struct Case
+    {
+        const char* name;
+        float m[9];
+    };
+    const Case cases[] =
+    {
+        { "mild perspective", { 1.1f, 0.2f, 10.0f, 0.05f, 0.9f, 20.0f, 0.0002f, 0.0001f, 1.0f } },
+        { "45 deg rotation", { 0.7071f, -0.7071f, 700.0f, 0.7071f, 0.7071f, 0.0f, 0.0f, 0.0f, 1.0f } },
+        { "strong perspective", { 0.5f, 0.1f, 3.0f, -0.02f, 0.6f, 5.0f, -0.0003f, 0.0004f, 1.0f } },
+    };
+
+    std::cout << "Per pixel loop vs stepped kernel (nearest, " << BENCH_SOURCE_WIDTH << "x"
+        << BENCH_SOURCE_HEIGHT << " source)" << std::endl;
+    Layer layer;
+    FillLayer(layer, BENCH_SOURCE_WIDTH, BENCH_SOURCE_HEIGHT);
+    layer.filter = WarpFilter::Nearest;
+    for (const Case& c : cases)
+    {
+        Matrix3D M;
+        M << c.m[0], c.m[1], c.m[2], c.m[3], c.m[4], c.m[5], c.m[6], c.m[7], c.m[8];
+
+        SetWarpSimdLevel(SimdLevel::Scalar);
+        const double stepped = BestOf(reps, [&] { WarpFromOrigin(layer, M); });
+        SetWarpSimdLevel(DetectSimdLevel());
+        const double widest = BestOf(reps, [&] { WarpFromOrigin(layer, M); });
+
+        // Same output box the layer was warped into, so the two can be compared.
+        Image<PixelRGBA> reference(layer.outputWidth, layer.outputHeight);
+        const Matrix3D invM = M.inverse();
+        const double perPixel = BestOf(reps, [&] { WarpPerPixel(layer, invM, reference); });
+
+        long long differ = 0;
+        const ImageView<const PixelRGBA> warped = layer.WarpedView();
+        for (int y = 0; y < reference.Height(); y++)
+            for (int x = 0; x < reference.Width(); x++)
+                differ += (memcmp(&warped[y][x], &reference[y][x], sizeof(PixelRGBA)) != 0);
+
+        const long long pixels = (long long)layer.outputWidth * layer.outputHeight;
+        std::cout << " " << c.name << ", " << layer.outputWidth << "x" << layer.outputHeight << " out, "
+            << differ << " px differ" << std::endl;
+        PrintRow("per pixel", "", perPixel, pixels);
+        PrintRow("stepped", SimdLevelName(SimdLevel::Scalar), stepped, pixels);
+        PrintRow("stepped", SimdLevelName(DetectSimdLevel()), widest, pixels);
+    }
+}
+
+/*
+ *  Each filter against nearest, at every instruction set the CPU supports.
+ *  The filtered kernels are meant to stay within 2x of nearest.
+ */
+static void BenchFilters(int reps)
+{
+    struct Case
+    {
+        const char* name;
+        float m[9];
+    };
+    const Case cases[] =
+    {
+        { "mild perspective", { 1.1f, 0.2f, 10.0f, 0.05f, 0.9f, 20.0f, 0.0002f, 0.0001f, 1.0f } },
+        { "45 deg rotation", { 0.7071f, -0.7071f, 700.0f, 0.7071f, 0.7071f, 0.0f, 0.0f, 0.0f, 1.0f } },
+    };
+    const WarpFilter filters[] = { WarpFilter::Nearest, WarpFilter::Bilinear, WarpFilter::Bicubic };
+
+    std::cout << "Filters vs nearest (" << BENCH_SOURCE_WIDTH << "x" << BENCH_SOURCE_HEIGHT << " source)" << std::endl;
+    Layer layer;
+    FillLayer(layer, BENCH_SOURCE_WIDTH, BENCH_SOURCE_HEIGHT);
+    for (const Case& c : cases)
+    {
+        Matrix3D M;
+        M << c.m[0], c.m[1], c.m[2], c.m[3], c.m[4], c.m[5], c.m[6], c.m[7], c.m[8];
+        std::cout << " " << c.name << std::endl;
+        for (int level = (int)SimdLevel::Scalar; level <= (int)DetectSimdLevel(); level++)
+        {
+            SetWarpSimdLevel((SimdLevel)level);
+            double nearest = 0.0;
+            for (WarpFilter filter : filters)
+            {
+                layer.filter = filter;
+                const double ms = BestOf(reps, [&] { WarpFromOrigin(layer, M); });
+                nearest = (filter == WarpFilter::Nearest) ? ms : nearest;
+
+                std::ostringstream variant;
+                variant << SimdLevelName((SimdLevel)level) << ", " << std::fixed << std::setprecision(2) << ms / nearest << "x";
+                PrintRow(WarpFilterName(filter), variant.str(), ms, (long long)layer.outputWidth * layer.outputHeight);
+            }
+        }
+    }
+    SetWarpSimdLevel(DetectSimdLevel());
+}
+
+/*
+ *  Rotation by "degrees" about the center of a (width x height) image, shifted
+ *  half a pixel so 0 degrees isn't a whole pixel translation (which copies rows).
+ */
+static Matrix3D Rotation(double degrees, int width, int height)
+{
+    const double radians = degrees * 3.14159265358979323846 / 180.0;
+    const double c = cos(radians), s = sin(radians);
+    Matrix3D M;
+    M << (float)c, (float)-s, (float)(width / 2.0 - c * width / 2.0 + s * height / 2.0 + 0.5),
+        (float)s, (float)c, (float)(height / 2.0 - s * width / 2.0 - c * height / 2.0),
+        0.0f, 0.0f, 1.0f;
+    return M;
+}
+
+/*
+ *  The tiled source copy against the plain one under rotation (nearest, the
+ *  only filter that reads it). At 0 degrees rows are read in order and the
+ *  layer keeps to the plain copy; at 90 every output row walks down a source
+ *  column, which is what the tiles are for. The source is large enough that a
+ *  column of it doesn't fit in cache.
+ */
+static void BenchTiledSource(int reps)
+{
+    const double angles[] = { 0.0, 10.0, 45.0, 90.0 };
+
+    std::cout << "Tiled vs plain source under rotation (nearest, " << BENCH_TILED_SOURCE_SIZE << "x"
+        << BENCH_TILED_SOURCE_SIZE << " source)" << std::endl;
+    Layer layer;
+    FillLayer(layer, BENCH_TILED_SOURCE_SIZE, BENCH_TILED_SOURCE_SIZE);
+    layer.filter = WarpFilter::Nearest;
+    for (double angle : angles)
+    {
+        const Matrix3D M = Rotation(angle, layer.imageWidth, layer.imageHeight);
+        // One untimed warp each first, so neither pays for sizing the output
+        // image, and the tiled one not for building the tiled copy either.
+        layer.tiledSource = false;
+        WarpFromOrigin(layer, M);
+        const double plain = BestOf(reps, [&] { WarpFromOrigin(layer, M); });
+
+        layer.tiledSource = true;
+        WarpFromOrigin(layer, M);
+        const double tiled = BestOf(reps, [&] { WarpFromOrigin(layer, M); });
+
+        const long long pixels = (long long)layer.outputWidth * layer.outputHeight;
+        std::ostringstream variant;
+        variant << "tiled, " << std::fixed << std::setprecision(2) << tiled / plain << "x";
+        std::ostringstream name;
+        name << (int)angle << " deg";
+        PrintRow(name.str(), "plain", plain, pixels);
+        PrintRow(name.str(), variant.str(), tiled, pixels);
+    }
+}
+
+/*
+ *  Cache blocking: fixed block widths against the one ChooseWarpBlockWidth
+ *  picks (0), on the large source rotated. At 90 degrees each output row walks
+ *  down a source column, so blocks wide enough to outrun the cache show up.
+ */
+static void BenchBlocks(int reps, const std::vector<int>& widths)
+{
+    const double angles[] = { 45.0, 90.0 };
+    const WarpFilter filters[] = { WarpFilter::Nearest, WarpFilter::Bilinear };
+
+    std::cout << "Block widths under rotation (" << BENCH_TILED_SOURCE_SIZE << "x"
+        << BENCH_TILED_SOURCE_SIZE << " source)" << std::endl;
+    Layer layer;
+    FillLayer(layer, BENCH_TILED_SOURCE_SIZE, BENCH_TILED_SOURCE_SIZE);
+    for (double angle : angles)
+    {
+        const Matrix3D M = Rotation(angle, layer.imageWidth, layer.imageHeight);
+        for (WarpFilter filter : filters)
+        {
+            std::cout << " " << (int)angle << " deg, " << WarpFilterName(filter) << std::endl;
+            layer.filter = filter;
+            layer.warpBlockWidth = 0;
+            WarpFromOrigin(layer, M);
+            const double automatic = BestOf(reps, [&] { WarpFromOrigin(layer, M); });
+
+            for (int width : widths)
+            {
+                layer.warpBlockWidth = width;
+                const double ms = (width == 0) ? automatic : BestOf(reps, [&] { WarpFromOrigin(layer, M); });
+
+                std::ostringstream name, variant;
+                name << "width " << (width ? std::to_string(width) : std::string("auto"));
+                variant << std::fixed << std::setprecision(2) << ms / automatic << "x";
+                PrintRow(name.str(), variant.str(), ms, (long long)layer.outputWidth * layer.outputHeight);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int reps = 5;
+    std::vector<int> widths = { 0, 64, 256, 1024, 4096 };
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc)
+            reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+        {
+            widths.clear();
+            std::istringstream list(argv[++i]);
+            std::string width;
+            while (std::getline(list, width, ','))
+                widths.push_back(std::max(0, atoi(width.c_str())));
+        }
+        else
+        {
+            std::cout << "Usage: WarpBenchmark [-r reps] [-b width,width,...]" << std::endl;
+            return 1;
+        }
+    }
+    reps = (reps > 0) ? reps : 1;
+
+    // Per thread cost is what's being compared.
+    WorkerPool::Get().SetThreadCount(1);
+    std::cout << "Kernels: " << SimdLevelName(DetectSimdLevel()) << ", best of " << reps << std::endl;
+    BenchSteppedLoop(reps);
+    BenchFilters(reps);
+    BenchTiledSource(reps);
+    BenchBlocks(reps, widths);
+    return 0;
+}
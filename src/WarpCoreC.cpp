@@ -0,0 +1,192 @@
+#include "WarpCoreC.h"
+#include "WarpCore.h"
+
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+// The opaque handle is just a Layer.
+struct WarpCoreLayer
+{
+    Layer layer;
+};
+
+static thread_local std::string lastError;
+
+static int Fail(const std::string& error)
+{
+    lastError = error;
+    return 0;
+}
+
+const char* WarpCore_LastError(void)
+{
+    return lastError.c_str();
+}
+
+void WarpCore_SetThreadCount(int count)
+{
+    WorkerPool::Get().SetThreadCount(count);
+}
+
+WarpCoreLayer* WarpCore_LoadLayer(const char* path)
+{
+    if (!path)
+    {
+        Fail("No path given");
+        return nullptr;
+    }
+
+    WarpCoreLayer* handle = new (std::nothrow) WarpCoreLayer();
+    if (!handle)
+    {
+        Fail("Out of memory");
+        return nullptr;
+    }
+
+    std::string error;
+    try
+    {
+        if (handle->layer.ReadImageFile(path, error))
+            return handle;
+    }
+    catch (const std::bad_alloc&)
+    {
+        error = "Out of memory";
+    }
+    delete handle;
+    Fail(error);
+    return nullptr;
+}
+
+void WarpCore_FreeLayer(WarpCoreLayer* layer)
+{
+    delete layer;
+}
+
+void WarpCore_GetLayerSize(const WarpCoreLayer* layer, int* width, int* height)
+{
+    if (width) *width = layer ? layer->layer.imageWidth : 0;
+    if (height) *height = layer ? layer->layer.imageHeight : 0;
+}
+
+int WarpCore_SetLayerFilter(WarpCoreLayer* layer, int filter)
+{
+    if (!layer) return Fail("No layer given");
+    if (filter < 0 || filter >= (int)WarpFilter::Count) return Fail("Unknown filter");
+    layer->layer.filter = (WarpFilter)filter;
+    return 1;
+}
+
+int WarpCore_WarpLayerToCorners(WarpCoreLayer* layer, const double corners[8])
+{
+    if (!layer || !corners) return Fail("No layer or corners given");
+
+    Point cornerPoints[4];
+    for (int i = 0; i < 4; i++)
+        cornerPoints[i] = Point(corners[2 * i], corners[2 * i + 1]);
+
+    try
+    {
+        if (!layer->layer.WarpToCorners(cornerPoints))
+            return Fail("Corners don't enclose any pixels");
+    }
+    catch (const std::bad_alloc&)
+    {
+        return Fail("Out of memory");
+    }
+    return 1;
+}
+
+int WarpCore_GetWarpedPixels(const WarpCoreLayer* layer, WarpCorePixels* pixels)
+{
+    if (!layer || !pixels) return Fail("No layer or pixels given");
+    if (layer->layer.warpDeferred) return Fail("Layer warp is deferred");
+
+    const ImageView<const PixelRGBA> view = layer->layer.WarpedView();
+    pixels->rgba = view.Empty() ? nullptr : &view.pixels[0].r;
+    pixels->width = view.width;
+    pixels->height = view.height;
+    pixels->strideBytes = view.stride * (int)sizeof(PixelRGBA);
+    pixels->originX = layer->layer.rasterPosX;
+    pixels->originY = layer->layer.rasterPosY;
+    return 1;
+}
+
+int WarpCore_SaveWarpedLayer(const WarpCoreLayer* layer, const char* path)
+{
+    if (!layer || !path) return Fail("No layer or path given");
+    if (layer->layer.warpDeferred) return Fail("Layer warp is deferred");
+
+    std::string error;
+    if (!WriteImageRGBA(path, layer->layer.WarpedView(), error)) return Fail(error);
+    return 1;
+}
+
+int WarpCore_SetLayerDeferred(WarpCoreLayer* layer, int deferred)
+{
+    if (!layer) return Fail("No layer given");
+
+    try
+    {
+        if (deferred)
+            layer->layer.DeferWarp();
+        else
+            layer->layer.MaterializeWarp();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return Fail("Out of memory");
+    }
+    return 1;
+}
+
+int WarpCore_SaveComposite(const WarpCoreLayer* const* layers, int count, int width, int height, const char* path)
+{
+    if ((!layers && count > 0) || !path) return Fail("No layers or path given");
+    if (width <= 0 || height <= 0) return Fail("Canvas size must be positive");
+
+    std::string error;
+    try
+    {
+        Image<PixelRGBA> canvas(width, height);
+        std::vector<const Layer*> stack(count);
+        for (int i = 0; i < count; i++)
+            stack[i] = layers[i] ? &layers[i]->layer : nullptr;
+        TileCompositor().Composite(canvas.View(), stack.data(), count, { 0, 0, 0, 0 });
+
+        if (!WriteImageRGBA(path, canvas.View(), error)) return Fail(error);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return Fail("Out of memory");
+    }
+    return 1;
+}
+
+int WarpCore_SolveHomography(const double src[8], const double dst[8], double matrix[9])
+{
+    if (!src || !dst || !matrix) return Fail("No points or matrix given");
+
+    Point srcPoints[4], dstPoints[4];
+    for (int i = 0; i < 4; i++)
+    {
+        srcPoints[i] = Point(src[2 * i], src[2 * i + 1]);
+        dstPoints[i] = Point(dst[2 * i], dst[2 * i + 1]);
+    }
+
+    // The closed form is solved in double, so hand that back as is; only quads
+    // it refuses go through the float LU, and only a usable result is written.
+    double H[9];
+    if (!SolveHomographyExact(srcPoints, dstPoints, H))
+    {
+        const Matrix3D M = SolveHomographyLU(srcPoints, dstPoints);
+        if (!M.allFinite() || !M.inverse().allFinite())
+            return Fail("Points are degenerate");
+        for (int i = 0; i < 9; i++)
+            H[i] = M(i / 3, i % 3);
+    }
+    memcpy(matrix, H, sizeof(H));
+    return 1;
+}
@@ -0,0 +1,578 @@
+#include "WarpKernels.h"
+#include "WarpSampling.h"
+
+#include <cctype>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+/*
+ *  Largest distance between where A and B put the corners of a (width x height)
+ *  source; infinite if either sends one to or behind the horizon.
+ */
+static double CornerDeviation(const Matrix3D& A, const Matrix3D& B, int width, int height)
+{
+    const double cornersU[4] = { 0.0, (double)width, (double)width, 0.0 };
+    const double cornersV[4] = { 0.0, 0.0, (double)height, (double)height };
+
+    double deviation = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        double mapped[2][2];
+        const Matrix3D* matrices[2] = { &A, &B };
+        for (int m = 0; m < 2; m++)
+        {
+            const Matrix3D& N = *matrices[m];
+            double w = N(2, 0) * cornersU[i] + N(2, 1) * cornersV[i] + N(2, 2);
+            if (!(w > 0.0))
+                return HUGE_VAL;
+            mapped[m][0] = (N(0, 0) * cornersU[i] + N(0, 1) * cornersV[i] + N(0, 2)) / w;
+            mapped[m][1] = (N(1, 0) * cornersU[i] + N(1, 1) * cornersV[i] + N(1, 2)) / w;
+        }
+        deviation = fmax(deviation, fmax(fabs(mapped[0][0] - mapped[1][0]), fabs(mapped[0][1] - mapped[1][1])));
+    }
+    return deviation;
+}
+
+WarpKind ClassifyWarp(const Matrix3D& M, int width, int height, Matrix3D& snapped)
+{
+    snapped = M;
+    if (!M.allFinite() || !(M(2, 2) != 0.0f))
+        return WarpKind::Projective;
+
+    // Same mapping with M(2, 2) = 1, then without the perspective terms.
+    Matrix3D affine = M / M(2, 2);
+    affine(2, 0) = affine(2, 1) = 0.0f;
+    affine(2, 2) = 1.0f;
+    if (!(CornerDeviation(M, affine, width, height) <= WARP_SNAP_TOLERANCE))
+        return WarpKind::Projective;
+    snapped = affine;
+
+    Matrix3D translation = Matrix3D::Identity();
+    translation(0, 2) = std::round(affine(0, 2));
+    translation(1, 2) = std::round(affine(1, 2));
+    if (!(CornerDeviation(M, translation, width, height) <= WARP_SNAP_TOLERANCE))
+        return WarpKind::Affine;
+    snapped = translation;
+
+    return (translation == Matrix3D::Identity()) ? WarpKind::Identity : WarpKind::Translation;
+}
+
+void WarpClipQuad::Build(const Matrix3D& M, int width, int height, double inset)
+{
+    const double left = -0.5 + inset, right = width - 0.5 - inset;
+    const double bottom = -0.5 + inset, top = height - 0.5 - inset;
+    const double cornersU[4] = { left, right, right, left };
+    const double cornersV[4] = { bottom, bottom, top, top };
+
+    valid = left < right && bottom < top;
+    if (!valid)
+        return;
+    for (int i = 0; i < 4; i++)
+    {
+        double xw = M(0, 0) * cornersU[i] + M(0, 1) * cornersV[i] + M(0, 2);
+        double yw = M(1, 0) * cornersU[i] + M(1, 1) * cornersV[i] + M(1, 2);
+        double w = M(2, 0) * cornersU[i] + M(2, 1) * cornersV[i] + M(2, 2);
+
+        // A homography only keeps the rectangle a convex quad if no part of it
+        // crosses the w = 0 line; otherwise just fall back to full rows.
+        if (!(w > 0.0))
+        {
+            valid = false;
+            return;
+        }
+        x[i] = xw / w;
+        y[i] = yw / w;
+    }
+}
+
+/*
+ *  Where the scanline through "scanY" enters and leaves a valid quad. Returns
+ *  false if it misses it.
+ */
+static bool CrossQuad(const WarpClipQuad& quad, double scanY, double& minX, double& maxX)
+{
+    const double* x = quad.x;
+    const double* y = quad.y;
+
+    // The quad is convex, so the scanline enters and leaves it at most once;
+    // the extremes of every edge crossing give the whole interval.
+    minX = DBL_MAX;
+    maxX = -DBL_MAX;
+    for (int i = 0; i < 4; i++)
+    {
+        int j = (i + 1) % 4;
+        double y0 = y[i], y1 = y[j];
+        if ((y0 < scanY && y1 < scanY) || (y0 > scanY && y1 > scanY)) continue;
+
+        double crossX0, crossX1;
+        if (y0 == y1)
+        {
+            crossX0 = x[i];
+            crossX1 = x[j];
+        }
+        else
+            crossX0 = crossX1 = x[i] + (scanY - y0) * (x[j] - x[i]) / (y1 - y0);
+
+        minX = (crossX0 < minX) ? crossX0 : minX;
+        minX = (crossX1 < minX) ? crossX1 : minX;
+        maxX = (crossX0 > maxX) ? crossX0 : maxX;
+        maxX = (crossX1 > maxX) ? crossX1 : maxX;
+    }
+    return minX <= maxX;
+}
+
+bool WarpClipQuad::RowSpan(int row, int rowWidth, int& xStart, int& xEnd) const
+{
+    if (!valid)
+    {
+        xStart = 0;
+        xEnd = rowWidth;
+        return rowWidth > 0;
+    }
+
+    double minX, maxX;
+    if (!CrossQuad(*this, row, minX, maxX)) return false;
+
+    double start = std::floor(minX) - 1.0;
+    double end = std::ceil(maxX) + 2.0;
+    xStart = (start < 0.0) ? 0 : (start > rowWidth) ? rowWidth : (int)start;
+    xEnd = (end < 0.0) ? 0 : (end > rowWidth) ? rowWidth : (int)end;
+    return xStart < xEnd;
+}
+
+bool WarpClipQuad::InnerSpan(int row, int& xStart, int& xEnd) const
+{
+    double minX, maxX;
+    if (!valid || !CrossQuad(*this, row, minX, maxX)) return false;
+
+    const double start = std::ceil(minX), end = std::floor(maxX) + 1.0;
+    if (!(start < end) || start < INT_MIN || end > INT_MAX) return false;
+    xStart = (int)start;
+    xEnd = (int)end;
+    return true;
+}
+
+bool WarpClipQuad::ContainsBox(double x0, double y0, double x1, double y1) const
+{
+    if (!valid)
+        return false;
+
+    // The quad is convex, but wound either way (mirroring warps flip it), so a
+    // point is inside when it's on the same side of every edge as the quad is.
+    double winding = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        int j = (i + 1) % 4;
+        winding += x[i] * y[j] - x[j] * y[i];
+    }
+    if (winding == 0.0)
+        return false;
+
+    const double boxX[4] = { x0, x1, x1, x0 };
+    const double boxY[4] = { y0, y0, y1, y1 };
+    for (int i = 0; i < 4; i++)
+    {
+        int j = (i + 1) % 4;
+        for (int k = 0; k < 4; k++)
+        {
+            double side = (x[j] - x[i]) * (boxY[k] - y[i]) - (y[j] - y[i]) * (boxX[k] - x[i]);
+            if (side * winding < 0.0)
+                return false;
+        }
+    }
+    return true;
+}
+
+void WarpTile::RowSpan(int y, int xStart, int xEnd, WarpSpan& span) const
+{
+    // Row y's ends, interpolated down the tile's left and right edges.
+    const double fy = (double)(y - y0) / (y1 - y0);
+    const double leftU = u[0] + (u[3] - u[0]) * fy, leftV = v[0] + (v[3] - v[0]) * fy;
+    const double rightU = u[1] + (u[2] - u[1]) * fy, rightV = v[1] + (v[2] - v[1]) * fy;
+
+    const double invWidth = 1.0 / (x1 - x0), invHeight = 1.0 / (y1 - y0);
+    span.stepU = (rightU - leftU) * invWidth;
+    span.stepV = (rightV - leftV) * invWidth;
+    span.stepW = 0.0;
+    span.u = leftU + span.stepU * (xStart - x0);
+    span.v = leftV + span.stepV * (xStart - x0);
+    span.w = 1.0;
+
+    // The vertical derivative changes along the row; the span's middle is close enough for a footprint.
+    const double fx = (0.5 * (xStart + xEnd) - x0) * invWidth;
+    span.downU = ((u[3] - u[0]) + ((u[2] - u[1]) - (u[3] - u[0])) * fx) * invHeight;
+    span.downV = ((v[3] - v[0]) + ((v[2] - v[1]) - (v[3] - v[0])) * fx) * invHeight;
+    span.downW = 0.0;
+    span.count = xEnd - xStart;
+}
+
+/*
+ *  Source position of output pixel (x, y); false at or behind the horizon.
+ */
+static bool MapPoint(const Matrix3D& invM, double x, double y, double& u, double& v)
+{
+    double uw = invM(0, 0) * x + invM(0, 1) * y + invM(0, 2);
+    double vw = invM(1, 0) * x + invM(1, 1) * y + invM(1, 2);
+    double w = invM(2, 0) * x + invM(2, 1) * y + invM(2, 2);
+    if (!(w > 0.0))
+        return false;
+    u = uw / w;
+    v = vw / w;
+    return true;
+}
+
+static double Distance(double u0, double v0, double u1, double v1)
+{
+    return sqrt((u1 - u0) * (u1 - u0) + (v1 - v0) * (v1 - v0));
+}
+
+static void SplitWarpTile(const Matrix3D& invM, WarpTile tile, double tolerance, std::vector<WarpTile>& tiles)
+{
+    const double cornerX[4] = { (double)tile.x0, (double)tile.x1, (double)tile.x1, (double)tile.x0 };
+    const double cornerY[4] = { (double)tile.y0, (double)tile.y0, (double)tile.y1, (double)tile.y1 };
+    tile.exact = false;
+    for (int i = 0; i < 4 && !tile.exact; i++)
+        tile.exact = !MapPoint(invM, cornerX[i], cornerY[i], tile.u[i], tile.v[i]);
+
+    // Bilinear interpolation is exact at the corners, and a homography's error
+    // against it peaks in the interior, so check the center and edge midpoints.
+    double error = 0.0;
+    for (int i = 0; i < 5 && !tile.exact; i++)
+    {
+        int a = i & 3, b = (i + 1) & 3;
+        double x = 0.5 * (cornerX[a] + cornerX[b]), y = 0.5 * (cornerY[a] + cornerY[b]);
+        double u = 0.5 * (tile.u[a] + tile.u[b]), v = 0.5 * (tile.v[a] + tile.v[b]);
+        if (i == 4)
+        {
+            x = 0.5 * (tile.x0 + tile.x1);
+            y = 0.5 * (tile.y0 + tile.y1);
+            u = 0.25 * (tile.u[0] + tile.u[1] + tile.u[2] + tile.u[3]);
+            v = 0.25 * (tile.v[0] + tile.v[1] + tile.v[2] + tile.v[3]);
+        }
+
+        double exactU, exactV;
+        if (!MapPoint(invM, x, y, exactU, exactV))
+            tile.exact = true;
+        else
+            error = fmax(error, Distance(u, v, exactU, exactV));
+    }
+
+    // Halve the longer side; the error grows with the square of the size, so that's
+    // the side doing the damage, and it keeps each tile's rows as long as possible.
+    const int width = tile.x1 - tile.x0, height = tile.y1 - tile.y0;
+    const bool splitX = width >= height;
+    if (!(error > tolerance) && !tile.exact)
+    {
+        tiles.push_back(tile);
+        return;
+    }
+    if ((splitX ? width : height) <= WARP_MIN_TILE_SIZE)
+    {
+        tile.exact = true;
+        tiles.push_back(tile);
+        return;
+    }
+
+    WarpTile first = tile, second = tile;
+    if (splitX)
+        first.x1 = second.x0 = tile.x0 + width / 2;
+    else
+        first.y1 = second.y0 = tile.y0 + height / 2;
+    SplitWarpTile(invM, first, tolerance, tiles);
+    SplitWarpTile(invM, second, tolerance, tiles);
+}
+
+void BuildWarpTiles(const Matrix3D& invM, int xBegin, int yBegin, int xEnd, int yEnd,
+    double tolerance, std::vector<WarpTile>& tiles)
+{
+    for (int y = yBegin; y < yEnd; y += WARP_TILE_SIZE)
+    {
+        for (int x = xBegin; x < xEnd; x += WARP_TILE_SIZE)
+        {
+            WarpTile tile;
+            tile.x0 = x;
+            tile.y0 = y;
+            tile.x1 = (x + WARP_TILE_SIZE < xEnd) ? (x + WARP_TILE_SIZE) : xEnd;
+            tile.y1 = (y + WARP_TILE_SIZE < yEnd) ? (y + WARP_TILE_SIZE) : yEnd;
+            SplitWarpTile(invM, tile, tolerance, tiles);
+        }
+    }
+}
+
+/*
+ *  Footprint in the source of a (width x rows) block of output pixels, given the
+ *  inverse warp's Jacobian J (du/dx, du/dy, dv/dx, dv/dy): the bytes of the cache
+ *  lines it covers, and the most source rows (tile rows when tiled) it reads
+ *  from any one column of lines.
+ */
+static void BlockFootprint(double width, double rows, const double J[4], bool tiled, double& bytes, double& sharedRows)
+{
+    // The footprint is a parallelogram, with one edge along the block's rows and one down its columns.
+    const double rowU = width * J[0], rowV = width * J[2];
+    const double columnU = rows * J[1], columnV = rows * J[3];
+    const double sourceRows = fabs(rowV) + fabs(columnV);
+    const double area = fabs(rowU * columnV - rowV * columnU);
+
+    // Width of its cross section along a source row, and how far that moves
+    // sideways per row, going along whichever edge spans more rows.
+    const bool rowEdge = fabs(rowV) > fabs(columnV);
+    const double tallU = rowEdge ? rowU : columnU, tallV = rowEdge ? rowV : columnV;
+    const double chord = (fabs(tallV) > 1.0) ? area / fabs(tallV) : fabs(rowU) + fabs(columnU);
+    const double shift = (fabs(tallV) > 1.0) ? fabs(tallU / tallV) : 0.0;
+
+    // A line is 16 pixels of a plain row, or two rows of a tile; plus a line of
+    // misalignment and filter reach each way.
+    const double lineColumns = tiled ? (double)WARP_SOURCE_TILE : 64.0 / sizeof(PixelRGBA);
+    const double lineRows = tiled ? 2.0 : 1.0;
+    bytes = (sourceRows / lineRows + 2.0) * (chord / lineColumns + 2.0) * 64.0;
+
+    const double rowPitch = tiled ? (double)WARP_SOURCE_TILE : 1.0;
+    sharedRows = ((shift > 0.0) ? fmin(sourceRows, (lineColumns + chord) / shift) : sourceRows) / rowPitch;
+}
+
+int ChooseWarpBlockWidth(const Matrix3D& invM, int x, int y, int rows, bool tiled)
+{
+    double u, v;
+    if (!MapPoint(invM, x, y, u, v))
+        return WARP_MIN_BLOCK_WIDTH;
+
+    // Jacobian of (u, v) = (u*w / w, v*w / w) with respect to output x and y.
+    const double w = invM(2, 0) * x + invM(2, 1) * y + invM(2, 2);
+    const double J[4] = { (invM(0, 0) - u * invM(2, 0)) / w, (invM(0, 1) - u * invM(2, 1)) / w,
+                          (invM(1, 0) - v * invM(2, 0)) / w, (invM(1, 1) - v * invM(2, 1)) / w };
+
+    int width = WARP_MIN_BLOCK_WIDTH;
+    while (width < WARP_MAX_BLOCK_WIDTH)
+    {
+        double bytes, sharedRows;
+        BlockFootprint(2.0 * width, rows, J, tiled, bytes, sharedRows);
+        if (!(bytes <= WARP_BLOCK_CACHE_BYTES) || !(sharedRows <= WARP_BLOCK_SHARED_ROWS))
+            break;
+        width *= 2;
+    }
+    return width;
+}
+
+const char* WarpFilterName(WarpFilter filter)
+{
+    switch (filter)
+    {
+        case WarpFilter::Bilinear:  return "Bilinear";
+        case WarpFilter::Bicubic:   return "Bicubic";
+        case WarpFilter::Trilinear: return "Trilinear";
+        default:                    return "Nearest";
+    }
+}
+
+bool ParseWarpFilter(const char* name, WarpFilter& filter)
+{
+    for (int i = 0; i < (int)WarpFilter::Count; i++)
+    {
+        const char* candidate = WarpFilterName((WarpFilter)i);
+        int c = 0;
+        while (name[c] && tolower((unsigned char)name[c]) == tolower((unsigned char)candidate[c]))
+            c++;
+        if (!name[c] && !candidate[c])
+        {
+            filter = (WarpFilter)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+WarpSpanFunc WarpKernelTable::Get(WarpFilter filter, bool tiled) const
+{
+    switch (filter)
+    {
+        case WarpFilter::Bilinear:
+        case WarpFilter::Trilinear: return tiled ? bilinearTiled : bilinear;
+        case WarpFilter::Bicubic:   return tiled ? bicubicTiled : bicubic;
+        default:                    return tiled ? nearestTiled : nearest;
+    }
+}
+
+static WarpKernelTable SelectWarpKernels(SimdLevel level)
+{
+    WarpKernelTable table;
+    table.level = level;
+    table.nearest = WarpSpanNearestScalar;
+    table.bilinear = WarpSpanBilinearScalar;
+    table.bicubic = WarpSpanBicubicScalar;
+    table.nearestTiled = WarpSpanNearestTiledScalar;
+    table.bilinearTiled = WarpSpanBilinearTiledScalar;
+    table.bicubicTiled = WarpSpanBicubicTiledScalar;
+    table.downsample = MipDownsampleScalar;
+
+    // Only Nearest reads the tiled copy (see Layer::InvWarpLayer), so AVX-512
+    // machines keep the AVX2 tiled filtered kernels, and the AVX2 downsample.
+    switch (level)
+    {
+        case SimdLevel::AVX512:
+            table.nearest = WarpSpanNearestAVX512;
+            table.bilinear = WarpSpanBilinearAVX512;
+            table.bicubic = WarpSpanBicubicAVX512;
+            table.nearestTiled = WarpSpanNearestTiledAVX512;
+            table.bilinearTiled = WarpSpanBilinearTiledAVX2;
+            table.bicubicTiled = WarpSpanBicubicTiledAVX2;
+            table.downsample = MipDownsampleAVX2;
+            break;
+        case SimdLevel::AVX2:
+            table.nearest = WarpSpanNearestAVX2;
+            table.bilinear = WarpSpanBilinearAVX2;
+            table.bicubic = WarpSpanBicubicAVX2;
+            table.nearestTiled = WarpSpanNearestTiledAVX2;
+            table.bilinearTiled = WarpSpanBilinearTiledAVX2;
+            table.bicubicTiled = WarpSpanBicubicTiledAVX2;
+            table.downsample = MipDownsampleAVX2;
+            break;
+        case SimdLevel::SSE41:
+            table.nearest = WarpSpanNearestSSE41;
+            table.bilinear = WarpSpanBilinearSSE41;
+            table.bicubic = WarpSpanBicubicSSE41;
+            table.nearestTiled = WarpSpanNearestTiledSSE41;
+            table.bilinearTiled = WarpSpanBilinearTiledSSE41;
+            table.bicubicTiled = WarpSpanBicubicTiledSSE41;
+            break;
+        default:
+            break;
+    }
+    return table;
+}
+
+static WarpKernelTable& CurrentWarpKernels()
+{
+    static WarpKernelTable table = SelectWarpKernels(DetectSimdLevel());
+    return table;
+}
+
+const WarpKernelTable& GetWarpKernels()
+{
+    return CurrentWarpKernels();
+}
+
+void SetWarpSimdLevel(SimdLevel level)
+{
+    if (level > DetectSimdLevel())
+        level = DetectSimdLevel();
+    CurrentWarpKernels() = SelectWarpKernels(level);
+}
+
+/*
+ *	Weights from the Catmull-Rom polynomials, rounded; the second tap takes up
+ *	whatever rounding left over, so every entry sums to exactly 1.
+ */
+CatmullRomTable::CatmullRomTable()
+{
+    const double scale = (double)(1 << BICUBIC_WEIGHT_BITS);
+    for (int i = 0; i <= 256; i++)
+    {
+        const double t = i / 256.0, t2 = t * t, t3 = t2 * t;
+        CatmullRomTaps& entry = taps[i];
+        entry.weight[0] = (short)std::lround(scale * 0.5 * (-t3 + 2.0 * t2 - t));
+        entry.weight[2] = (short)std::lround(scale * 0.5 * (-3.0 * t3 + 4.0 * t2 + t));
+        entry.weight[3] = (short)std::lround(scale * 0.5 * (t3 - t2));
+        entry.weight[1] = (short)((1 << BICUBIC_WEIGHT_BITS) - entry.weight[0] - entry.weight[2] - entry.weight[3]);
+    }
+}
+
+const CatmullRomTable catmullRomTable;
+
+/*
+ *	Shared loop for the scalar kernels; only the sampler differs between filters.
+ *	Affine spans compile without the divide.
+ */
+template <PixelRGBA (*Sample)(const WarpSource&, double, double), bool Projective>
+static void WarpSpanScalarLoop(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    // lround(u) lands in [0, width) exactly when u is in (-0.5, width - 0.5), and
+    // every filter uses that same footprint. Comparing before converting also
+    // throws out the huge/NaN values produced near w = 0.
+    const double maxU = src.width - 0.5;
+    const double maxV = src.height - 0.5;
+
+    // Step (u*w, v*w, w) with adds, re-anchoring with an exact evaluation every
+    // WARP_ANCHOR_SPAN pixels so drift can't push a sample into the next pixel.
+    for (int anchor = 0; anchor < span.count; anchor += WARP_ANCHOR_SPAN)
+    {
+        int end = (anchor + WARP_ANCHOR_SPAN < span.count) ? (anchor + WARP_ANCHOR_SPAN) : span.count;
+        double uw = span.u + span.stepU * anchor;
+        double vw = span.v + span.stepV * anchor;
+        double w = span.w + span.stepW * anchor;
+
+        for (int i = anchor; i < end; i++)
+        {
+            // Normalize; one reciprocal shared between u and v.
+            double invW = Projective ? 1.0 / w : 1.0;
+            double u = uw * invW;
+            double v = vw * invW;
+
+            if (u > -0.5 && v > -0.5 && u < maxU && v < maxV)
+                out[i] = Sample(src, u, v);
+            else
+                out[i].r = out[i].g = out[i].b = out[i].a = 0;
+
+            uw += span.stepU;
+            vw += span.stepV;
+            w += span.stepW;
+        }
+    }
+}
+
+template <PixelRGBA (*Sample)(const WarpSource&, double, double)>
+static void WarpSpanScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (span.IsAffine())
+        WarpSpanScalarLoop<Sample, false>(src, span, out);
+    else
+        WarpSpanScalarLoop<Sample, true>(src, span, out);
+}
+
+void WarpSpanNearestScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanScalar<SampleNearest<false>>(src, span, out);
+}
+
+void WarpSpanBilinearScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanScalar<SampleBilinear<false>>(src, span, out);
+}
+
+void WarpSpanBicubicScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanScalar<SampleBicubic<false>>(src, span, out);
+}
+
+void WarpSpanNearestTiledScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanScalar<SampleNearest<true>>(src, span, out);
+}
+
+void WarpSpanBilinearTiledScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanScalar<SampleBilinear<true>>(src, span, out);
+}
+
+void WarpSpanBicubicTiledScalar(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanScalar<SampleBicubic<true>>(src, span, out);
+}
+
+
+void MipDownsampleScalar(const PixelRGBA* top, const PixelRGBA* bottom, int srcWidth, PixelRGBA* out)
+{
+    const int outWidth = (srcWidth + 1) / 2;
+    for (int x = 0; x < outWidth; x++)
+    {
+        int left = 2 * x;
+        int right = (left + 1 < srcWidth) ? (left + 1) : left;
+        const unsigned char* p00 = &top[left].r;
+        const unsigned char* p10 = &top[right].r;
+        const unsigned char* p01 = &bottom[left].r;
+        const unsigned char* p11 = &bottom[right].r;
+        unsigned char* result = &out[x].r;
+        for (int c = 0; c < 4; c++)
+            result[c] = (unsigned char)((p00[c] + p10[c] + p01[c] + p11[c] + 2) >> 2);
+    }
+}
\ No newline at end of file
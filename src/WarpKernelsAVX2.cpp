@@ -0,0 +1,439 @@
+#include "WarpKernels.h"
+#include "WarpSampling.h"
+
+#include <immintrin.h>
+
+/*
+ *  Offsets of source rows "y" and columns "x"; a pixel's index is the sum of the
+ *  two. The tiled versions are TiledRowOffset and TiledColumnOffset.
+ */
+template <bool Tiled>
+TARGET_AVX2 static FORCE_INLINE __m256i RowOffset8(__m256i y, __m256i stride)
+{
+    if (!Tiled)
+        return _mm256_mullo_epi32(y, stride);
+    const __m256i low = _mm256_set1_epi32(WARP_SOURCE_TILE - 1);
+    return _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, WARP_SOURCE_TILE_SHIFT), stride),
+        _mm256_slli_epi32(_mm256_and_si256(y, low), WARP_SOURCE_TILE_SHIFT));
+}
+
+template <bool Tiled>
+TARGET_AVX2 static FORCE_INLINE __m256i ColumnOffset8(__m256i x)
+{
+    if (!Tiled)
+        return x;
+    const __m256i low = _mm256_set1_epi32(WARP_SOURCE_TILE - 1);
+    return _mm256_add_epi32(_mm256_slli_epi32(_mm256_srli_epi32(x, WARP_SOURCE_TILE_SHIFT), 2 * WARP_SOURCE_TILE_SHIFT),
+        _mm256_and_si256(x, low));
+}
+
+/*
+ *  Samplers take 8 source positions and a mask of the lanes that are inside
+ *  the source, and return the filtered pixels (masked lanes are ignored).
+ */
+template <bool Tiled>
+TARGET_AVX2 static FORCE_INLINE __m256i SampleNearest8(const WarpSource& src, __m256 u, __m256 v, __m256i inside)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    __m256i ui = _mm256_cvttps_epi32(_mm256_add_ps(u, half));
+    __m256i vi = _mm256_cvttps_epi32(_mm256_add_ps(v, half));
+    __m256i index = _mm256_add_epi32(RowOffset8<Tiled>(vi, _mm256_set1_epi32(src.stride)), ColumnOffset8<Tiled>(ui));
+    return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)src.pixels, index, inside, 4);
+}
+
+/*
+ *  Two 8-byte pixel pairs per 128-bit half, loaded a lane at a time (no slower
+ *  than pair gathers, and it's what the bicubic rows need anyway), then split
+ *  into the left and right pixel of every lane.
+ */
+TARGET_AVX2 static FORCE_INLINE __m128 LoadPixelPairs2(const PixelRGBA* low, const PixelRGBA* high)
+{
+    return _mm_loadh_pi(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)low)), (const __m64*)high);
+}
+
+TARGET_AVX2 static FORCE_INLINE void LoadPixelPairs8(const PixelRGBA* pixels, const int lanes[8], __m256i& left, __m256i& right)
+{
+    __m256 low = _mm256_insertf128_ps(_mm256_castps128_ps256(LoadPixelPairs2(pixels + lanes[0], pixels + lanes[1])),
+        LoadPixelPairs2(pixels + lanes[4], pixels + lanes[5]), 1);
+    __m256 high = _mm256_insertf128_ps(_mm256_castps128_ps256(LoadPixelPairs2(pixels + lanes[2], pixels + lanes[3])),
+        LoadPixelPairs2(pixels + lanes[6], pixels + lanes[7]), 1);
+    left = _mm256_castps_si256(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+    right = _mm256_castps_si256(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+/*
+ *  The pixels at columns x and x + 1 of the rows at "row". In the tiled layout
+ *  they're apart when x is the last column of a tile; the right one then comes
+ *  from a second pair load ending on it.
+ */
+template <bool Tiled>
+TARGET_AVX2 static FORCE_INLINE void LoadRowTaps8(const PixelRGBA* pixels, __m256i row, __m256i x, __m256i& left, __m256i& right)
+{
+    alignas(32) int lanes[8];
+    _mm256_store_si256((__m256i*)lanes, _mm256_add_epi32(row, ColumnOffset8<Tiled>(x)));
+    LoadPixelPairs8(pixels, lanes, left, right);
+    if (!Tiled)
+        return;
+
+    const __m256i low = _mm256_set1_epi32(WARP_SOURCE_TILE - 1);
+    const __m256i crossing = _mm256_cmpeq_epi32(_mm256_and_si256(x, low), low);
+    __m256i unused, nextRight;
+    _mm256_store_si256((__m256i*)lanes, _mm256_add_epi32(row,
+        _mm256_sub_epi32(ColumnOffset8<true>(_mm256_add_epi32(x, _mm256_set1_epi32(1))), _mm256_set1_epi32(1))));
+    LoadPixelPairs8(pixels, lanes, unused, nextRight);
+    right = _mm256_blendv_epi8(right, nextRight, crossing);
+}
+
+/*
+ *  Blends 16-bit channels a and b as (a * (256 - weight) + b * weight + 128) >> 8.
+ *  That's a + (((b - a) * weight + 128) >> 8), and mulhrs(a - b, -weight * 128)
+ *  computes exactly the second term without leaving 16 bits. The weight comes
+ *  in negated and scaled (see BilinearTap8); -256 * 128 still fits.
+ */
+TARGET_AVX2 static FORCE_INLINE __m256i LerpChannels(__m256i a, __m256i b, __m256i negWeight)
+{
+    return _mm256_add_epi16(a, _mm256_mulhrs_epi16(_mm256_sub_epi16(a, b), negWeight));
+}
+
+/*
+ *  A row's two taps blended horizontally, as red/blue and green/alpha 16-bit
+ *  lanes so the vertical blend can follow without repacking.
+ */
+TARGET_AVX2 static FORCE_INLINE void LerpRow(__m256i left, __m256i right, __m256i negWeight, __m256i& redBlue, __m256i& greenAlpha)
+{
+    const __m256i evenBytes = _mm256_set1_epi32(0x00FF00FF);
+    redBlue = LerpChannels(_mm256_and_si256(left, evenBytes), _mm256_and_si256(right, evenBytes), negWeight);
+    greenAlpha = LerpChannels(_mm256_srli_epi16(left, 8), _mm256_srli_epi16(right, 8), negWeight);
+}
+
+/*
+ *  Clamping the top-left tap to [0, size - 2] and the fraction to [0, 1] gives the
+ *  same result as clamping both taps to the edge, but keeps the two taps of a row
+ *  next to each other in memory. Fractions are quantized to 1/256 of a pixel, so
+ *  rounding u * 256 once gives the tap and the fraction together; clamping that
+ *  to [0, (size - 1) * 256] does both clamps. Returns the tap; "negWeight" gets
+ *  the fraction for LerpChannels, in both 16-bit halves of every lane.
+ */
+TARGET_AVX2 static FORCE_INLINE __m256i BilinearTap8(__m256 u, int size, __m256i& negWeight)
+{
+    // Lanes outside may be NaN, which converts to INT_MIN and clamps to 0.
+    __m256i fixed = _mm256_cvtps_epi32(_mm256_mul_ps(u, _mm256_set1_ps(256.0f)));
+    fixed = _mm256_min_epi32(_mm256_max_epi32(fixed, _mm256_setzero_si256()), _mm256_set1_epi32((size - 1) * 256));
+    __m256i x = _mm256_min_epi32(_mm256_srai_epi32(fixed, 8), _mm256_set1_epi32(size - 2));
+
+    const __m256i bothHalves = _mm256_setr_epi8(0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13,
+        0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13);
+    negWeight = _mm256_sub_epi32(_mm256_slli_epi32(x, 15), _mm256_slli_epi32(fixed, 7));
+    negWeight = _mm256_shuffle_epi8(negWeight, bothHalves);
+    return x;
+}
+
+/*
+ *  Bilinear in 16-bit fixed point, from the taps and weights of BilinearTap8.
+ *  Needs an image at least 2x2. The clamps keep every lane's loads inside the
+ *  image, so unlike the others it has no use for the lane mask.
+ */
+template <bool Tiled>
+TARGET_AVX2 static FORCE_INLINE __m256i SampleBilinear8(const WarpSource& src, __m256 u, __m256 v, __m256i)
+{
+    __m256i weightX, weightY;
+    __m256i x = BilinearTap8(u, src.width, weightX);
+    __m256i y = BilinearTap8(v, src.height, weightY);
+
+    __m256i stride = _mm256_set1_epi32(src.stride);
+    __m256i top = RowOffset8<Tiled>(y, stride);
+    __m256i bottom = RowOffset8<Tiled>(_mm256_add_epi32(y, _mm256_set1_epi32(1)), stride);
+
+    __m256i left, right, topRedBlue, topGreenAlpha, bottomRedBlue, bottomGreenAlpha;
+    LoadRowTaps8<Tiled>(src.pixels, top, x, left, right);
+    LerpRow(left, right, weightX, topRedBlue, topGreenAlpha);
+    LoadRowTaps8<Tiled>(src.pixels, bottom, x, left, right);
+    LerpRow(left, right, weightX, bottomRedBlue, bottomGreenAlpha);
+
+    __m256i redBlue = LerpChannels(topRedBlue, bottomRedBlue, weightY);
+    __m256i greenAlpha = LerpChannels(topGreenAlpha, bottomGreenAlpha, weightY);
+    return _mm256_or_si256(redBlue, _mm256_slli_epi16(greenAlpha, 8));
+}
+
+/*
+ *  Which bytes of a row of 4 bicubic taps come from the second load in the tiled
+ *  layout, by the column the taps start at within their tile (see
+ *  SampleBicubic4 in WarpKernelsSSE41.cpp).
+ */
+alignas(16) static const unsigned char bicubicTileCrossing[WARP_SOURCE_TILE][16] =
+{
+    { 0 }, { 0 }, { 0 }, { 0 }, { 0 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+};
+
+TARGET_AVX2 static FORCE_INLINE __m256i LoadLanes(const void* low, const void* high)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)low)),
+        _mm_loadu_si128((const __m128i*)high), 1);
+}
+
+/*
+ *  The SSE4.1 BicubicRow and BicubicColumn for two pixels at once, one per
+ *  128-bit half.
+ */
+TARGET_AVX2 static FORCE_INLINE __m256i BicubicRow2(__m256i row, __m256i weights01, __m256i weights23)
+{
+    const __m256i pairs01 = _mm256_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1,
+        0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1);
+    const __m256i pairs23 = _mm256_setr_epi8(8, -1, 12, -1, 9, -1, 13, -1, 10, -1, 14, -1, 11, -1, 15, -1,
+        8, -1, 12, -1, 9, -1, 13, -1, 10, -1, 14, -1, 11, -1, 15, -1);
+    return _mm256_add_epi32(_mm256_madd_epi16(_mm256_shuffle_epi8(row, pairs01), weights01),
+        _mm256_madd_epi16(_mm256_shuffle_epi8(row, pairs23), weights23));
+}
+
+TARGET_AVX2 static FORCE_INLINE __m256i BicubicColumn2(const __m256i rows[4], __m256i weights01, __m256i weights23)
+{
+    __m256i pair01 = _mm256_blend_epi16(_mm256_srli_epi32(rows[0], BICUBIC_ROW_SHIFT), _mm256_slli_epi32(rows[1], 16 - BICUBIC_ROW_SHIFT), 0xAA);
+    __m256i pair23 = _mm256_blend_epi16(_mm256_srli_epi32(rows[2], BICUBIC_ROW_SHIFT), _mm256_slli_epi32(rows[3], 16 - BICUBIC_ROW_SHIFT), 0xAA);
+    __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(pair01, weights01), _mm256_madd_epi16(pair23, weights23));
+    sum = _mm256_add_epi32(sum, _mm256_set1_epi32(1 << (BICUBIC_FINAL_SHIFT - 1)));
+    return _mm256_srai_epi32(sum, BICUBIC_FINAL_SHIFT);
+}
+
+/*
+ *  Fixed point Catmull-Rom matching SampleBicubic, the same way as the SSE4.1
+ *  kernel: each row of a lane's taps is one 16-byte load, and lanes with taps
+ *  off the edge go through SampleBicubic. Needs an image at least 4x4.
+ */
+template <bool Tiled>
+TARGET_AVX2 static FORCE_INLINE __m256i SampleBicubic8(const WarpSource& src, __m256 u, __m256 v, __m256i inside)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i fraction = _mm256_set1_epi32(255);
+    const __m256i maxX = _mm256_set1_epi32(src.width - 3);
+    const __m256i maxY = _mm256_set1_epi32(src.height - 3);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i stride = _mm256_set1_epi32(src.stride);
+
+    // As in BilinearTap8; a fraction rounding up to a whole pixel is the next
+    // tap at fraction 0, which has the same weights.
+    __m256i fixedU = _mm256_cvtps_epi32(_mm256_mul_ps(u, _mm256_set1_ps(256.0f)));
+    __m256i fixedV = _mm256_cvtps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(256.0f)));
+    __m256i x = _mm256_srai_epi32(fixedU, 8), y = _mm256_srai_epi32(fixedV, 8);
+    __m256i fracX = _mm256_and_si256(fixedU, fraction), fracY = _mm256_and_si256(fixedV, fraction);
+
+    // Lanes with every tap inside; the rest load from a clamped position instead.
+    __m256i fast = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(x, zero), _mm256_cmpgt_epi32(y, zero)),
+        _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_add_epi32(maxX, one), x), _mm256_cmpgt_epi32(_mm256_add_epi32(maxY, one), y)));
+    fast = _mm256_and_si256(fast, inside);
+    x = _mm256_min_epi32(_mm256_max_epi32(x, one), maxX);
+    y = _mm256_min_epi32(_mm256_max_epi32(y, one), maxY);
+
+    // Where each lane's row of taps starts, for every row; in the tiled layout
+    // also where the row's last tap's 16 bytes start, for rows crossing a tile.
+    alignas(32) int taps[4][8], tapsNext[4][8], tableX[8], tableY[8], tileColumn[8];
+    __m256i left = _mm256_sub_epi32(x, one);
+    const __m256i first = ColumnOffset8<Tiled>(left);
+    const __m256i second = _mm256_sub_epi32(ColumnOffset8<Tiled>(_mm256_add_epi32(x, _mm256_set1_epi32(2))), _mm256_set1_epi32(3));
+    for (int j = 0; j < 4; j++)
+    {
+        const __m256i row = RowOffset8<Tiled>(_mm256_add_epi32(y, _mm256_set1_epi32(j - 1)), stride);
+        _mm256_store_si256((__m256i*)taps[j], _mm256_add_epi32(row, first));
+        if (Tiled)
+            _mm256_store_si256((__m256i*)tapsNext[j], _mm256_add_epi32(row, second));
+    }
+    if (Tiled)
+        _mm256_store_si256((__m256i*)tileColumn, _mm256_and_si256(left, _mm256_set1_epi32(WARP_SOURCE_TILE - 1)));
+    _mm256_store_si256((__m256i*)tableX, fracX);
+    _mm256_store_si256((__m256i*)tableY, fracY);
+
+    // Lanes l and l + 1 go through together, one per half.
+    const CatmullRomTaps* table = catmullRomTable.taps;
+    __m256i result[4];
+    for (int l = 0; l < 8; l += 2)
+    {
+        const __m256i tapsX = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)&table[tableX[l]])),
+            _mm_loadl_epi64((const __m128i*)&table[tableX[l + 1]]), 1);
+        const __m256i tapsY = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)&table[tableY[l]])),
+            _mm_loadl_epi64((const __m128i*)&table[tableY[l + 1]]), 1);
+        const __m256i x01 = _mm256_shuffle_epi32(tapsX, 0x00), x23 = _mm256_shuffle_epi32(tapsX, 0x55);
+
+        __m256i sums[4];
+        for (int j = 0; j < 4; j++)
+        {
+            __m256i row = LoadLanes(src.pixels + taps[j][l], src.pixels + taps[j][l + 1]);
+            if (Tiled)
+            {
+                const __m256i next = LoadLanes(src.pixels + tapsNext[j][l], src.pixels + tapsNext[j][l + 1]);
+                row = _mm256_blendv_epi8(row, next, LoadLanes(bicubicTileCrossing[tileColumn[l]], bicubicTileCrossing[tileColumn[l + 1]]));
+            }
+            sums[j] = BicubicRow2(row, x01, x23);
+        }
+        result[l / 2] = BicubicColumn2(sums, _mm256_shuffle_epi32(tapsY, 0x00), _mm256_shuffle_epi32(tapsY, 0x55));
+    }
+
+    // Halves hold lanes (0, 2, 4, 6) and (1, 3, 5, 7) after packing; the permute puts them in order.
+    __m256i pixels = _mm256_packus_epi16(_mm256_packs_epi32(result[0], result[1]), _mm256_packs_epi32(result[2], result[3]));
+    pixels = _mm256_permutevar8x32_epi32(pixels, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+    // Lanes inside but too near the edge for the loads above.
+    const int slow = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(fast, inside)));
+    if (slow)
+    {
+        alignas(32) float laneU[8], laneV[8];
+        alignas(32) PixelRGBA lanePixels[8];
+        _mm256_store_ps(laneU, u);
+        _mm256_store_ps(laneV, v);
+        _mm256_store_si256((__m256i*)lanePixels, pixels);
+        for (int l = 0; l < 8; l++)
+            if (slow & (1 << l))
+                lanePixels[l] = SampleBicubic<Tiled>(src, laneU[l], laneV[l]);
+        pixels = _mm256_load_si256((const __m256i*)lanePixels);
+    }
+    return pixels;
+}
+
+/*
+ *  8 pixels per iteration: homogeneous coordinates from the span's anchor, a
+ *  reciprocal with one Newton step for the divide, a bounds mask, then the
+ *  filter's loads. Out of bounds lanes come back as transparent black.
+ *  Affine spans skip the reciprocal.
+ */
+template <__m256i (*Sample)(const WarpSource&, __m256, __m256, __m256i), bool Projective>
+TARGET_AVX2 static void WarpSpanAVX2Loop(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    // A copy the stores to "out" can't alias, so the samplers' reads of it stay in registers.
+    const WarpSource source = src;
+    const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 minCoord = _mm256_set1_ps(-0.5f);
+    const __m256 maxU = _mm256_set1_ps(src.width - 0.5f);
+    const __m256 maxV = _mm256_set1_ps(src.height - 0.5f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 stepU = _mm256_set1_ps((float)span.stepU);
+    const __m256 stepV = _mm256_set1_ps((float)span.stepV);
+    const __m256 stepW = _mm256_set1_ps((float)span.stepW);
+
+    for (int anchor = 0; anchor < span.count; anchor += WARP_ANCHOR_SPAN)
+    {
+        int end = (anchor + WARP_ANCHOR_SPAN < span.count) ? (anchor + WARP_ANCHOR_SPAN) : span.count;
+        const __m256 anchorU = _mm256_set1_ps((float)(span.u + span.stepU * anchor));
+        const __m256 anchorV = _mm256_set1_ps((float)(span.v + span.stepV * anchor));
+        const __m256 anchorW = _mm256_set1_ps((float)(span.w + span.stepW * anchor));
+
+        for (int i = anchor; i < end; i += 8)
+        {
+            __m256 offset = _mm256_add_ps(_mm256_set1_ps((float)(i - anchor)), lane);
+            __m256 u = _mm256_fmadd_ps(stepU, offset, anchorU);
+            __m256 v = _mm256_fmadd_ps(stepV, offset, anchorV);
+            if (Projective)
+            {
+                // r = rcp(w) * (2 - w * rcp(w)) gets the approximation to ~23 bits.
+                __m256 w = _mm256_fmadd_ps(stepW, offset, anchorW);
+                __m256 r = _mm256_rcp_ps(w);
+                r = _mm256_mul_ps(r, _mm256_fnmadd_ps(w, r, two));
+                u = _mm256_mul_ps(u, r);
+                v = _mm256_mul_ps(v, r);
+            }
+
+            // Ordered compares, so NaN lanes (w = 0) are rejected too.
+            __m256 inside = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(u, minCoord, _CMP_GT_OQ), _mm256_cmp_ps(v, minCoord, _CMP_GT_OQ)),
+                _mm256_and_ps(_mm256_cmp_ps(u, maxU, _CMP_LT_OQ), _mm256_cmp_ps(v, maxV, _CMP_LT_OQ)));
+
+            int remaining = end - i;
+            __m256i store = _mm256_castps_si256(_mm256_cmp_ps(lane, _mm256_set1_ps((float)remaining), _CMP_LT_OQ));
+            __m256i mask = _mm256_and_si256(_mm256_castps_si256(inside), store);
+
+            // Filters may produce something for masked lanes, so clear those explicitly.
+            __m256i pixels = _mm256_and_si256(Sample(source, u, v, mask), mask);
+
+            if (remaining >= 8)
+                _mm256_storeu_si256((__m256i*)(out + i), pixels);
+            else
+                _mm256_maskstore_epi32((int*)(out + i), store, pixels);
+        }
+    }
+}
+
+template <__m256i (*Sample)(const WarpSource&, __m256, __m256, __m256i)>
+TARGET_AVX2 static void WarpSpanAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (span.IsAffine())
+        WarpSpanAVX2Loop<Sample, false>(src, span, out);
+    else
+        WarpSpanAVX2Loop<Sample, true>(src, span, out);
+}
+
+TARGET_AVX2 void WarpSpanNearestAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanAVX2<SampleNearest8<false>>(src, span, out);
+}
+
+TARGET_AVX2 void WarpSpanBilinearAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 2 || src.height < 2)
+        WarpSpanBilinearScalar(src, span, out);
+    else
+        WarpSpanAVX2<SampleBilinear8<false>>(src, span, out);
+}
+
+TARGET_AVX2 void WarpSpanBicubicAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 4 || src.height < 4)
+        WarpSpanBicubicScalar(src, span, out);
+    else
+        WarpSpanAVX2<SampleBicubic8<false>>(src, span, out);
+}
+
+TARGET_AVX2 void WarpSpanNearestTiledAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanAVX2<SampleNearest8<true>>(src, span, out);
+}
+
+TARGET_AVX2 void WarpSpanBilinearTiledAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 2 || src.height < 2)
+        WarpSpanBilinearTiledScalar(src, span, out);
+    else
+        WarpSpanAVX2<SampleBilinear8<true>>(src, span, out);
+}
+
+TARGET_AVX2 void WarpSpanBicubicTiledAVX2(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 4 || src.height < 4)
+        WarpSpanBicubicTiledScalar(src, span, out);
+    else
+        WarpSpanAVX2<SampleBicubic8<true>>(src, span, out);
+}
+
+
+/*
+ *  Averages 8 source pixels of "top" and "bottom" down to 4 pixels, as 16-bit sums.
+ *  Splitting even and odd columns first lines up every pair that gets summed.
+ */
+TARGET_AVX2 static FORCE_INLINE __m256i DownsampleSums4(const PixelRGBA* top, const PixelRGBA* bottom)
+{
+    const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    __m256i topPixels = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)top), deinterleave);
+    __m256i bottomPixels = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)bottom), deinterleave);
+
+    __m256i sum = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(topPixels)),
+        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(topPixels, 1)));
+    sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bottomPixels)));
+    sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bottomPixels, 1)));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+}
+
+TARGET_AVX2 void MipDownsampleAVX2(const PixelRGBA* top, const PixelRGBA* bottom, int srcWidth, PixelRGBA* out)
+{
+    // 16 source pixels in, 8 out; the odd column and anything left over go to the scalar version.
+    int x = 0;
+    for (; 2 * x + 16 <= srcWidth; x += 8)
+    {
+        __m256i low = DownsampleSums4(top + 2 * x, bottom + 2 * x);
+        __m256i high = DownsampleSums4(top + 2 * x + 8, bottom + 2 * x + 8);
+
+        // packus interleaves the two halves per 128-bit lane; permute puts them back in order.
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+        _mm256_storeu_si256((__m256i*)(out + x), packed);
+    }
+    if (2 * x < srcWidth)
+        MipDownsampleScalar(top + 2 * x, bottom + 2 * x, srcWidth - 2 * x, out + x);
+}
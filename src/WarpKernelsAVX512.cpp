@@ -0,0 +1,312 @@
+#include "WarpKernels.h"
+#include "WarpSampling.h"
+
+#include <immintrin.h>
+
+/*
+ *	Same approach as the AVX2 kernels, 16 pixels at a time. Opmask registers
+ *	handle both the bounds test and the partial store at the end of a span.
+ *	Samplers take 16 source positions and the mask of lanes inside the source,
+ *	and return the filtered pixels with the other lanes cleared.
+ */
+
+/*
+ *	Offsets of source rows "y" and columns "x"; a pixel's index is the sum of the
+ *	two. The tiled versions are TiledRowOffset and TiledColumnOffset.
+ */
+template <bool Tiled>
+TARGET_AVX512 static FORCE_INLINE __m512i RowOffset16(__m512i y, __m512i stride)
+{
+    if (!Tiled)
+        return _mm512_mullo_epi32(y, stride);
+    const __m512i low = _mm512_set1_epi32(WARP_SOURCE_TILE - 1);
+    return _mm512_add_epi32(_mm512_mullo_epi32(_mm512_srli_epi32(y, WARP_SOURCE_TILE_SHIFT), stride),
+        _mm512_slli_epi32(_mm512_and_si512(y, low), WARP_SOURCE_TILE_SHIFT));
+}
+
+template <bool Tiled>
+TARGET_AVX512 static FORCE_INLINE __m512i ColumnOffset16(__m512i x)
+{
+    if (!Tiled)
+        return x;
+    const __m512i low = _mm512_set1_epi32(WARP_SOURCE_TILE - 1);
+    return _mm512_add_epi32(_mm512_slli_epi32(_mm512_srli_epi32(x, WARP_SOURCE_TILE_SHIFT), 2 * WARP_SOURCE_TILE_SHIFT),
+        _mm512_and_si512(x, low));
+}
+
+template <bool Tiled>
+TARGET_AVX512 static FORCE_INLINE __m512i SampleNearest16(const WarpSource& src, __m512 u, __m512 v, __mmask16 inside)
+{
+    const __m512 half = _mm512_set1_ps(0.5f);
+    __m512i ui = _mm512_cvttps_epi32(_mm512_add_ps(u, half));
+    __m512i vi = _mm512_cvttps_epi32(_mm512_add_ps(v, half));
+    __m512i index = _mm512_add_epi32(RowOffset16<Tiled>(vi, _mm512_set1_epi32(src.stride)), ColumnOffset16<Tiled>(ui));
+    return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), inside, index, (const int*)src.pixels, 4);
+}
+
+/*
+ *	Same as the AVX2 versions (see LerpChannels and BilinearTap8 in
+ *	WarpKernelsAVX2.cpp).
+ */
+TARGET_AVX512 static FORCE_INLINE __m512i LerpChannels16(__m512i a, __m512i b, __m512i negWeight)
+{
+    return _mm512_add_epi16(a, _mm512_mulhrs_epi16(_mm512_sub_epi16(a, b), negWeight));
+}
+
+TARGET_AVX512 static FORCE_INLINE void LerpRow16(__m512i left, __m512i right, __m512i negWeight, __m512i& redBlue, __m512i& greenAlpha)
+{
+    const __m512i evenBytes = _mm512_set1_epi32(0x00FF00FF);
+    redBlue = LerpChannels16(_mm512_and_si512(left, evenBytes), _mm512_and_si512(right, evenBytes), negWeight);
+    greenAlpha = LerpChannels16(_mm512_srli_epi16(left, 8), _mm512_srli_epi16(right, 8), negWeight);
+}
+
+TARGET_AVX512 static FORCE_INLINE __m512i BilinearTap16(__m512 u, int size, __m512i& negWeight)
+{
+    __m512i fixed = _mm512_cvtps_epi32(_mm512_mul_ps(u, _mm512_set1_ps(256.0f)));
+    fixed = _mm512_min_epi32(_mm512_max_epi32(fixed, _mm512_setzero_si512()), _mm512_set1_epi32((size - 1) * 256));
+    __m512i x = _mm512_min_epi32(_mm512_srai_epi32(fixed, 8), _mm512_set1_epi32(size - 2));
+
+    const __m512i bothHalves = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13));
+    negWeight = _mm512_sub_epi32(_mm512_slli_epi32(x, 15), _mm512_slli_epi32(fixed, 7));
+    negWeight = _mm512_shuffle_epi8(negWeight, bothHalves);
+    return x;
+}
+
+/*
+ *	The pixels at "index" and index + 1, gathered as 8-byte pairs and split
+ *	into the left and right pixel of every lane.
+ */
+TARGET_AVX512 static FORCE_INLINE void LoadRowTaps16(const PixelRGBA* pixels, __m512i index, __m512i& left, __m512i& right)
+{
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    __m512i low = _mm512_i32gather_epi64(_mm512_castsi512_si256(index), (const long long*)pixels, 4);
+    __m512i high = _mm512_i32gather_epi64(_mm512_extracti64x4_epi64(index, 1), (const long long*)pixels, 4);
+    left = _mm512_permutex2var_epi32(low, even, high);
+    right = _mm512_permutex2var_epi32(low, odd, high);
+}
+
+/*
+ *	Same as SampleBilinear8, with a pair gather per row rather than a load per
+ *	lane. Needs an image at least 2x2.
+ */
+TARGET_AVX512 static FORCE_INLINE __m512i SampleBilinear16(const WarpSource& src, __m512 u, __m512 v, __mmask16 inside)
+{
+    __m512i weightX, weightY;
+    __m512i x = BilinearTap16(u, src.width, weightX);
+    __m512i y = BilinearTap16(v, src.height, weightY);
+    __m512i stride = _mm512_set1_epi32(src.stride);
+    __m512i top = _mm512_add_epi32(_mm512_mullo_epi32(y, stride), x);
+
+    __m512i left, right, topRedBlue, topGreenAlpha, bottomRedBlue, bottomGreenAlpha;
+    LoadRowTaps16(src.pixels, top, left, right);
+    LerpRow16(left, right, weightX, topRedBlue, topGreenAlpha);
+    LoadRowTaps16(src.pixels, _mm512_add_epi32(top, stride), left, right);
+    LerpRow16(left, right, weightX, bottomRedBlue, bottomGreenAlpha);
+
+    __m512i redBlue = LerpChannels16(topRedBlue, bottomRedBlue, weightY);
+    __m512i greenAlpha = LerpChannels16(topGreenAlpha, bottomGreenAlpha, weightY);
+    return _mm512_maskz_or_epi32(inside, redBlue, _mm512_slli_epi16(greenAlpha, 8));
+}
+
+/*
+ *	The SSE4.1 BicubicRow and BicubicColumn for four pixels at once, one per
+ *	128-bit lane.
+ */
+TARGET_AVX512 static FORCE_INLINE __m512i BicubicRow4(__m512i row, __m512i weights01, __m512i weights23)
+{
+    const __m512i pairs01 = _mm512_broadcast_i32x4(_mm_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1));
+    const __m512i pairs23 = _mm512_broadcast_i32x4(_mm_setr_epi8(8, -1, 12, -1, 9, -1, 13, -1, 10, -1, 14, -1, 11, -1, 15, -1));
+    return _mm512_add_epi32(_mm512_madd_epi16(_mm512_shuffle_epi8(row, pairs01), weights01),
+        _mm512_madd_epi16(_mm512_shuffle_epi8(row, pairs23), weights23));
+}
+
+TARGET_AVX512 static FORCE_INLINE __m512i BicubicColumn4(const __m512i rows[4], __m512i weights01, __m512i weights23)
+{
+    const __mmask32 high = 0xAAAAAAAA;
+    __m512i pair01 = _mm512_mask_blend_epi16(high, _mm512_srli_epi32(rows[0], BICUBIC_ROW_SHIFT), _mm512_slli_epi32(rows[1], 16 - BICUBIC_ROW_SHIFT));
+    __m512i pair23 = _mm512_mask_blend_epi16(high, _mm512_srli_epi32(rows[2], BICUBIC_ROW_SHIFT), _mm512_slli_epi32(rows[3], 16 - BICUBIC_ROW_SHIFT));
+    __m512i sum = _mm512_add_epi32(_mm512_madd_epi16(pair01, weights01), _mm512_madd_epi16(pair23, weights23));
+    sum = _mm512_add_epi32(sum, _mm512_set1_epi32(1 << (BICUBIC_FINAL_SHIFT - 1)));
+    return _mm512_srai_epi32(sum, BICUBIC_FINAL_SHIFT);
+}
+
+/*
+ *	16 bytes from each of four addresses, one per 128-bit lane. Masked
+ *	broadcasts rather than inserts, so the shuffle port isn't the only one
+ *	that can take them.
+ */
+TARGET_AVX512 static FORCE_INLINE __m512i LoadLanes4(const PixelRGBA* p0, const PixelRGBA* p1, const PixelRGBA* p2, const PixelRGBA* p3)
+{
+    __m512i lanes = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)p0));
+    lanes = _mm512_mask_broadcast_i32x4(lanes, 0x00F0, _mm_loadu_si128((const __m128i*)p1));
+    lanes = _mm512_mask_broadcast_i32x4(lanes, 0x0F00, _mm_loadu_si128((const __m128i*)p2));
+    return _mm512_mask_broadcast_i32x4(lanes, 0xF000, _mm_loadu_si128((const __m128i*)p3));
+}
+
+/*
+ *	Fixed point Catmull-Rom matching SampleBicubic, like SampleBicubic8 in
+ *	WarpKernelsAVX2.cpp. Pixels go through four at a time, one per 128-bit
+ *	lane, with each group's horizontal and vertical weights fetched by one
+ *	gather. Needs an image at least 4x4.
+ */
+TARGET_AVX512 static FORCE_INLINE __m512i SampleBicubic16(const WarpSource& src, __m512 u, __m512 v, __mmask16 inside)
+{
+    const __m512 scale = _mm512_set1_ps(256.0f);
+    const __m512i fraction = _mm512_set1_epi32(255);
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i maxX = _mm512_set1_epi32(src.width - 3);
+    const __m512i maxY = _mm512_set1_epi32(src.height - 3);
+    const int stride = src.stride;
+
+    __m512i fixedU = _mm512_cvtps_epi32(_mm512_mul_ps(u, scale));
+    __m512i fixedV = _mm512_cvtps_epi32(_mm512_mul_ps(v, scale));
+    __m512i x = _mm512_srai_epi32(fixedU, 8), y = _mm512_srai_epi32(fixedV, 8);
+    __m512i fracX = _mm512_and_si512(fixedU, fraction), fracY = _mm512_and_si512(fixedV, fraction);
+
+    // Lanes with every tap inside; the rest load from a clamped position instead.
+    __mmask16 fast = _mm512_mask_cmpge_epi32_mask(inside, x, one);
+    fast = _mm512_mask_cmpge_epi32_mask(fast, y, one);
+    fast = _mm512_mask_cmple_epi32_mask(fast, x, maxX);
+    fast = _mm512_mask_cmple_epi32_mask(fast, y, maxY);
+    x = _mm512_min_epi32(_mm512_max_epi32(x, one), maxX);
+    y = _mm512_min_epi32(_mm512_max_epi32(y, one), maxY);
+
+    // Where each lane's first row of taps starts.
+    alignas(64) int taps[16];
+    _mm512_store_si512(taps, _mm512_add_epi32(_mm512_mullo_epi32(y, _mm512_set1_epi32(stride)),
+        _mm512_add_epi32(x, _mm512_set1_epi32(-stride - 1))));
+
+    // Table indices of the four groups, (fracX, fracY) per pixel, so a 64-bit
+    // gather of 8-byte entries puts the pixel's x taps and then its y taps in
+    // its 128-bit lane.
+    const __m512i xy0 = _mm512_unpacklo_epi32(fracX, fracY), xy1 = _mm512_unpackhi_epi32(fracX, fracY);
+    const __m512i groups01 = _mm512_permutex2var_epi64(xy0, _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11), xy1);
+    const __m512i groups23 = _mm512_permutex2var_epi64(xy0, _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15), xy1);
+    const __m256i tables[4] = { _mm512_castsi512_si256(groups01), _mm512_extracti64x4_epi64(groups01, 1),
+        _mm512_castsi512_si256(groups23), _mm512_extracti64x4_epi64(groups23, 1) };
+
+    const long long* table = (const long long*)catmullRomTable.taps;
+    __m512i result[4];
+    for (int g = 0; g < 4; g++)
+    {
+        const __m512i weights = _mm512_i32gather_epi64(tables[g], table, sizeof(CatmullRomTaps));
+        const __m512i x01 = _mm512_shuffle_epi32(weights, _MM_PERM_AAAA), x23 = _mm512_shuffle_epi32(weights, _MM_PERM_BBBB);
+        const PixelRGBA* p0 = src.pixels + taps[4 * g];
+        const PixelRGBA* p1 = src.pixels + taps[4 * g + 1];
+        const PixelRGBA* p2 = src.pixels + taps[4 * g + 2];
+        const PixelRGBA* p3 = src.pixels + taps[4 * g + 3];
+
+        __m512i sums[4];
+        for (int j = 0; j < 4; j++)
+            sums[j] = BicubicRow4(LoadLanes4(p0 + j * stride, p1 + j * stride, p2 + j * stride, p3 + j * stride), x01, x23);
+        result[g] = BicubicColumn4(sums, _mm512_shuffle_epi32(weights, _MM_PERM_CCCC), _mm512_shuffle_epi32(weights, _MM_PERM_DDDD));
+    }
+
+    // Lane k holds pixels k, 4 + k, 8 + k and 12 + k after packing; the permute puts them in order.
+    const __m512i order = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    __m512i pixels = _mm512_packus_epi16(_mm512_packs_epi32(result[0], result[1]), _mm512_packs_epi32(result[2], result[3]));
+    pixels = _mm512_maskz_permutexvar_epi32(inside, order, pixels);
+
+    // Lanes inside but too near the edge for the loads above.
+    const __mmask16 slow = inside & ~fast;
+    if (slow)
+    {
+        alignas(64) float laneU[16], laneV[16];
+        alignas(64) PixelRGBA lanePixels[16];
+        _mm512_store_ps(laneU, u);
+        _mm512_store_ps(laneV, v);
+        _mm512_store_si512(lanePixels, pixels);
+        for (int l = 0; l < 16; l++)
+            if (slow & (1 << l))
+                lanePixels[l] = SampleBicubic<false>(src, laneU[l], laneV[l]);
+        pixels = _mm512_load_si512(lanePixels);
+    }
+    return pixels;
+}
+
+/*
+ *	16 pixels per iteration, laid out like WarpSpanAVX2Loop. rcp14 plus one
+ *	Newton step is accurate to well under a pixel.
+ */
+template <__m512i (*Sample)(const WarpSource&, __m512, __m512, __mmask16), bool Projective>
+TARGET_AVX512 static void WarpSpanAVX512Loop(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    // A copy the stores to "out" can't alias, as in WarpSpanAVX2Loop.
+    const WarpSource source = src;
+    const __m512 lane = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512 minCoord = _mm512_set1_ps(-0.5f);
+    const __m512 maxU = _mm512_set1_ps(src.width - 0.5f);
+    const __m512 maxV = _mm512_set1_ps(src.height - 0.5f);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 stepU = _mm512_set1_ps((float)span.stepU);
+    const __m512 stepV = _mm512_set1_ps((float)span.stepV);
+    const __m512 stepW = _mm512_set1_ps((float)span.stepW);
+
+    for (int anchor = 0; anchor < span.count; anchor += WARP_ANCHOR_SPAN)
+    {
+        int end = (anchor + WARP_ANCHOR_SPAN < span.count) ? (anchor + WARP_ANCHOR_SPAN) : span.count;
+        const __m512 anchorU = _mm512_set1_ps((float)(span.u + span.stepU * anchor));
+        const __m512 anchorV = _mm512_set1_ps((float)(span.v + span.stepV * anchor));
+        const __m512 anchorW = _mm512_set1_ps((float)(span.w + span.stepW * anchor));
+
+        for (int i = anchor; i < end; i += 16)
+        {
+            __m512 offset = _mm512_add_ps(_mm512_set1_ps((float)(i - anchor)), lane);
+            __m512 u = _mm512_fmadd_ps(stepU, offset, anchorU);
+            __m512 v = _mm512_fmadd_ps(stepV, offset, anchorV);
+            if (Projective)
+            {
+                __m512 w = _mm512_fmadd_ps(stepW, offset, anchorW);
+                __m512 r = _mm512_rcp14_ps(w);
+                r = _mm512_mul_ps(r, _mm512_fnmadd_ps(w, r, two));
+                u = _mm512_mul_ps(u, r);
+                v = _mm512_mul_ps(v, r);
+            }
+
+            int remaining = end - i;
+            __mmask16 store = (remaining >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << remaining) - 1);
+            __mmask16 inside = _mm512_mask_cmp_ps_mask(store, u, minCoord, _CMP_GT_OQ);
+            inside = _mm512_mask_cmp_ps_mask(inside, v, minCoord, _CMP_GT_OQ);
+            inside = _mm512_mask_cmp_ps_mask(inside, u, maxU, _CMP_LT_OQ);
+            inside = _mm512_mask_cmp_ps_mask(inside, v, maxV, _CMP_LT_OQ);
+
+            _mm512_mask_storeu_epi32(out + i, store, Sample(source, u, v, inside));
+        }
+    }
+}
+
+template <__m512i (*Sample)(const WarpSource&, __m512, __m512, __mmask16)>
+TARGET_AVX512 static void WarpSpanAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (span.IsAffine())
+        WarpSpanAVX512Loop<Sample, false>(src, span, out);
+    else
+        WarpSpanAVX512Loop<Sample, true>(src, span, out);
+}
+
+TARGET_AVX512 void WarpSpanNearestAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanAVX512<SampleNearest16<false>>(src, span, out);
+}
+
+TARGET_AVX512 void WarpSpanBilinearAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 2 || src.height < 2)
+        WarpSpanBilinearScalar(src, span, out);
+    else
+        WarpSpanAVX512<SampleBilinear16>(src, span, out);
+}
+
+TARGET_AVX512 void WarpSpanBicubicAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 4 || src.height < 4)
+        WarpSpanBicubicScalar(src, span, out);
+    else
+        WarpSpanAVX512<SampleBicubic16>(src, span, out);
+}
+
+TARGET_AVX512 void WarpSpanNearestTiledAVX512(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanAVX512<SampleNearest16<true>>(src, span, out);
+}
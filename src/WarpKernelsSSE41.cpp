@@ -0,0 +1,386 @@
+#include "WarpKernels.h"
+#include "WarpSampling.h"
+
+#include <immintrin.h>
+
+/*
+ *	There's no gather before AVX2, so the samplers vectorize the coordinate math
+ *	and the blending, and load their taps a lane at a time. A pixel's taps are
+ *	next to each other in a row, so that's one 8-byte (bilinear) or 16-byte
+ *	(bicubic) load per row rather than one per tap.
+ *
+ *	Samplers take 4 source positions and a mask of the lanes that are inside the
+ *	source, and return the filtered pixels with the other lanes cleared. Indices
+ *	of lanes outside are clamped or masked to somewhere harmless before loading.
+ */
+
+/*
+ *	Offsets of source rows "y" and columns "x"; a pixel's index is the sum of the
+ *	two. The tiled versions are TiledRowOffset and TiledColumnOffset.
+ */
+template <bool Tiled>
+TARGET_SSE41 static FORCE_INLINE __m128i RowOffset4(__m128i y, __m128i stride)
+{
+    if (!Tiled)
+        return _mm_mullo_epi32(y, stride);
+    const __m128i low = _mm_set1_epi32(WARP_SOURCE_TILE - 1);
+    return _mm_add_epi32(_mm_mullo_epi32(_mm_srli_epi32(y, WARP_SOURCE_TILE_SHIFT), stride),
+        _mm_slli_epi32(_mm_and_si128(y, low), WARP_SOURCE_TILE_SHIFT));
+}
+
+template <bool Tiled>
+TARGET_SSE41 static FORCE_INLINE __m128i ColumnOffset4(__m128i x)
+{
+    if (!Tiled)
+        return x;
+    const __m128i low = _mm_set1_epi32(WARP_SOURCE_TILE - 1);
+    return _mm_add_epi32(_mm_slli_epi32(_mm_srli_epi32(x, WARP_SOURCE_TILE_SHIFT), 2 * WARP_SOURCE_TILE_SHIFT),
+        _mm_and_si128(x, low));
+}
+
+template <bool Tiled>
+TARGET_SSE41 static FORCE_INLINE __m128i SampleNearest4(const WarpSource& src, __m128 u, __m128 v, __m128i inside)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i ui = _mm_cvttps_epi32(_mm_add_ps(u, half));
+    __m128i vi = _mm_cvttps_epi32(_mm_add_ps(v, half));
+    __m128i index = _mm_add_epi32(RowOffset4<Tiled>(vi, _mm_set1_epi32(src.stride)), ColumnOffset4<Tiled>(ui));
+
+    alignas(16) int lanes[4];
+    _mm_store_si128((__m128i*)lanes, _mm_and_si128(index, inside));
+    const int* pixels = (const int*)src.pixels;
+    return _mm_and_si128(_mm_setr_epi32(pixels[lanes[0]], pixels[lanes[1]], pixels[lanes[2]], pixels[lanes[3]]), inside);
+}
+
+/*
+ *	Two 8-byte pixel pairs per register, split into the left and right pixel of
+ *	every lane.
+ */
+TARGET_SSE41 static FORCE_INLINE void LoadPixelPairs(const PixelRGBA* pixels, const int lanes[4], __m128i& left, __m128i& right)
+{
+    __m128 low = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(pixels + lanes[0])));
+    __m128 high = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(pixels + lanes[2])));
+    low = _mm_loadh_pi(low, (const __m64*)(pixels + lanes[1]));
+    high = _mm_loadh_pi(high, (const __m64*)(pixels + lanes[3]));
+    left = _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+    right = _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+/*
+ *	The pixels at columns x and x + 1 of the rows at "row". In the tiled layout
+ *	they're apart when x is the last column of a tile; the right one then comes
+ *	from a second pair load ending on it.
+ */
+template <bool Tiled>
+TARGET_SSE41 static FORCE_INLINE void LoadRowTaps(const PixelRGBA* pixels, __m128i row, __m128i x, __m128i& left, __m128i& right)
+{
+    alignas(16) int lanes[4];
+    _mm_store_si128((__m128i*)lanes, _mm_add_epi32(row, ColumnOffset4<Tiled>(x)));
+    LoadPixelPairs(pixels, lanes, left, right);
+    if (!Tiled)
+        return;
+
+    const __m128i low = _mm_set1_epi32(WARP_SOURCE_TILE - 1);
+    const __m128i crossing = _mm_cmpeq_epi32(_mm_and_si128(x, low), low);
+    __m128i unused, nextRight;
+    _mm_store_si128((__m128i*)lanes, _mm_add_epi32(row,
+        _mm_sub_epi32(ColumnOffset4<true>(_mm_add_epi32(x, _mm_set1_epi32(1))), _mm_set1_epi32(1))));
+    LoadPixelPairs(pixels, lanes, unused, nextRight);
+    right = _mm_blendv_epi8(right, nextRight, crossing);
+}
+
+/*
+ *	Same as the AVX2 versions (see LerpChannels and BilinearTap8 in
+ *	WarpKernelsAVX2.cpp).
+ */
+TARGET_SSE41 static FORCE_INLINE __m128i LerpChannels4(__m128i a, __m128i b, __m128i negWeight)
+{
+    return _mm_add_epi16(a, _mm_mulhrs_epi16(_mm_sub_epi16(a, b), negWeight));
+}
+
+TARGET_SSE41 static FORCE_INLINE void LerpRow4(__m128i left, __m128i right, __m128i negWeight, __m128i& redBlue, __m128i& greenAlpha)
+{
+    const __m128i evenBytes = _mm_set1_epi32(0x00FF00FF);
+    redBlue = LerpChannels4(_mm_and_si128(left, evenBytes), _mm_and_si128(right, evenBytes), negWeight);
+    greenAlpha = LerpChannels4(_mm_srli_epi16(left, 8), _mm_srli_epi16(right, 8), negWeight);
+}
+
+TARGET_SSE41 static FORCE_INLINE __m128i BilinearTap4(__m128 u, int size, __m128i& negWeight)
+{
+    __m128i fixed = _mm_cvtps_epi32(_mm_mul_ps(u, _mm_set1_ps(256.0f)));
+    fixed = _mm_min_epi32(_mm_max_epi32(fixed, _mm_setzero_si128()), _mm_set1_epi32((size - 1) * 256));
+    __m128i x = _mm_min_epi32(_mm_srai_epi32(fixed, 8), _mm_set1_epi32(size - 2));
+
+    const __m128i bothHalves = _mm_setr_epi8(0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13);
+    negWeight = _mm_sub_epi32(_mm_slli_epi32(x, 15), _mm_slli_epi32(fixed, 7));
+    negWeight = _mm_shuffle_epi8(negWeight, bothHalves);
+    return x;
+}
+
+/*
+ *	Same as the AVX2 version (see SampleBilinear8), which also keeps every
+ *	lane's loads inside the image.
+ */
+template <bool Tiled>
+TARGET_SSE41 static FORCE_INLINE __m128i SampleBilinear4(const WarpSource& src, __m128 u, __m128 v, __m128i inside)
+{
+    __m128i weightX, weightY;
+    __m128i x = BilinearTap4(u, src.width, weightX);
+    __m128i y = BilinearTap4(v, src.height, weightY);
+
+    const __m128i stride = _mm_set1_epi32(src.stride);
+    __m128i top = RowOffset4<Tiled>(y, stride);
+    __m128i bottom = RowOffset4<Tiled>(_mm_add_epi32(y, _mm_set1_epi32(1)), stride);
+
+    __m128i left, right, topRedBlue, topGreenAlpha, bottomRedBlue, bottomGreenAlpha;
+    LoadRowTaps<Tiled>(src.pixels, top, x, left, right);
+    LerpRow4(left, right, weightX, topRedBlue, topGreenAlpha);
+    LoadRowTaps<Tiled>(src.pixels, bottom, x, left, right);
+    LerpRow4(left, right, weightX, bottomRedBlue, bottomGreenAlpha);
+
+    __m128i redBlue = LerpChannels4(topRedBlue, bottomRedBlue, weightY);
+    __m128i greenAlpha = LerpChannels4(topGreenAlpha, bottomGreenAlpha, weightY);
+    return _mm_and_si128(_mm_or_si128(redBlue, _mm_slli_epi16(greenAlpha, 8)), inside);
+}
+
+/*
+ *	Which bytes of a row of 4 bicubic taps come from the second load in the tiled
+ *	layout, by the column the taps start at within their tile: from there on the
+ *	taps are in the next tile.
+ */
+alignas(16) static const unsigned char bicubicTileCrossing[WARP_SOURCE_TILE][16] =
+{
+    { 0 }, { 0 }, { 0 }, { 0 }, { 0 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+};
+
+/*
+ *	One row of 4 taps (16 bytes, 4 pixels) blended with 16-bit multiply-adds:
+ *	bytes are paired up by channel, taps 0 and 1 and taps 2 and 3, then each
+ *	pair is multiplied by its two weights and summed, giving a 32-bit sum per
+ *	channel (see catmullRomTable). Shuffle indices with the top bit set give
+ *	zero bytes, so each shuffle also widens its pairs to 16 bits.
+ */
+TARGET_SSE41 static FORCE_INLINE __m128i BicubicRow(__m128i row, __m128i weights01, __m128i weights23)
+{
+    const __m128i pairs01 = _mm_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1);
+    const __m128i pairs23 = _mm_setr_epi8(8, -1, 12, -1, 9, -1, 13, -1, 10, -1, 14, -1, 11, -1, 15, -1);
+    __m128i low = _mm_madd_epi16(_mm_shuffle_epi8(row, pairs01), weights01);
+    __m128i high = _mm_madd_epi16(_mm_shuffle_epi8(row, pairs23), weights23);
+    return _mm_add_epi32(low, high);
+}
+
+/*
+ *	The four row sums blended by the vertical weights, in the same two pairs:
+ *	each sum is dropped by BICUBIC_ROW_SHIFT into one half of a 32-bit lane.
+ */
+TARGET_SSE41 static FORCE_INLINE __m128i BicubicColumn(const __m128i rows[4], __m128i weights01, __m128i weights23)
+{
+    __m128i pair01 = _mm_blend_epi16(_mm_srli_epi32(rows[0], BICUBIC_ROW_SHIFT), _mm_slli_epi32(rows[1], 16 - BICUBIC_ROW_SHIFT), 0xAA);
+    __m128i pair23 = _mm_blend_epi16(_mm_srli_epi32(rows[2], BICUBIC_ROW_SHIFT), _mm_slli_epi32(rows[3], 16 - BICUBIC_ROW_SHIFT), 0xAA);
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(pair01, weights01), _mm_madd_epi16(pair23, weights23));
+    sum = _mm_add_epi32(sum, _mm_set1_epi32(1 << (BICUBIC_FINAL_SHIFT - 1)));
+    return _mm_srai_epi32(sum, BICUBIC_FINAL_SHIFT);
+}
+
+/*
+ *	Fixed point Catmull-Rom matching SampleBicubic. Lanes whose 4x4 taps are all
+ *	inside the source load each row of taps at once; the few with taps off the
+ *	edge (which get clamped) go through SampleBicubic itself. Needs an image at
+ *	least 4x4.
+ */
+template <bool Tiled>
+TARGET_SSE41 static FORCE_INLINE __m128i SampleBicubic4(const WarpSource& src, __m128 u, __m128 v, __m128i inside)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i fraction = _mm_set1_epi32(255);
+    const __m128i maxX = _mm_set1_epi32(src.width - 3);
+    const __m128i maxY = _mm_set1_epi32(src.height - 3);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i stride = _mm_set1_epi32(src.stride);
+
+    // As in BilinearTap4; a fraction rounding up to a whole pixel is the next
+    // tap at fraction 0, which has the same weights.
+    __m128i fixedU = _mm_cvtps_epi32(_mm_mul_ps(u, _mm_set1_ps(256.0f)));
+    __m128i fixedV = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(256.0f)));
+    __m128i x = _mm_srai_epi32(fixedU, 8), y = _mm_srai_epi32(fixedV, 8);
+    __m128i fracX = _mm_and_si128(fixedU, fraction), fracY = _mm_and_si128(fixedV, fraction);
+
+    // Lanes with every tap inside; the rest load from a clamped position instead.
+    __m128i fast = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(x, zero), _mm_cmpgt_epi32(y, zero)),
+        _mm_and_si128(_mm_cmpgt_epi32(_mm_add_epi32(maxX, one), x), _mm_cmpgt_epi32(_mm_add_epi32(maxY, one), y)));
+    fast = _mm_and_si128(fast, inside);
+    x = _mm_min_epi32(_mm_max_epi32(x, one), maxX);
+    y = _mm_min_epi32(_mm_max_epi32(y, one), maxY);
+
+    // Where each lane's row of taps starts, for every row; in the tiled layout
+    // also where taps 1-3 are if they're in the next tile (see bicubicTileCrossing).
+    alignas(16) int taps[4][4], tapsNext[4][4], tableX[4], tableY[4], tileColumn[4];
+    __m128i left = _mm_sub_epi32(x, one);
+    const __m128i first = ColumnOffset4<Tiled>(left);
+    const __m128i second = _mm_sub_epi32(ColumnOffset4<Tiled>(_mm_add_epi32(x, _mm_set1_epi32(2))), _mm_set1_epi32(3));
+    for (int j = 0; j < 4; j++)
+    {
+        const __m128i row = RowOffset4<Tiled>(_mm_add_epi32(y, _mm_set1_epi32(j - 1)), stride);
+        _mm_store_si128((__m128i*)taps[j], _mm_add_epi32(row, first));
+        if (Tiled)
+            _mm_store_si128((__m128i*)tapsNext[j], _mm_add_epi32(row, second));
+    }
+    if (Tiled)
+        _mm_store_si128((__m128i*)tileColumn, _mm_and_si128(left, _mm_set1_epi32(WARP_SOURCE_TILE - 1)));
+    _mm_store_si128((__m128i*)tableX, fracX);
+    _mm_store_si128((__m128i*)tableY, fracY);
+
+    const CatmullRomTaps* table = catmullRomTable.taps;
+    __m128i result[4];
+    for (int l = 0; l < 4; l++)
+    {
+        const __m128i tapsX = _mm_loadl_epi64((const __m128i*)&table[tableX[l]]);
+        const __m128i tapsY = _mm_loadl_epi64((const __m128i*)&table[tableY[l]]);
+        const __m128i x01 = _mm_shuffle_epi32(tapsX, 0x00), x23 = _mm_shuffle_epi32(tapsX, 0x55);
+
+        __m128i sums[4];
+        for (int j = 0; j < 4; j++)
+        {
+            __m128i row = _mm_loadu_si128((const __m128i*)(src.pixels + taps[j][l]));
+            if (Tiled)
+            {
+                const __m128i next = _mm_loadu_si128((const __m128i*)(src.pixels + tapsNext[j][l]));
+                row = _mm_blendv_epi8(row, next, _mm_load_si128((const __m128i*)bicubicTileCrossing[tileColumn[l]]));
+            }
+            sums[j] = BicubicRow(row, x01, x23);
+        }
+        result[l] = BicubicColumn(sums, _mm_shuffle_epi32(tapsY, 0x00), _mm_shuffle_epi32(tapsY, 0x55));
+    }
+    __m128i pixels = _mm_packus_epi16(_mm_packs_epi32(result[0], result[1]), _mm_packs_epi32(result[2], result[3]));
+
+    // Lanes inside but too near the edge for the loads above.
+    const int slow = _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(fast, inside)));
+    if (slow)
+    {
+        alignas(16) float laneU[4], laneV[4];
+        alignas(16) PixelRGBA lanePixels[4];
+        _mm_store_ps(laneU, u);
+        _mm_store_ps(laneV, v);
+        _mm_store_si128((__m128i*)lanePixels, pixels);
+        for (int l = 0; l < 4; l++)
+            if (slow & (1 << l))
+                lanePixels[l] = SampleBicubic<Tiled>(src, laneU[l], laneV[l]);
+        pixels = _mm_load_si128((const __m128i*)lanePixels);
+    }
+    return _mm_and_si128(pixels, inside);
+}
+
+/*
+ *	4 pixels per iteration, laid out like the AVX2 loop (see WarpSpanAVX2Loop):
+ *	coordinates from the span's anchor, a reciprocal with one Newton step for
+ *	the divide, a bounds mask, then the sampler.
+ */
+template <__m128i (*Sample)(const WarpSource&, __m128, __m128, __m128i), bool Projective>
+TARGET_SSE41 static void WarpSpanSSE41Loop(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    // A copy the stores to "out" can't alias, as in WarpSpanAVX2Loop.
+    const WarpSource source = src;
+    const __m128 lane = _mm_setr_ps(0, 1, 2, 3);
+    const __m128 minCoord = _mm_set1_ps(-0.5f);
+    const __m128 maxU = _mm_set1_ps(src.width - 0.5f);
+    const __m128 maxV = _mm_set1_ps(src.height - 0.5f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 stepU = _mm_set1_ps((float)span.stepU);
+    const __m128 stepV = _mm_set1_ps((float)span.stepV);
+    const __m128 stepW = _mm_set1_ps((float)span.stepW);
+
+    for (int anchor = 0; anchor < span.count; anchor += WARP_ANCHOR_SPAN)
+    {
+        int end = (anchor + WARP_ANCHOR_SPAN < span.count) ? (anchor + WARP_ANCHOR_SPAN) : span.count;
+        const __m128 anchorU = _mm_set1_ps((float)(span.u + span.stepU * anchor));
+        const __m128 anchorV = _mm_set1_ps((float)(span.v + span.stepV * anchor));
+        const __m128 anchorW = _mm_set1_ps((float)(span.w + span.stepW * anchor));
+
+        for (int i = anchor; i < end; i += 4)
+        {
+            __m128 offset = _mm_add_ps(_mm_set1_ps((float)(i - anchor)), lane);
+            __m128 u = _mm_add_ps(_mm_mul_ps(stepU, offset), anchorU);
+            __m128 v = _mm_add_ps(_mm_mul_ps(stepV, offset), anchorV);
+            if (Projective)
+            {
+                __m128 w = _mm_add_ps(_mm_mul_ps(stepW, offset), anchorW);
+                __m128 r = _mm_rcp_ps(w);
+                r = _mm_mul_ps(r, _mm_sub_ps(two, _mm_mul_ps(w, r)));
+                u = _mm_mul_ps(u, r);
+                v = _mm_mul_ps(v, r);
+            }
+
+            // Ordered compares, so NaN lanes (w = 0) are rejected too.
+            int remaining = end - i;
+            __m128 store = _mm_cmplt_ps(lane, _mm_set1_ps((float)remaining));
+            __m128 inside = _mm_and_ps(
+                _mm_and_ps(_mm_cmpgt_ps(u, minCoord), _mm_cmpgt_ps(v, minCoord)),
+                _mm_and_ps(_mm_cmplt_ps(u, maxU), _mm_cmplt_ps(v, maxV)));
+            __m128i pixels = Sample(source, u, v, _mm_castps_si128(_mm_and_ps(inside, store)));
+
+            if (remaining >= 4)
+                _mm_storeu_si128((__m128i*)(out + i), pixels);
+            else
+            {
+                alignas(16) PixelRGBA lanes[4];
+                _mm_store_si128((__m128i*)lanes, pixels);
+                for (int l = 0; l < remaining; l++)
+                    out[i + l] = lanes[l];
+            }
+        }
+    }
+}
+
+template <__m128i (*Sample)(const WarpSource&, __m128, __m128, __m128i)>
+TARGET_SSE41 static void WarpSpanSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (span.IsAffine())
+        WarpSpanSSE41Loop<Sample, false>(src, span, out);
+    else
+        WarpSpanSSE41Loop<Sample, true>(src, span, out);
+}
+
+TARGET_SSE41 void WarpSpanNearestSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanSSE41<SampleNearest4<false>>(src, span, out);
+}
+
+TARGET_SSE41 void WarpSpanBilinearSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 2 || src.height < 2)
+        WarpSpanBilinearScalar(src, span, out);
+    else
+        WarpSpanSSE41<SampleBilinear4<false>>(src, span, out);
+}
+
+TARGET_SSE41 void WarpSpanBicubicSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 4 || src.height < 4)
+        WarpSpanBicubicScalar(src, span, out);
+    else
+        WarpSpanSSE41<SampleBicubic4<false>>(src, span, out);
+}
+
+TARGET_SSE41 void WarpSpanNearestTiledSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    WarpSpanSSE41<SampleNearest4<true>>(src, span, out);
+}
+
+TARGET_SSE41 void WarpSpanBilinearTiledSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 2 || src.height < 2)
+        WarpSpanBilinearTiledScalar(src, span, out);
+    else
+        WarpSpanSSE41<SampleBilinear4<true>>(src, span, out);
+}
+
+TARGET_SSE41 void WarpSpanBicubicTiledSSE41(const WarpSource& src, const WarpSpan& span, PixelRGBA* out)
+{
+    if (src.width < 4 || src.height < 4)
+        WarpSpanBicubicTiledScalar(src, span, out);
+    else
+        WarpSpanSSE41<SampleBicubic4<true>>(src, span, out);
+}
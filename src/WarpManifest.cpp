@@ -0,0 +1,458 @@
+#include "WarpManifest.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static std::string LineError(int line, const std::string& message)
+{
+    return "Line " + std::to_string(line) + ": " + message;
+}
+
+static bool ParseNumber(const std::string& text, double& value)
+{
+    const char* start = text.c_str();
+    char* end = nullptr;
+    value = strtod(start, &end);
+    // strtod also takes "nan" and "inf", which no corner can be.
+    return end != start && *end == '\0' && std::isfinite(value);
+}
+
+/*
+ *  CSV
+ */
+
+static std::string Trim(const std::string& text)
+{
+    size_t first = 0, last = text.size();
+    while (first < last && isspace((unsigned char)text[first])) first++;
+    while (last > first && isspace((unsigned char)text[last - 1])) last--;
+    return text.substr(first, last - first);
+}
+
+// Splits one CSV line into trimmed fields, honoring double quotes.
+static bool SplitCsvLine(const std::string& line, std::vector<std::string>& fields)
+{
+    fields.clear();
+    std::string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++)
+    {
+        char c = line[i];
+        if (quoted)
+        {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+                field += line[++i];
+            else if (c == '"')
+                quoted = false;
+            else
+                field += c;
+        }
+        else if (c == '"')
+            quoted = true;
+        else if (c == ',')
+        {
+            fields.push_back(Trim(field));
+            field.clear();
+        }
+        else
+            field += c;
+    }
+    fields.push_back(Trim(field));
+    return !quoted;
+}
+
+static bool ReadCsvManifest(std::istream& in, WarpFilter defaultFilter, std::vector<WarpJob>& jobs, std::string& error)
+{
+    std::string line;
+    std::vector<std::string> fields;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++)
+    {
+        std::string trimmed = Trim(line);
+        if (trimmed.empty() || trimmed[0] == '#')
+            continue;
+
+        if (!SplitCsvLine(trimmed, fields))
+        {
+            error = LineError(lineNumber, "unterminated quote");
+            return false;
+        }
+
+        // Optional header row.
+        if (jobs.empty() && fields[0] == "input")
+            continue;
+
+        if (fields.size() != 10 && fields.size() != 11)
+        {
+            error = LineError(lineNumber, "expected input, 8 corner coordinates, output and an optional filter");
+            return false;
+        }
+
+        WarpJob job;
+        job.input = fields[0];
+        job.output = fields[9];
+        job.filter = defaultFilter;
+        job.sourceLine = lineNumber;
+        for (int i = 0; i < 4; i++)
+        {
+            if (!ParseNumber(fields[1 + 2 * i], job.corners[i].x) || !ParseNumber(fields[2 + 2 * i], job.corners[i].y))
+            {
+                error = LineError(lineNumber, "corner " + std::to_string(i) + " isn't a number");
+                return false;
+            }
+        }
+        if (fields.size() == 11 && !fields[10].empty() && !ParseWarpFilter(fields[10].c_str(), job.filter))
+        {
+            error = LineError(lineNumber, "unknown filter \"" + fields[10] + "\"");
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+/*
+ *  JSON. Just enough of a reader for manifests: values are parsed into a small
+ *  tree, then jobs are picked out of it, so unknown keys are simply ignored.
+ */
+
+struct JsonValue
+{
+    enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+    int line = 0;
+
+    const JsonValue* Find(const char* key) const
+    {
+        for (const auto& member : members)
+            if (member.first == key) return &member.second;
+        return nullptr;
+    }
+};
+
+class JsonReader
+{
+public:
+
+    JsonReader(const std::string& text) : text(text) {}
+
+    bool ReadDocument(JsonValue& value, std::string& error)
+    {
+        if (!ReadValue(value, 0))
+        {
+            error = LineError(line, message);
+            return false;
+        }
+        SkipSpace();
+        if (pos != text.size())
+        {
+            error = LineError(line, "unexpected text after the manifest");
+            return false;
+        }
+        return true;
+    }
+
+private:
+
+    // Deep enough for any manifest, shallow enough to never blow the stack.
+    static const int MAX_DEPTH = 64;
+
+    const std::string& text;
+    size_t pos = 0;
+    int line = 1;
+    std::string message;
+
+    bool Fail(const std::string& why)
+    {
+        message = why;
+        return false;
+    }
+
+    void SkipSpace()
+    {
+        while (pos < text.size() && isspace((unsigned char)text[pos]))
+        {
+            if (text[pos] == '\n') line++;
+            pos++;
+        }
+    }
+
+    bool Match(const char* word)
+    {
+        size_t length = strlen(word);
+        if (text.compare(pos, length, word) != 0) return false;
+        pos += length;
+        return true;
+    }
+
+    bool ReadValue(JsonValue& value, int depth)
+    {
+        if (depth > MAX_DEPTH) return Fail("nested too deeply");
+
+        SkipSpace();
+        value.line = line;
+        if (pos >= text.size()) return Fail("unexpected end of file");
+
+        char c = text[pos];
+        if (c == '{') return ReadObject(value, depth);
+        if (c == '[') return ReadArray(value, depth);
+        if (c == '"')
+        {
+            value.type = JsonValue::String;
+            return ReadString(value.string);
+        }
+        if (Match("true"))  { value.type = JsonValue::Bool; value.number = 1.0; return true; }
+        if (Match("false")) { value.type = JsonValue::Bool; value.number = 0.0; return true; }
+        if (Match("null"))  { value.type = JsonValue::Null; return true; }
+
+        const char* start = text.c_str() + pos;
+        char* end = nullptr;
+        value.number = strtod(start, &end);
+        if (end == start) return Fail("unexpected character '" + std::string(1, c) + "'");
+        value.type = JsonValue::Number;
+        pos += end - start;
+        return true;
+    }
+
+    bool ReadObject(JsonValue& value, int depth)
+    {
+        value.type = JsonValue::Object;
+        pos++;
+        SkipSpace();
+        if (pos < text.size() && text[pos] == '}') { pos++; return true; }
+
+        while (true)
+        {
+            SkipSpace();
+            std::pair<std::string, JsonValue> member;
+            if (pos >= text.size() || text[pos] != '"') return Fail("expected a key");
+            if (!ReadString(member.first)) return false;
+
+            SkipSpace();
+            if (pos >= text.size() || text[pos] != ':') return Fail("expected ':' after \"" + member.first + "\"");
+            pos++;
+            if (!ReadValue(member.second, depth + 1)) return false;
+            value.members.push_back(std::move(member));
+
+            SkipSpace();
+            if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+            if (pos < text.size() && text[pos] == '}') { pos++; return true; }
+            return Fail("expected ',' or '}'");
+        }
+    }
+
+    bool ReadArray(JsonValue& value, int depth)
+    {
+        value.type = JsonValue::Array;
+        pos++;
+        SkipSpace();
+        if (pos < text.size() && text[pos] == ']') { pos++; return true; }
+
+        while (true)
+        {
+            value.items.emplace_back();
+            if (!ReadValue(value.items.back(), depth + 1)) return false;
+
+            SkipSpace();
+            if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+            if (pos < text.size() && text[pos] == ']') { pos++; return true; }
+            return Fail("expected ',' or ']'");
+        }
+    }
+
+    bool ReadString(std::string& out)
+    {
+        pos++;
+        while (pos < text.size() && text[pos] != '"')
+        {
+            char c = text[pos++];
+            if (c == '\n') return Fail("unterminated string");
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+
+            if (pos >= text.size()) break;
+            char escape = text[pos++];
+            switch (escape)
+            {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u':
+                {
+                    // Paths are the only strings, so anything past ASCII is just UTF-8 encoded.
+                    if (pos + 4 > text.size()) return Fail("bad \\u escape");
+                    unsigned code = (unsigned)strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                    if (code < 0x80)
+                        out += (char)code;
+                    else if (code < 0x800)
+                    {
+                        out += (char)(0xC0 | (code >> 6));
+                        out += (char)(0x80 | (code & 0x3F));
+                    }
+                    else
+                    {
+                        out += (char)(0xE0 | (code >> 12));
+                        out += (char)(0x80 | ((code >> 6) & 0x3F));
+                        out += (char)(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: out += escape; break;      // \" \\ \/
+            }
+        }
+        if (pos >= text.size()) return Fail("unterminated string");
+        pos++;
+        return true;
+    }
+};
+
+static bool ReadJsonCorners(const JsonValue& corners, Point points[4], std::string& error)
+{
+    const std::string shapeError = "\"corners\" must be 4 [x, y] pairs or 8 numbers";
+    if (corners.type != JsonValue::Array)
+    {
+        error = LineError(corners.line, shapeError);
+        return false;
+    }
+
+    // Either [[x, y], ...] or a flat [x0, y0, x1, y1, ...].
+    const JsonValue* values[8];
+    if (corners.items.size() == 4)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            const JsonValue& pair = corners.items[i];
+            if (pair.type != JsonValue::Array || pair.items.size() != 2)
+            {
+                error = LineError(pair.line, shapeError);
+                return false;
+            }
+            values[2 * i] = &pair.items[0];
+            values[2 * i + 1] = &pair.items[1];
+        }
+    }
+    else if (corners.items.size() == 8)
+    {
+        for (int i = 0; i < 8; i++)
+            values[i] = &corners.items[i];
+    }
+    else
+    {
+        error = LineError(corners.line, shapeError);
+        return false;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        if (values[i]->type != JsonValue::Number)
+        {
+            error = LineError(values[i]->line, shapeError);
+            return false;
+        }
+        // strtod also takes "nan", "inf" and out of range numbers like 1e999.
+        if (!std::isfinite(values[i]->number))
+        {
+            error = LineError(values[i]->line, "corner " + std::to_string(i / 2) + " isn't a finite number");
+            return false;
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+        points[i] = Point(values[2 * i]->number, values[2 * i + 1]->number);
+    return true;
+}
+
+static bool ReadJsonManifest(const std::string& text, WarpFilter defaultFilter, std::vector<WarpJob>& jobs, std::string& error)
+{
+    JsonValue root;
+    JsonReader reader(text);
+    if (!reader.ReadDocument(root, error))
+        return false;
+
+    const JsonValue* list = &root;
+    if (root.type == JsonValue::Object)
+        list = root.Find("jobs");
+    if (!list || list->type != JsonValue::Array)
+    {
+        error = "Manifest must be an array of jobs or an object with a \"jobs\" array";
+        return false;
+    }
+
+    for (const JsonValue& entry : list->items)
+    {
+        if (entry.type != JsonValue::Object)
+        {
+            error = LineError(entry.line, "job isn't an object");
+            return false;
+        }
+
+        const JsonValue* input = entry.Find("input");
+        const JsonValue* output = entry.Find("output");
+        const JsonValue* corners = entry.Find("corners");
+        const JsonValue* filter = entry.Find("filter");
+        if (!input || input->type != JsonValue::String || !output || output->type != JsonValue::String)
+        {
+            error = LineError(entry.line, "job needs \"input\" and \"output\" paths");
+            return false;
+        }
+
+        WarpJob job;
+        job.input = input->string;
+        job.output = output->string;
+        job.filter = defaultFilter;
+        job.sourceLine = entry.line;
+        if (!corners)
+        {
+            error = LineError(entry.line, "\"corners\" must be 4 [x, y] pairs or 8 numbers");
+            return false;
+        }
+        if (!ReadJsonCorners(*corners, job.corners, error))
+            return false;
+        if (filter && filter->type != JsonValue::Null &&
+            (filter->type != JsonValue::String || !ParseWarpFilter(filter->string.c_str(), job.filter)))
+        {
+            error = LineError(filter->line, "unknown filter");
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+bool ReadWarpManifest(const std::string& path, WarpFilter defaultFilter, std::vector<WarpJob>& jobs, std::string& error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        error = "Couldn't open " + path;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string text = contents.str();
+
+    // Skip a UTF-8 BOM, then decide on the format from the first real character.
+    size_t first = (text.compare(0, 3, "\xEF\xBB\xBF") == 0) ? 3 : 0;
+    size_t start = first;
+    while (start < text.size() && isspace((unsigned char)text[start])) start++;
+
+    jobs.clear();
+    if (start < text.size() && (text[start] == '[' || text[start] == '{'))
+        return ReadJsonManifest(text.substr(first), defaultFilter, jobs, error);
+
+    std::istringstream lines(text.substr(first));
+    return ReadCsvManifest(lines, defaultFilter, jobs, error);
+}
@@ -0,0 +1,121 @@
+#include "WorkerPool.h"
+
+// Set on any thread currently running tasks, so nested ParallelFor calls
+// run inline instead of waiting on the pool they're already a part of.
+static thread_local bool insideParallelFor = false;
+
+WorkerPool& WorkerPool::Get()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+WorkerPool::WorkerPool()
+{
+    SetThreadCount(0);
+}
+
+WorkerPool::~WorkerPool()
+{
+    StopWorkers();
+}
+
+void WorkerPool::SetThreadCount(int count)
+{
+    if (count <= 0)
+        count = (int)std::thread::hardware_concurrency();
+    if (count <= 0)
+        count = 1;
+
+    // Wait for any running job to finish before swapping out the threads.
+    std::lock_guard<std::mutex> busyLock(busyMutex);
+    StopWorkers();
+    StartWorkers(count - 1);
+}
+
+int WorkerPool::GetThreadCount() const
+{
+    return (int)workers.size() + 1;
+}
+
+void WorkerPool::ParallelFor(int taskCount, const std::function<void(int)>& task)
+{
+    if (taskCount <= 0) return;
+
+    // Not worth waking anyone up, or the pool is already in use; do it all here.
+    if (taskCount == 1 || workers.empty() || insideParallelFor || !busyMutex.try_lock())
+    {
+        for (int i = 0; i < taskCount; i++)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        currentTask = &task;
+        currentTaskCount = taskCount;
+        nextTask = 0;
+        workersRunning = (int)workers.size();
+        jobGeneration++;
+    }
+    jobReady.notify_all();
+
+    RunTasks();
+
+    {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobDone.wait(lock, [this] { return workersRunning == 0; });
+        currentTask = nullptr;
+    }
+    busyMutex.unlock();
+}
+
+void WorkerPool::StartWorkers(int count)
+{
+    // Generation is only bumped while busyMutex is held, so handing it over here
+    // guarantees new workers won't skip the first job posted after they start.
+    for (int i = 0; i < count; i++)
+        workers.emplace_back(&WorkerPool::WorkerLoop, this, jobGeneration);
+}
+
+void WorkerPool::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    workers.clear();
+    stopping = false;
+}
+
+void WorkerPool::WorkerLoop(unsigned long long lastGeneration)
+{
+    std::unique_lock<std::mutex> lock(jobMutex);
+
+    while (true)
+    {
+        jobReady.wait(lock, [&] { return stopping || jobGeneration != lastGeneration; });
+        if (stopping) return;
+        lastGeneration = jobGeneration;
+
+        lock.unlock();
+        RunTasks();
+        lock.lock();
+
+        if (--workersRunning == 0)
+            jobDone.notify_one();
+    }
+}
+
+void WorkerPool::RunTasks()
+{
+    insideParallelFor = true;
+    for (int i = nextTask.fetch_add(1); i < currentTaskCount; i = nextTask.fetch_add(1))
+        (*currentTask)(i);
+    insideParallelFor = false;
+}
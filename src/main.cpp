@@ -15,6 +15,8 @@
 
 #include "ProjectiveWarper.h"
 #include "PixelRGBA.h"
+#include "WarpKernels.h"
+#include "WorkerPool.h"
 
 ProjectiveWarper warper;
 
@@ -32,6 +34,11 @@ void Reshape(int newWidth, int newHeight)
     warper.HandleWindowReshape(newWidth, newHeight);
 }
 
+void WindowStatus(int state)
+{
+    warper.HandleWindowStatus(state);
+}
+
 void HandleKeys(unsigned char key, int x, int y)
 {
     warper.HandleKeyPresses(key, x, y);
@@ -69,6 +76,7 @@ void InitProgramPrompt()
     std::cout << "N:                      Create New Layer from a specified image file\n";
     std::cout << "S:                      Save current window as an output image\n";
     std::cout << "R:                      Reset currently selected layer to raw image state at origin\n";
+    std::cout << "F:                      Cycle filter of selected layer (nearest, bilinear, bicubic, trilinear)\n";
     std::cout << "DEL or BACKSPACE:       Delete currently selected layer\n";
     std::cout << "<- or -> arrows:        Shift current layer down or up respectively\n";
     std::cout << "v or ^ arrows:          Select an existing layer below or above currently selected one\n\n";
@@ -97,6 +105,16 @@ int main(int argc, char* argv[])
 
     glutInit(&argc, argv);
 
+    // Glut strips out its own arguments, so anything left over is ours.
+    // "--threads N" limits how many cores warping uses (0 = all of them).
+    for (int i = 1; i < argc - 1; i++)
+    {
+        if (std::string(argv[i]) == "--threads")
+            WorkerPool::Get().SetThreadCount(std::atoi(argv[i + 1]));
+    }
+    std::cout << "Warping with " << WorkerPool::Get().GetThreadCount() << " thread(s) using "
+        << SimdLevelName(GetWarpKernels().level) << " kernels\n";
+
     std::cout << "Creating program window...\n";
     // Create the graphics window, giving width, height, and title text
     glutInitDisplayMode(GLUT_SINGLE | GLUT_RGBA);
@@ -106,6 +124,7 @@ int main(int argc, char* argv[])
     // Set up glut main loop functions, then init.
     glutDisplayFunc(Display);
     glutReshapeFunc(Reshape);
+    glutWindowStatusFunc(WindowStatus);
     glutKeyboardFunc(HandleKeys);
     glutSpecialFunc(HandleSpecialKeys);
     glutMouseFunc(HandleMouseState);